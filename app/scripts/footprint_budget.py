@@ -0,0 +1,229 @@
+"""Per-module RAM/ROM breakdown of a Zephyr build, checked against a budget.
+
+Reads the linker map (build/zephyr/zephyr.map). Every input section is
+attributed to the library it was linked from, Zephyr names them after their
+directory (libsubsys__bluetooth__host.a is "subsys/bluetooth/host"), the
+application is split per source file ("app/ble_svc"). Initialized data counts
+for both RAM and ROM.
+
+The budget is a YAML file mapping module patterns (fnmatch, "total" for the
+whole image) to limits in bytes:
+
+    subsys/mgmt/*:
+      rom: 0
+      ram: 0
+
+Exits with 1 if a limit is exceeded.
+
+    python footprint_budget.py build/zephyr/zephyr.map --budget lean_budget.yaml
+
+With --compare the difference to a second build is printed per module, e.g.
+what a build profile saves against the default one:
+
+    python footprint_budget.py build_no_fpu/zephyr/zephyr.map \
+        --compare build_fpu/zephyr/zephyr.map
+"""
+
+import argparse
+import fnmatch
+import re
+import sys
+from collections import defaultdict
+
+# Output sections without memory, e.g. debug information at address 0
+SKIPPED_SECTIONS = (
+    ".debug",
+    ".comment",
+    ".ARM.attributes",
+    ".stab",
+    ".symtab",
+    ".strtab",
+    ".shstrtab",
+    "/DISCARD/",
+)
+
+HEX = r"0x([0-9a-fA-F]+)"
+REGION = re.compile(rf"^(\S+)\s+{HEX}\s+{HEX}")
+OUTPUT_ADDR = rf"\s+{HEX}\s+{HEX}(?:\s+load address\s+{HEX})?"
+OUTPUT_SECTION = re.compile(rf"^(\S+)(?:{OUTPUT_ADDR})?\s*$")
+OUTPUT_CONTINUATION = re.compile(rf"^{OUTPUT_ADDR}\s*$")
+INPUT_SECTION = re.compile(rf"^ (\S+)\s+{HEX}\s+{HEX}\s+(\S.*)$")
+INPUT_NAME = re.compile(r"^ ([^\s*]\S*)$")
+INPUT_CONTINUATION = re.compile(rf"^\s+{HEX}\s+{HEX}\s+(\S.*)$")
+ARCHIVE_MEMBER = re.compile(r"(?:^|[/\\])(?:lib)?([^/\\]+)\.a\((.+)\)$")
+
+
+def module_name(origin):
+    match = ARCHIVE_MEMBER.search(origin.strip())
+    if match is None:
+        return "(other)"
+
+    library, member = match.groups()
+    if library == "app":
+        return "app/" + re.sub(r"(\.c)?\.(obj|o)$", "", member)
+    return library.replace("__", "/")
+
+
+def region_kind(regions, address):
+    for name, origin, length in regions:
+        if origin <= address < origin + length:
+            if "FLASH" in name or "ROM" in name:
+                return "rom"
+            if "RAM" in name:
+                return "ram"
+    return None
+
+
+def parse_map(path):
+    """Return {module: {"rom": bytes, "ram": bytes}}."""
+    with open(path, encoding="utf-8", errors="replace") as f:
+        lines = f.read().splitlines()
+
+    regions = []
+    start = lines.index("Memory Configuration") + 3
+    for line in lines[start:]:
+        match = REGION.match(line)
+        if match is None:
+            break
+        name, origin, length = match.groups()
+        if name != "*default*":
+            regions.append((name.upper(), int(origin, 16), int(length, 16)))
+
+    sizes = defaultdict(lambda: {"rom": 0, "ram": 0})
+    kinds = ()
+    pending_output = None
+    pending_input = None
+
+    for line in lines[lines.index("Linker script and memory map") :]:
+        if pending_output is not None:
+            match = OUTPUT_CONTINUATION.match(line)
+            kinds = section_kinds(regions, pending_output, match)
+            pending_output = None
+            if match is not None:
+                continue
+
+        if line and not line[0].isspace():
+            match = OUTPUT_SECTION.match(line)
+            if match is None:
+                kinds = ()
+            elif match.group(2) is None:
+                pending_output = match.group(1)
+            else:
+                kinds = section_kinds(regions, match.group(1), match, offset=1)
+            pending_input = None
+            continue
+
+        if pending_input is not None:
+            match = INPUT_CONTINUATION.match(line)
+            pending_input = None
+            if match is not None:
+                add(sizes, kinds, match.group(2), match.group(3))
+                continue
+
+        match = INPUT_SECTION.match(line)
+        if match is not None:
+            if not match.group(1).startswith("*"):
+                add(sizes, kinds, match.group(3), match.group(4))
+            continue
+
+        if INPUT_NAME.match(line):
+            pending_input = line
+
+    return sizes
+
+
+def section_kinds(regions, name, match, offset=0):
+    if match is None or name.startswith(SKIPPED_SECTIONS):
+        return ()
+
+    address, _, load_address = match.groups()[offset:]
+    kinds = {region_kind(regions, int(address, 16))}
+    if load_address is not None:
+        kinds.add(region_kind(regions, int(load_address, 16)))
+    kinds.discard(None)
+    return tuple(kinds)
+
+
+def add(sizes, kinds, size, origin):
+    size = int(size, 16)
+    if size == 0 or not kinds:
+        return
+    module = module_name(origin)
+    for kind in kinds:
+        sizes[module][kind] += size
+
+
+def check_budget(sizes, budget):
+    """Print the budget lines, return False if a limit is exceeded."""
+    ok = True
+
+    print(f"\n{'Budget':<40} {'Used':>9} {'Limit':>9}")
+    for pattern, limits in budget.items():
+        if pattern == "total":
+            modules = list(sizes)
+        else:
+            modules = [m for m in sizes if fnmatch.fnmatchcase(m, pattern)]
+
+        for kind in ("rom", "ram"):
+            if kind not in limits:
+                continue
+            used = sum(sizes[m][kind] for m in modules)
+            over = used > limits[kind]
+            ok = ok and not over
+            label = f"{pattern} {kind.upper()}"
+            status = "OVER" if over else "ok"
+            print(f"{label:<40} {used:>9} {limits[kind]:>9} {status}")
+
+    return ok
+
+
+def print_delta(sizes, reference):
+    """Print the modules whose size differs from the reference build."""
+    print(f"\n{'Delta to the reference':<40} {'ROM':>9} {'RAM':>9}")
+    for module in sorted(set(sizes) | set(reference)):
+        rom = sizes.get(module, {}).get("rom", 0)
+        ram = sizes.get(module, {}).get("ram", 0)
+        rom -= reference.get(module, {}).get("rom", 0)
+        ram -= reference.get(module, {}).get("ram", 0)
+        if rom or ram:
+            print(f"{module:<40} {rom:>+9} {ram:>+9}")
+    rom = sum(size["rom"] for size in sizes.values())
+    ram = sum(size["ram"] for size in sizes.values())
+    rom -= sum(size["rom"] for size in reference.values())
+    ram -= sum(size["ram"] for size in reference.values())
+    print(f"{'Total':<40} {rom:>+9} {ram:>+9}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map_file", help="Linker map of the build")
+    parser.add_argument("--budget", help="YAML file with the limits in bytes")
+    parser.add_argument("--compare", help="Linker map of a reference build")
+    args = parser.parse_args()
+
+    sizes = parse_map(args.map_file)
+
+    print(f"{'Module':<40} {'ROM':>9} {'RAM':>9}")
+    for module, size in sorted(sizes.items(), key=lambda item: -item[1]["rom"]):
+        print(f"{module:<40} {size['rom']:>9} {size['ram']:>9}")
+    rom = sum(size["rom"] for size in sizes.values())
+    ram = sum(size["ram"] for size in sizes.values())
+    print(f"{'Total':<40} {rom:>9} {ram:>9}")
+
+    if args.compare is not None:
+        print_delta(sizes, parse_map(args.compare))
+
+    if args.budget is None:
+        return
+
+    import yaml
+
+    with open(args.budget, encoding="utf-8") as f:
+        budget = yaml.safe_load(f) or {}
+
+    if not check_budget(sizes, budget):
+        sys.exit("Footprint budget exceeded")
+
+
+if __name__ == "__main__":
+    main()
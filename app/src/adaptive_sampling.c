@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include "adaptive_sampling.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(adaptive_sampling, LOG_LEVEL_INF);
+
+#define MIN_PERIOD_MS      (CONFIG_ADAPTIVE_SAMPLING_MIN_PERIOD_SECONDS * MSEC_PER_SEC)
+#define MAX_PERIOD_MS      (CONFIG_ADAPTIVE_SAMPLING_MAX_PERIOD_SECONDS * MSEC_PER_SEC)
+#define BASELINE_PERIOD_MS (CONFIG_MEASURING_PERIOD_SECONDS * MSEC_PER_SEC)
+/* Rates are in 0.01 units per 1000 s, clamping the delta keeps the math in 32 bit */
+#define RATE_SCALE         1000000
+#define MAX_DELTA          2000
+/* EMA weight of a new rate sample: 1 / 2^RATE_EMA_SHIFT */
+#define RATE_EMA_SHIFT     2
+#define STATS_LOG_INTERVAL 100
+
+BUILD_ASSERT(CONFIG_ADAPTIVE_SAMPLING_MIN_PERIOD_SECONDS <=
+		     CONFIG_ADAPTIVE_SAMPLING_MAX_PERIOD_SECONDS,
+	     "Adaptive sampling minimum period must not exceed the maximum period");
+
+/*
+ * Thread-safety: Only called from measuring_work on the system workqueue, stats readers accept
+ * a torn read of the counters.
+ */
+struct adaptive_sampling_data {
+	bool has_previous;
+	int16_t temperature;
+	uint16_t humidity;
+	int64_t uptime_ms;
+	uint32_t temperature_rate;
+	uint32_t humidity_rate;
+	uint32_t period_ms;
+	uint32_t samples;
+	uint64_t elapsed_ms;
+};
+
+static struct adaptive_sampling_data data = {
+	.period_ms = BASELINE_PERIOD_MS,
+};
+
+static uint32_t rate_update(uint32_t rate, int32_t delta, uint32_t dt_ms)
+{
+	uint32_t sample = (uint32_t)MIN(abs(delta), MAX_DELTA) * (RATE_SCALE / 1000) /
+			  MAX(dt_ms / 1000, 1);
+
+	return (int32_t)rate + (((int32_t)sample - (int32_t)rate) >> RATE_EMA_SHIFT);
+}
+
+/* Time in ms until a channel moving at @p rate changes by @p step */
+static uint32_t period_for_step(uint32_t rate, uint32_t step)
+{
+	if (rate == 0) {
+		return MAX_PERIOD_MS;
+	}
+
+	return (uint32_t)MIN((uint64_t)step * RATE_SCALE / rate, MAX_PERIOD_MS);
+}
+
+uint32_t adaptive_sampling_next_period_ms(int16_t temperature, uint16_t humidity,
+					  int64_t uptime_ms)
+{
+	uint32_t period_ms;
+
+	data.samples++;
+
+	if (data.has_previous) {
+		uint32_t dt_ms = (uint32_t)(uptime_ms - data.uptime_ms);
+
+		data.elapsed_ms += dt_ms;
+		data.temperature_rate = rate_update(data.temperature_rate,
+						    temperature - data.temperature, dt_ms);
+		data.humidity_rate =
+			rate_update(data.humidity_rate, (int32_t)humidity - data.humidity, dt_ms);
+
+		period_ms = MIN(period_for_step(data.temperature_rate,
+						CONFIG_ADAPTIVE_SAMPLING_TEMP_STEP_CENTI),
+				period_for_step(data.humidity_rate,
+						CONFIG_ADAPTIVE_SAMPLING_HUMIDITY_STEP_CENTI));
+		period_ms = MIN(period_ms, 2 * data.period_ms);
+		data.period_ms = CLAMP(period_ms, MIN_PERIOD_MS, MAX_PERIOD_MS);
+	}
+
+	data.has_previous = true;
+	data.temperature = temperature;
+	data.humidity = humidity;
+	data.uptime_ms = uptime_ms;
+
+	LOG_DBG("Rates %u/%u, next measurement in %u ms", data.temperature_rate,
+		data.humidity_rate, data.period_ms);
+
+	if (data.samples % STATS_LOG_INTERVAL == 0) {
+		LOG_INF("%u measurements, the fixed period would have taken %u", data.samples,
+			(uint32_t)(data.elapsed_ms / BASELINE_PERIOD_MS) + 1);
+	}
+
+	return data.period_ms;
+}
+
+void adaptive_sampling_get_stats(struct adaptive_sampling_stats *stats)
+{
+	stats->samples = data.samples;
+	stats->baseline_samples = (uint32_t)(data.elapsed_ms / BASELINE_PERIOD_MS) + 1;
+	stats->period_ms = data.period_ms;
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_ADAPTIVE_SAMPLING_H_
+#define APP_ADAPTIVE_SAMPLING_H_
+
+#include <stdint.h>
+
+struct adaptive_sampling_stats {
+	uint32_t samples;          /* Measurements taken */
+	uint32_t baseline_samples; /* Measurements the fixed period would have taken meanwhile */
+	uint32_t period_ms;        /* Current measurement period */
+};
+
+/**
+ * @brief Feed a new measurement and get the period until the next one.
+ *
+ * Updates an exponential moving average of the rate of change of both channels and picks the
+ * period in which the faster moving channel is expected to move by one configured step, clamped
+ * to the configured bounds. The period grows by at most a factor of two per measurement, but
+ * shrinks immediately.
+ *
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Humidity in 0.01 %.
+ * @param uptime_ms Uptime of the measurement in ms.
+ *
+ * @return Period until the next measurement in ms.
+ */
+uint32_t adaptive_sampling_next_period_ms(int16_t temperature, uint16_t humidity,
+					  int64_t uptime_ms);
+
+/**
+ * @brief Get the measurement counters of the scheduler.
+ *
+ * @param stats Filled with the counters.
+ */
+void adaptive_sampling_get_stats(struct adaptive_sampling_stats *stats);
+
+#endif /* APP_ADAPTIVE_SAMPLING_H_ */
@@ -0,0 +1,573 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "backfill_svc.h"
+#include "conn_param_policy.h"
+#include "history_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(backfill_svc, LOG_LEVEL_INF);
+
+#define BT_UUID_BACKFILL_SVC_VAL                                                                   \
+	BT_UUID_128_ENCODE(0x8b5a0010, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+#define BT_UUID_BACKFILL_DATA_VAL                                                                  \
+	BT_UUID_128_ENCODE(0x8b5a0011, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+
+#define BT_UUID_BACKFILL_SVC  BT_UUID_DECLARE_128(BT_UUID_BACKFILL_SVC_VAL)
+#define BT_UUID_BACKFILL_DATA BT_UUID_DECLARE_128(BT_UUID_BACKFILL_DATA_VAL)
+
+#define PACKET_TYPE_DATA     0x01
+#define PACKET_TYPE_COMPLETE 0x02
+
+#define DATA_HDR_SIZE   6
+#define DATA_ENTRY_SIZE 6
+#define COMPLETE_SIZE   9
+#define ATT_NOTIFY_HDR  3
+/* One notification per 251 byte LL PDU: 251 - 4 (L2CAP) - 3 (ATT) */
+#define PACKET_MAX_SIZE 244
+/* Keep one ACL buffer free for the ESS notifications and MCUmgr */
+#define MAX_IN_FLIGHT   MAX(1, CONFIG_BT_BUF_ACL_TX_COUNT - 1)
+#define DATA_ATTR_IDX   1
+#define RING_SIZE       CONFIG_BACKFILL_RAM_SAMPLES
+/* Retry of a notification that found no TX buffer while none of ours was in flight */
+#define RETRY_DELAY_MS  20
+
+struct backfill_entry {
+	uint32_t timestamp; /* Log time with the history log, uptime otherwise, in seconds */
+	int16_t temperature;
+	uint16_t humidity;
+};
+
+/*
+ * Thread-safety: The connection callbacks only store the connection change under the lock and
+ * submit the work item. Everything else is only touched from the system workqueue, by
+ * backfill_work_handler, backfill_svc_append and the ESS notification path.
+ *
+ * The replay goes to the first connected central that subscribes, usually the gateway. If it
+ * disconnects before the replay is complete, the next connected subscriber takes over, without
+ * the samples it already received live.
+ */
+struct backfill_data {
+	struct k_spinlock lock;
+	struct bt_conn *connect_requests[CONFIG_BT_MAX_CONN];
+	uint32_t disconnect_mask; /* BIT(bt_conn_index()) of centrals that disconnected */
+
+	/* Connected centrals by bt_conn_index(), and where their live values started */
+	struct bt_conn *conns[CONFIG_BT_MAX_CONN];
+	uint32_t connect_seq[CONFIG_BT_MAX_CONN];
+	uint32_t connect_time[CONFIG_BT_MAX_CONN];
+	uint8_t connected;
+
+	struct bt_conn *conn; /* Receiver of the replay, one of conns */
+	atomic_t replaying;
+
+	struct backfill_entry ring[RING_SIZE];
+	uint16_t ring_head;
+	uint16_t ring_count;
+	uint32_t appended; /* Sequence number of the next sample */
+	uint32_t dropped;
+
+	/* Replay from the history log, set once the ring overflowed */
+	bool from_log;
+	uint32_t log_resume_time;
+	struct history_cursor cursor;
+	struct backfill_entry next;
+	bool has_next;
+	/* Log time the receiver got live, skipped by the replay */
+	uint32_t skip_from;
+	uint32_t skip_to;
+
+	uint32_t count;
+	uint8_t packet[PACKET_MAX_SIZE];
+	uint16_t packet_len;
+	uint16_t packet_entries;
+	uint32_t packet_first_time;
+	uint32_t packet_resume_time;
+	atomic_t in_flight;
+};
+
+static struct backfill_data data;
+
+static void backfill_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(backfill_work, backfill_work_handler);
+
+static void data_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	LOG_DBG("Backfill notifications %s", value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
+
+	k_work_reschedule(&backfill_work, K_NO_WAIT);
+}
+
+BT_GATT_SERVICE_DEFINE(backfill_service, BT_GATT_PRIMARY_SERVICE(BT_UUID_BACKFILL_SVC),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_BACKFILL_DATA, BT_GATT_CHRC_NOTIFY,
+					      BT_GATT_PERM_NONE, NULL, NULL, NULL),
+		       BT_GATT_CCC(data_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+static uint32_t backfill_time(void)
+{
+	if (IS_ENABLED(CONFIG_HISTORY_LOG)) {
+		return history_svc_get_time();
+	}
+
+	return (uint32_t)k_uptime_seconds();
+}
+
+static const struct backfill_entry *ring_peek(uint16_t pos)
+{
+	return &data.ring[(data.ring_head + pos) % RING_SIZE];
+}
+
+static void ring_drop(uint16_t count)
+{
+	count = MIN(count, data.ring_count);
+	data.ring_head = (data.ring_head + count) % RING_SIZE;
+	data.ring_count -= count;
+}
+
+void backfill_svc_append(int16_t temperature, uint16_t humidity)
+{
+	struct backfill_entry *entry;
+
+	/* Delivered live, unless the receiver holds live values back during its replay */
+	if (data.connected > 0 && !atomic_get(&data.replaying)) {
+		return;
+	}
+
+	if (data.ring_count == RING_SIZE) {
+		if (data.from_log) {
+			/* The ring is not used for the replay */
+		} else if (IS_ENABLED(CONFIG_HISTORY_LOG) && !atomic_get(&data.replaying)) {
+			/* The log holds every sample since log_resume_time */
+			data.from_log = true;
+		} else {
+			data.dropped++;
+		}
+
+		/* The oldest entry may be part of the packet in flight, which is sent anyway */
+		if (data.packet_entries > 0) {
+			data.packet_entries--;
+		}
+		ring_drop(1);
+	}
+
+	entry = &data.ring[(data.ring_head + data.ring_count) % RING_SIZE];
+	entry->timestamp = backfill_time();
+	entry->temperature = temperature;
+	entry->humidity = humidity;
+
+	if (data.ring_count == 0 && !data.from_log) {
+		data.log_resume_time = entry->timestamp;
+	}
+	data.ring_count++;
+	data.appended++;
+}
+
+bool backfill_svc_is_replaying(const struct bt_conn *conn)
+{
+	return atomic_get(&data.replaying) != 0 && conn == data.conn;
+}
+
+static void log_fetch_next(void)
+{
+	struct history_sample sample;
+	int ret;
+
+	ret = history_svc_read_next(&data.cursor, &sample);
+	if (ret == -ESTALE) {
+		/* The log overtook the replay, skip ahead to the oldest stored sample */
+		LOG_WRN("Backfill lost samples after %u s", data.next.timestamp);
+		ret = history_svc_seek_time(&data.cursor, data.next.timestamp + 1);
+		if (ret == 0) {
+			ret = history_svc_read_next(&data.cursor, &sample);
+		}
+	}
+
+	if (ret == 0 && IN_RANGE(sample.timestamp, data.skip_from, data.skip_to - 1)) {
+		ret = history_svc_seek_time(&data.cursor, data.skip_to);
+		if (ret == 0) {
+			ret = history_svc_read_next(&data.cursor, &sample);
+		}
+		data.skip_from = 0;
+		data.skip_to = 0;
+	}
+
+	data.has_next = (ret == 0);
+	if (data.has_next) {
+		data.next.timestamp = sample.timestamp;
+		data.next.temperature = sample.temperature;
+		data.next.humidity = sample.humidity;
+	}
+}
+
+static void replay_start(void)
+{
+	int ret;
+
+	data.count = 0;
+	data.packet_len = 0;
+	data.packet_entries = 0;
+	data.has_next = false;
+
+	if (data.from_log) {
+		ret = history_svc_seek_time(&data.cursor, data.log_resume_time);
+		if (ret == 0) {
+			log_fetch_next();
+		} else if (ret != -ENODATA) {
+			LOG_ERR("Failed to read missed samples from the history log: %d", ret);
+		}
+	}
+
+	atomic_set(&data.replaying, 1);
+
+	if (IS_ENABLED(CONFIG_CONN_PARAM_POLICY)) {
+		conn_param_policy_set_activity(data.conn, CONN_PARAM_ACTIVITY_BACKFILL, true);
+	}
+
+	LOG_INF("Backfill started, %u samples buffered%s", data.ring_count,
+		data.from_log ? ", reading from history log" : "");
+}
+
+/* Resets the buffered samples once the central received all of them */
+static void replay_finish(void)
+{
+	LOG_INF("Backfill complete, %u samples, %u dropped", data.count, data.dropped);
+
+	atomic_set(&data.replaying, 0);
+	if (IS_ENABLED(CONFIG_CONN_PARAM_POLICY)) {
+		conn_param_policy_set_activity(data.conn, CONN_PARAM_ACTIVITY_BACKFILL, false);
+	}
+	data.ring_head = 0;
+	data.ring_count = 0;
+	data.dropped = 0;
+	data.from_log = false;
+	data.packet_len = 0;
+}
+
+/* Keeps the samples that were not handed to the stack for the next connection */
+static void replay_interrupt(void)
+{
+	if (atomic_get(&data.replaying)) {
+		LOG_INF("Backfill interrupted after %u samples", data.count);
+
+		if (IS_ENABLED(CONFIG_CONN_PARAM_POLICY)) {
+			conn_param_policy_set_activity(data.conn, CONN_PARAM_ACTIVITY_BACKFILL,
+						       false);
+		}
+	}
+
+	atomic_set(&data.replaying, 0);
+	data.packet_len = 0;
+	data.packet_entries = 0;
+}
+
+/* Packs as many samples as fit into the negotiated ATT MTU */
+static int packet_build(uint16_t max_len)
+{
+	uint8_t *packet = data.packet;
+	struct backfill_entry first;
+	struct backfill_entry prev;
+	struct backfill_entry entry;
+	uint8_t count = 0;
+	uint16_t len = DATA_HDR_SIZE;
+
+	if (data.from_log ? !data.has_next : data.ring_count == 0) {
+		return -ENODATA;
+	}
+
+	first = data.from_log ? data.next : *ring_peek(0);
+	prev = first;
+
+	while (len + DATA_ENTRY_SIZE <= max_len && count < UINT8_MAX) {
+		uint32_t dt;
+
+		if (data.from_log) {
+			if (!data.has_next) {
+				break;
+			}
+			entry = data.next;
+		} else {
+			if (count == data.ring_count) {
+				break;
+			}
+			entry = *ring_peek(count);
+		}
+
+		dt = entry.timestamp - prev.timestamp;
+		if (dt > UINT16_MAX) {
+			break;
+		}
+
+		sys_put_le16(dt, &packet[len]);
+		sys_put_le16(entry.temperature, &packet[len + 2]);
+		sys_put_le16(entry.humidity, &packet[len + 4]);
+		len += DATA_ENTRY_SIZE;
+		count++;
+		prev = entry;
+
+		if (data.from_log) {
+			log_fetch_next();
+		}
+	}
+
+	/* The age is filled in by packet_stamp() */
+	packet[0] = PACKET_TYPE_DATA;
+	packet[5] = count;
+	data.packet_len = len;
+	data.packet_entries = data.from_log ? 0 : count;
+	data.packet_first_time = first.timestamp;
+	data.packet_resume_time = prev.timestamp + 1;
+
+	return 0;
+}
+
+static void packet_build_complete(void)
+{
+	uint8_t *packet = data.packet;
+
+	packet[0] = PACKET_TYPE_COMPLETE;
+	sys_put_le32(data.count, &packet[1]);
+	sys_put_le32(data.dropped, &packet[5]);
+	data.packet_len = COMPLETE_SIZE;
+	data.packet_entries = 0;
+}
+
+/* Sets the age of a data packet, right before every attempt to send it */
+static void packet_stamp(void)
+{
+	if (data.packet[0] == PACKET_TYPE_DATA) {
+		sys_put_le32(backfill_time() - data.packet_first_time, &data.packet[1]);
+	}
+}
+
+/* Called once a packet was handed to the stack, its samples no longer need to be kept */
+static void packet_commit(void)
+{
+	if (data.from_log) {
+		data.log_resume_time = data.packet_resume_time;
+	} else {
+		ring_drop(data.packet_entries);
+	}
+
+	data.count += data.packet[0] == PACKET_TYPE_DATA ? data.packet[5] : 0;
+	data.packet_len = 0;
+	data.packet_entries = 0;
+}
+
+static void notify_sent(struct bt_conn *conn, void *user_data)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(user_data);
+
+	atomic_dec(&data.in_flight);
+	k_work_reschedule(&backfill_work, K_NO_WAIT);
+}
+
+static bool replay_pending(void)
+{
+	return data.ring_count > 0 || data.from_log;
+}
+
+static void conns_update(void)
+{
+	struct bt_conn *connect_requests[CONFIG_BT_MAX_CONN];
+	uint32_t disconnect_mask;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data.lock);
+	memcpy(connect_requests, data.connect_requests, sizeof(connect_requests));
+	memset(data.connect_requests, 0, sizeof(data.connect_requests));
+	disconnect_mask = data.disconnect_mask;
+	data.disconnect_mask = 0;
+	k_spin_unlock(&data.lock, key);
+
+	/* A disconnect always precedes the next connection with the same index */
+	for (size_t i = 0; i < ARRAY_SIZE(data.conns); i++) {
+		if ((disconnect_mask & BIT(i)) != 0 && data.conns[i] != NULL) {
+			if (data.conns[i] == data.conn) {
+				replay_interrupt();
+				data.conn = NULL;
+			}
+			bt_conn_unref(data.conns[i]);
+			data.conns[i] = NULL;
+			data.connected--;
+		}
+
+		if (connect_requests[i] != NULL) {
+			data.conns[i] = connect_requests[i];
+			data.connect_seq[i] = data.appended;
+			data.connect_time[i] = backfill_time();
+			data.connected++;
+		}
+	}
+}
+
+/* Leaves out what the new receiver got live while it was connected */
+static void receiver_set(size_t i)
+{
+	/* Samples appended from connect_seq on came during another replay */
+	int32_t before_connect = (int32_t)(data.connect_seq[i] - (data.appended - data.ring_count));
+	uint32_t now = backfill_time();
+
+	data.conn = data.conns[i];
+
+	if (data.from_log) {
+		data.skip_from = data.connect_time[i] + 1;
+		data.skip_to = MAX(now, data.skip_from);
+	} else if (before_connect < data.ring_count) {
+		data.ring_count = MAX(before_connect, 0);
+	}
+}
+
+/* The first connected central that subscribed receives the replay */
+static bool receiver_select(void)
+{
+	const struct bt_gatt_attr *attr = &backfill_service.attrs[DATA_ATTR_IDX];
+
+	for (size_t i = 0; i < ARRAY_SIZE(data.conns); i++) {
+		if (data.conns[i] != NULL &&
+		    bt_gatt_is_subscribed(data.conns[i], attr, BT_GATT_CCC_NOTIFY)) {
+			receiver_set(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void backfill_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	const struct bt_gatt_attr *attr = &backfill_service.attrs[DATA_ATTR_IDX];
+	int ret;
+
+	conns_update();
+
+	if (!atomic_get(&data.replaying)) {
+		if (!replay_pending()) {
+			return;
+		}
+
+		if (data.conn == NULL && !receiver_select()) {
+			return;
+		}
+
+		/* Everything left was received live */
+		if (!replay_pending()) {
+			data.conn = NULL;
+			return;
+		}
+
+		if (!bt_gatt_is_subscribed(data.conn, attr, BT_GATT_CCC_NOTIFY)) {
+			return;
+		}
+
+		replay_start();
+	}
+
+	/* Paced by the TX buffers, every sent notification resubmits the work */
+	while (atomic_get(&data.in_flight) < MAX_IN_FLIGHT) {
+		struct bt_gatt_notify_params params = {
+			.attr = attr,
+			.func = notify_sent,
+		};
+
+		if (data.packet_len == 0) {
+			uint16_t max_len = MIN(bt_gatt_get_mtu(data.conn) - ATT_NOTIFY_HDR,
+					       PACKET_MAX_SIZE);
+
+			ret = packet_build(max_len);
+			if (ret == -ENODATA) {
+				packet_build_complete();
+			}
+		}
+
+		packet_stamp();
+		params.data = data.packet;
+		params.len = data.packet_len;
+
+		atomic_inc(&data.in_flight);
+		ret = bt_gatt_notify_cb(data.conn, &params);
+		if (ret == -ENOMEM) {
+			/*
+			 * Out of TX buffers, retried when the next notification is sent. If none
+			 * of ours is in flight, other traffic holds the buffers, poll for them.
+			 */
+			if (atomic_dec(&data.in_flight) == 1) {
+				k_work_schedule(&backfill_work, K_MSEC(RETRY_DELAY_MS));
+			}
+			break;
+		}
+		if (ret != 0) {
+			atomic_dec(&data.in_flight);
+			LOG_WRN("Backfill stopped: %d", ret);
+			replay_interrupt();
+			break;
+		}
+
+		if (data.packet[0] == PACKET_TYPE_COMPLETE) {
+			replay_finish();
+			break;
+		}
+
+		packet_commit();
+	}
+}
+
+static void on_connected(struct bt_conn *conn, uint8_t err)
+{
+	k_spinlock_key_t key;
+
+	if (err != 0) {
+		return;
+	}
+
+	key = k_spin_lock(&data.lock);
+	if (data.connect_requests[bt_conn_index(conn)] == NULL) {
+		data.connect_requests[bt_conn_index(conn)] = bt_conn_ref(conn);
+	}
+	k_spin_unlock(&data.lock, key);
+
+	k_work_reschedule(&backfill_work, K_NO_WAIT);
+}
+
+static void on_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	ARG_UNUSED(reason);
+
+	k_spinlock_key_t key = k_spin_lock(&data.lock);
+
+	if (data.connect_requests[bt_conn_index(conn)] == conn) {
+		bt_conn_unref(conn);
+		data.connect_requests[bt_conn_index(conn)] = NULL;
+	}
+	data.disconnect_mask |= BIT(bt_conn_index(conn));
+	k_spin_unlock(&data.lock, key);
+
+	k_work_reschedule(&backfill_work, K_NO_WAIT);
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.connected = on_connected,
+	.disconnected = on_disconnected,
+};
+
+void backfill_svc_init(void)
+{
+	bt_conn_cb_register(&conn_callbacks);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BACKFILL_SVC_H_
+#define APP_BACKFILL_SVC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <zephyr/bluetooth/conn.h>
+
+/*
+ * Backfill GATT service
+ *
+ * Measurements taken while no central is connected are kept in a RAM ring. Once a connected
+ * central subscribes to the data characteristic they are replayed to it as a paced burst, oldest
+ * first, and the live ESS notifications to that central are held back until the replay is
+ * complete. If it disconnects before, another connected subscriber takes over the rest, without
+ * the samples it received live. If the ring overflowed and the history log is enabled, the replay
+ * reads the missed samples from the log instead.
+ *
+ * Data (notify), all values little endian:
+ *   0x01 <u32 age> <u8 count> count x (<u16 dt> <s16 temperature> <u16 humidity>)
+ *        age is the number of seconds between the first sample of the packet and the time the
+ *        packet was built, dt the time since the previous sample of the packet (0 for the first
+ *        one), temperature in 0.01 °C, humidity in 0.01 %.
+ *   0x02 <u32 count> <u32 dropped>
+ *        End of the replay, live notifications resume. dropped is the number of samples lost to
+ *        an overflow of the RAM ring.
+ */
+
+/**
+ * @brief Store a measurement for the replay.
+ *
+ * Only kept while no central is connected or a replay is running, otherwise the measurement
+ * is delivered live to every connected central. Must be called from the system workqueue.
+ *
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Humidity in 0.01 %.
+ */
+void backfill_svc_append(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Check whether missed measurements are being replayed to a central.
+ *
+ * Live notifications to that central are held back during the replay, the measurements are
+ * appended to it. Must be called from the system workqueue.
+ *
+ * @param conn Connection of the central.
+ *
+ * @return true while a replay to @p conn is running.
+ */
+bool backfill_svc_is_replaying(const struct bt_conn *conn);
+
+/**
+ * @brief Initialize the backfill service.
+ *
+ * Call after history_svc_init() if the history log is enabled.
+ */
+void backfill_svc_init(void);
+
+#endif /* APP_BACKFILL_SVC_H_ */
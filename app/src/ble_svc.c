@@ -4,16 +4,31 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <zephyr/bluetooth/addr.h>
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/uuid.h>
+#include <zephyr/drivers/hwinfo.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/stats/stats.h>
 #include <zephyr/sys/atomic.h>
 #include <zephyr/sys/byteorder.h>
 
+#include "backfill_svc.h"
 #include "ble_svc.h"
+#include "boot_timeline.h"
+#include "bsim_identity.h"
 #include "events_svc.h"
+#include "fast_reconnect.h"
+#include "humidity_temperature_svc.h"
+#include "latency_stats.h"
+#include "periodic_adv.h"
 
 #include <zephyr/logging/log.h>
 
@@ -22,38 +37,163 @@ LOG_MODULE_REGISTER(ble_svc, LOG_LEVEL_INF);
 #define DEVICE_NAME                 CONFIG_BT_DEVICE_NAME
 #define DEVICE_NAME_LEN             (sizeof(DEVICE_NAME) - 1)
 #define COMPANY_ID_CODE             CONFIG_BT_COMPANY_ID
-#define ADV_INTERVAL_UNIT_MS        0.625
-#define CONNECTION_INTERVAL_UNIT_MS 1.25
+/* Integer units, no floating point in the logs and the advertising setup */
+#define CONNECTION_INTERVAL_UNIT_US 1250
 #define SUPERVISION_TIMEOUT_UNIT_MS 10
-#define MIN_ADV_INTERVAL            (CONFIG_MIN_ADV_INTERVAL_MS / ADV_INTERVAL_UNIT_MS)
-#define MAX_ADV_INTERVAL            (CONFIG_MAX_ADV_INTERVAL_MS / ADV_INTERVAL_UNIT_MS)
+/* In 0.625 ms units */
+#define ADV_INTERVAL(ms)            ((uint32_t)(ms) * 8U / 5U)
 #define MAX_ADV_PAYLOAD             31
+#define ADV_TEMPERATURE_UNKNOWN     ((int16_t)0x8000)
+#define ADV_HUMIDITY_UNKNOWN        0xFFFF
+#define SINT8_VALUE_UNKNOWN         INT8_MIN
+#define UINT16_VALUE_UNKNOWN        0xFFFF
+
+#define BT_UUID_ABSOLUTE_HUMIDITY_VAL                                                              \
+	BT_UUID_128_ENCODE(0x8b5a0020, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+#define BT_UUID_ABSOLUTE_HUMIDITY BT_UUID_DECLARE_128(BT_UUID_ABSOLUTE_HUMIDITY_VAL)
+
+/* ESS Trigger Setting conditions */
+#define ESS_TRIGGER_INACTIVE          0x00
+#define ESS_TRIGGER_FIXED_INTERVAL    0x01
+#define ESS_TRIGGER_MIN_INTERVAL      0x02
+#define ESS_TRIGGER_VALUE_CHANGED     0x03
+#define ESS_TRIGGER_LESS_THAN         0x04
+#define ESS_TRIGGER_LESS_OR_EQUAL     0x05
+#define ESS_TRIGGER_GREATER_THAN      0x06
+#define ESS_TRIGGER_GREATER_OR_EQUAL  0x07
+#define ESS_TRIGGER_EQUAL             0x08
+#define ESS_TRIGGER_NOT_EQUAL         0x09
+/* ESS application error code */
+#define ESS_ERR_CONDITION_UNSUPPORTED 0x81
+/* Measurements are rescheduled after they ran, fixed intervals allow for the resulting jitter */
+#define ESS_TRIGGER_TIME_TOLERANCE_MS 1000
+
+enum ess_channel {
+	ESS_CHANNEL_TEMPERATURE,
+	ESS_CHANNEL_HUMIDITY,
+	ESS_CHANNEL_DEW_POINT,
+	ESS_CHANNEL_HEAT_INDEX,
+	ESS_CHANNEL_ABSOLUTE_HUMIDITY,
+	ESS_CHANNEL_COUNT,
+};
+
+/* Attribute indexes of the characteristic declarations inside the service */
+#define TEMPERATURE_ATTR_IDX       1
+#define HUMIDITY_ATTR_IDX          7
+#define DEW_POINT_ATTR_IDX         13
+#define HEAT_INDEX_ATTR_IDX        19
+#define ABSOLUTE_HUMIDITY_ATTR_IDX 25
+
+/* Value format of a channel, the trigger operands use the same */
+struct ess_channel_info {
+	uint8_t attr_idx;
+	uint8_t size;
+	bool is_signed;
+};
+
+static const struct ess_channel_info ess_channels[ESS_CHANNEL_COUNT] = {
+	[ESS_CHANNEL_TEMPERATURE] = {TEMPERATURE_ATTR_IDX, sizeof(int16_t), true},
+	[ESS_CHANNEL_HUMIDITY] = {HUMIDITY_ATTR_IDX, sizeof(uint16_t), false},
+	[ESS_CHANNEL_DEW_POINT] = {DEW_POINT_ATTR_IDX, sizeof(int8_t), true},
+	[ESS_CHANNEL_HEAT_INDEX] = {HEAT_INDEX_ATTR_IDX, sizeof(int8_t), true},
+	[ESS_CHANNEL_ABSOLUTE_HUMIDITY] = {ABSOLUTE_HUMIDITY_ATTR_IDX, sizeof(uint16_t), false},
+};
+
+/*
+ * The operand holds seconds for the interval conditions. For the value conditions it has the unit
+ * of the characteristic: 0.01 °C, 0.01 % or 0.01 g/m³, whole °C for the sint8 dew point and heat
+ * index.
+ */
+struct ess_trigger {
+	uint8_t condition;
+	int32_t operand;
+	int32_t last_value; /* Last notified value */
+	int64_t last_time;  /* Uptime of the last notification in ms */
+	bool notified;
+	bool is_default; /* Not written by the client, notifies every measurement */
+};
+
+/* State of one connected central, indexed by bt_conn_index() */
+struct ble_conn_ctx {
+	struct bt_conn *conn; /* NULL if the slot is free */
+	bool reconnecting; /* Bonded central, until the link is encrypted with the stored keys */
+	bool subscribed[ESS_CHANNEL_COUNT];
+	struct ess_trigger triggers[ESS_CHANNEL_COUNT];
+};
 
+/*
+ * Thread-safety: The connection table is written from the BT RX thread (connection callbacks,
+ * CCC and trigger writes) and read by the notification fan-out on the system workqueue, all
+ * accesses hold conns_lock. It is never held across calls into the Bluetooth stack.
+ */
 struct ble_svc_data {
-	struct bt_conn *ble_connection;
 	atomic_t temperature;
 	atomic_t humidity;
+	atomic_t dew_point;
+	atomic_t heat_index;
+	atomic_t absolute_humidity;
+	struct k_spinlock conns_lock;
+	struct ble_conn_ctx conns[CONFIG_BT_MAX_CONN];
+	atomic_t update_interval; /* Measuring period in seconds */
+	atomic_t adv_min_ms;
+	atomic_t adv_max_ms;
 };
 
-static struct ble_svc_data data;
-
-static const struct bt_le_adv_param *adv_param =
-	BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONN, MIN_ADV_INTERVAL, MAX_ADV_INTERVAL,
-			NULL); /* Set to NULL for undirected advertising */
+#if defined(CONFIG_STATS)
+/* Notifications held back by a trigger, in the order of enum ess_channel */
+STATS_SECT_START(ess)
+STATS_SECT_ENTRY32(temp_suppr)
+STATS_SECT_ENTRY32(hum_suppr)
+STATS_SECT_ENTRY32(dew_suppr)
+STATS_SECT_ENTRY32(heat_suppr)
+STATS_SECT_ENTRY32(abs_hum_suppr)
+STATS_SECT_END;
+
+STATS_SECT_DECL(ess) ess;
+
+STATS_NAME_START(ess)
+STATS_NAME(ess, temp_suppr)
+STATS_NAME(ess, hum_suppr)
+STATS_NAME(ess, dew_suppr)
+STATS_NAME(ess, heat_suppr)
+STATS_NAME(ess, abs_hum_suppr)
+STATS_NAME_END(ess);
+
+BUILD_ASSERT(offsetof(STATS_SECT_TYPE(ess), abs_hum_suppr) -
+			     offsetof(STATS_SECT_TYPE(ess), temp_suppr) ==
+		     (ESS_CHANNEL_COUNT - 1) * sizeof(uint32_t),
+	     "Stat entries must follow enum ess_channel");
+#endif
+
+static struct ble_svc_data data = {
+	.temperature = ATOMIC_INIT(ADV_TEMPERATURE_UNKNOWN),
+	.humidity = ATOMIC_INIT(ADV_HUMIDITY_UNKNOWN),
+	.dew_point = ATOMIC_INIT(SINT8_VALUE_UNKNOWN),
+	.heat_index = ATOMIC_INIT(SINT8_VALUE_UNKNOWN),
+	.absolute_humidity = ATOMIC_INIT(UINT16_VALUE_UNKNOWN),
+	.update_interval = ATOMIC_INIT(CONFIG_MEASURING_PERIOD_SECONDS),
+	.adv_min_ms = ATOMIC_INIT(CONFIG_MIN_ADV_INTERVAL_MS),
+	.adv_max_ms = ATOMIC_INIT(CONFIG_MAX_ADV_INTERVAL_MS),
+};
 
+/* Live readings, all fields little endian */
 struct adv_manufacture_data {
-	uint16_t company_code;    /* Company Identifier Code. */
-	uint16_t btn_press_count; /* Number of times Button is pressed as a dummy data for now */
+	uint16_t company_code; /* Company Identifier Code. */
+	int16_t temperature;   /* Temperature in 0.01 °C, 0x8000 if not measured yet */
+	uint16_t humidity;     /* Humidity in 0.01 %, 0xFFFF if not measured yet */
+	uint8_t seq;           /* Incremented on every measurement, lets scanners drop duplicates */
+} __packed;
+
+static struct adv_manufacture_data manufacture_data = {
+	.company_code = sys_cpu_to_le16(COMPANY_ID_CODE),
+	.temperature = sys_cpu_to_le16(ADV_TEMPERATURE_UNKNOWN),
+	.humidity = sys_cpu_to_le16(ADV_HUMIDITY_UNKNOWN),
 };
 
-static struct adv_manufacture_data manufacture_data = {COMPANY_ID_CODE, sys_cpu_to_le16(0x00)};
-
 /* Advertising packet (Max size is 31 bytes) */
 static const struct bt_data ad[] = {
 	/* 3 bytes (Type, flag, length) */
 	BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
-	/* 4 bytes (Type + Length + UUID) - Environmental Sensing Service UUID (0x181A in LE) */
-	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_ESS_VAL)),
 	/* [2 bytes (Type +  length)] + DEVICE_NAME_LEN bytes */
 	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
 	/* [2 bytes (Type +  length)] + size of adv_manufacture_data struct */
@@ -69,10 +209,20 @@ static unsigned char url_data[] = {0x17, '/', '/', 'g', 'i', 't', 'h', 'u', 'b',
 
 /* Scan response packet (Max size is 31 bytes) */
 static const struct bt_data sd[] = {
+	/* 4 bytes (Type + Length + UUID) - Environmental Sensing Service UUID (0x181A in LE).
+	 * Moved to the scan response to make room for the readings in the advertising packet.
+	 */
+	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_ESS_VAL)),
 	/* [2 bytes (Type +  length)] + length of the data (URL) */
 	BT_DATA(BT_DATA_URI, url_data, sizeof(url_data)),
 };
 
+/* Periodic advertising data, the same readings without the legacy advertising packet limits */
+static const struct bt_data per_ad[] = {
+	BT_DATA(BT_DATA_MANUFACTURER_DATA, (unsigned char *)&manufacture_data,
+		sizeof(manufacture_data)),
+};
+
 static void update_phy(struct bt_conn *conn)
 {
 	int ret;
@@ -100,29 +250,145 @@ static void update_data_length(struct bt_conn *conn)
 	}
 }
 
+static void adv_start(void)
+{
+	/* Undirected, the intervals can change at runtime */
+	struct bt_le_adv_param adv_param = BT_LE_ADV_PARAM_INIT(
+		BT_LE_ADV_OPT_CONN, ADV_INTERVAL(atomic_get(&data.adv_min_ms)),
+		ADV_INTERVAL(atomic_get(&data.adv_max_ms)), NULL);
+	bool directed = false;
+	int ret;
+
+	if (IS_ENABLED(CONFIG_BLE_FAST_RECONNECT)) {
+		directed = fast_reconnect_adv_param(&adv_param);
+	}
+
+	if (directed) {
+		/* Directed advertising carries no data */
+		ret = bt_le_adv_start(&adv_param, NULL, 0, NULL, 0);
+	} else {
+		ret = bt_le_adv_start(&adv_param, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+	}
+	if (ret == -EALREADY) {
+		return;
+	}
+	if (ret == -ENOMEM) {
+		/* All connection objects in use, restarted once one is recycled */
+		LOG_DBG("No free connection, not advertising");
+		return;
+	}
+	if (ret) {
+		LOG_ERR("Advertising failed to start %d", ret);
+		return;
+	}
+
+	boot_timeline_mark(BOOT_PHASE_ADVERTISING);
+	LOG_INF("Advertising successfully started%s", directed ? " (directed)" : "");
+}
+
+static void adv_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	adv_start();
+}
+static K_WORK_DEFINE(adv_work, adv_work_handler);
+
+static void adv_restart_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	int ret;
+
+	ret = bt_le_adv_stop();
+	if (ret != 0) {
+		LOG_WRN("Advertising failed to stop %d", ret);
+		return;
+	}
+
+	adv_start();
+}
+static K_WORK_DEFINE(adv_restart_work, adv_restart_work_handler);
+
+static void ess_subscriptions_sync(struct bt_conn *conn);
+
+/* Until the client writes a trigger, every measurement is notified */
+static void conn_ctx_init(struct ble_conn_ctx *ctx, struct bt_conn *conn)
+{
+	*ctx = (struct ble_conn_ctx){
+		.conn = bt_conn_ref(conn),
+	};
+
+	for (size_t i = 0; i < ESS_CHANNEL_COUNT; i++) {
+		ctx->triggers[i] = (struct ess_trigger){
+			.condition = ESS_TRIGGER_FIXED_INTERVAL,
+			.is_default = true,
+		};
+	}
+}
+
+/* Asks a bonded central to re-encrypt, returns true if the central is bonded */
+static bool bonded_reconnect_start(struct bt_conn *conn)
+{
+#if defined(CONFIG_BT_SMP)
+	int ret;
+
+	if (!bt_le_bond_exists(BT_ID_DEFAULT, bt_conn_get_dst(conn))) {
+		return false;
+	}
+
+	/* The restored subscriptions are only trusted once the central proved its keys */
+	ret = bt_conn_set_security(conn, BT_SECURITY_L2);
+	if (ret != 0) {
+		LOG_WRN("Failed to request encryption (ret %d)", ret);
+		return false;
+	}
+
+	return true;
+#else
+	ARG_UNUSED(conn);
+
+	return false;
+#endif
+}
+
 static void on_connected(struct bt_conn *conn, uint8_t ret)
 {
 	struct event evt;
 	struct bt_conn_info info;
-	double connection_interval;
-	uint16_t supervision_timeout;
 	char addr[BT_ADDR_LE_STR_LEN];
+	bool info_valid;
+	bool reconnecting;
+	k_spinlock_key_t key;
 
 	if (ret != 0) {
-		LOG_WRN("Connection failed (ret %u)", ret);
+		if (IS_ENABLED(CONFIG_BLE_FAST_RECONNECT) && ret == BT_HCI_ERR_ADV_TIMEOUT) {
+			LOG_INF("Directed advertising timed out");
+			fast_reconnect_directed_timeout();
+		} else {
+			LOG_WRN("Connection failed (ret %u)", ret);
+		}
+		k_work_submit(&adv_work);
 		return;
 	}
 
-	data.ble_connection = bt_conn_ref(conn);
+	info_valid = (bt_conn_get_info(conn, &info) == 0);
+	reconnecting = bonded_reconnect_start(conn);
 
-	if (bt_conn_get_info(conn, &info) == 0) {
-		bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+	key = k_spin_lock(&data.conns_lock);
+	conn_ctx_init(&data.conns[bt_conn_index(conn)], conn);
+	data.conns[bt_conn_index(conn)].reconnecting = reconnecting;
+	k_spin_unlock(&data.conns_lock, key);
 
-		connection_interval = info.le.interval * CONNECTION_INTERVAL_UNIT_MS;
+	ess_subscriptions_sync(conn);
+
+	if (info_valid) {
+		bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
 		LOG_INF("Connection established! Connected to: %s", addr);
-		LOG_DBG("Connection parameters: interval %.2f ms, latency %d, timeout %d ms",
-			connection_interval, info.le.latency, supervision_timeout);
+		LOG_DBG("Connection parameters: interval %u us, latency %u, timeout %u ms",
+			info.le.interval * CONNECTION_INTERVAL_UNIT_US, info.le.latency,
+			info.le.timeout * SUPERVISION_TIMEOUT_UNIT_MS);
 	} else {
 		LOG_WRN("Could not parse connection info");
 	}
@@ -130,29 +396,35 @@ static void on_connected(struct bt_conn *conn, uint8_t ret)
 	update_phy(conn);
 	update_data_length(conn);
 
+	/* Stay connectable for further centrals while connection objects are left */
+	k_work_submit(&adv_work);
+
 	evt.type = EVENT_BLE_CONNECTED;
-	if (events_svc_send_event(&evt) != 0) {
-		LOG_WRN("Event queue full, connected event dropped");
-	}
+	evt.conn.conn_index = bt_conn_index(conn);
+	events_svc_publish(&evt);
 }
 
 static void on_disconnected(struct bt_conn *conn, uint8_t reason)
 {
 	struct event evt;
+	struct ble_conn_ctx *ctx = &data.conns[bt_conn_index(conn)];
 	struct bt_conn *old;
+	k_spinlock_key_t key;
 
 	LOG_DBG("Disconnected (reason %u)", reason);
 
-	old = data.ble_connection;
-	data.ble_connection = NULL;
+	key = k_spin_lock(&data.conns_lock);
+	old = ctx->conn;
+	ctx->conn = NULL;
+	k_spin_unlock(&data.conns_lock, key);
+
 	if (old) {
 		bt_conn_unref(old);
 	}
 
 	evt.type = EVENT_BLE_NOT_CONNECTED;
-	if (events_svc_send_event(&evt) != 0) {
-		LOG_WRN("Event queue full, disconnected event dropped");
-	}
+	evt.conn.conn_index = bt_conn_index(conn);
+	events_svc_publish(&evt);
 }
 
 static bool on_le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param)
@@ -168,11 +440,22 @@ static bool on_le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param
 static void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
 				uint16_t timeout)
 {
-	double connection_interval = interval * CONNECTION_INTERVAL_UNIT_MS;
-	uint16_t supervision_timeout = timeout * SUPERVISION_TIMEOUT_UNIT_MS;
-	LOG_DBG("Connection parameters updated: interval %.2f ms, latency %d intervals, timeout %d "
+	struct event evt = {
+		.type = EVENT_BLE_CONN_PARAMS_CHANGED,
+		.conn_params = {
+			.conn_index = bt_conn_index(conn),
+			.interval = interval,
+			.latency = latency,
+			.timeout = timeout,
+		},
+	};
+
+	events_svc_publish(&evt);
+
+	LOG_DBG("Connection parameters updated: interval %u us, latency %u intervals, timeout %u "
 		"ms",
-		connection_interval, latency, supervision_timeout);
+		interval * CONNECTION_INTERVAL_UNIT_US, latency,
+		timeout * SUPERVISION_TIMEOUT_UNIT_MS);
 }
 
 static void on_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
@@ -201,6 +484,43 @@ static void ble_srv_att_mtu_updated(struct bt_conn *conn, uint16_t tx, uint16_t
 	LOG_DBG("ATT MTU: TX = %u bytes, RX = %u bytes", tx, rx);
 }
 
+static void on_recycled(void)
+{
+	k_work_submit(&adv_work);
+}
+
+#if defined(CONFIG_BT_SMP)
+static void on_security_changed(struct bt_conn *conn, bt_security_t level,
+				enum bt_security_err err)
+{
+	struct ble_conn_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	struct event evt;
+	bool reconnected = false;
+	k_spinlock_key_t key;
+
+	if (err != BT_SECURITY_ERR_SUCCESS) {
+		LOG_WRN("Security failed (err %d)", err);
+		return;
+	}
+
+	/* A central using a resolvable private address is only known by its identity now */
+	ess_subscriptions_sync(conn);
+
+	key = k_spin_lock(&data.conns_lock);
+	if (ctx->conn == conn && ctx->reconnecting && level >= BT_SECURITY_L2) {
+		ctx->reconnecting = false;
+		reconnected = true;
+	}
+	k_spin_unlock(&data.conns_lock, key);
+
+	if (reconnected) {
+		evt.type = EVENT_BLE_RECONNECTED;
+		evt.conn.conn_index = bt_conn_index(conn);
+		events_svc_publish(&evt);
+	}
+}
+#endif
+
 static struct bt_gatt_cb ble_srv_gatt_cb = {
 	.att_mtu_updated = ble_srv_att_mtu_updated,
 };
@@ -212,6 +532,10 @@ static struct bt_conn_cb conn_callbacks = {
 	.le_param_updated = on_le_param_updated,
 	.le_phy_updated = on_le_phy_updated,
 	.le_data_len_updated = on_le_data_len_updated,
+	.recycled = on_recycled,
+#if defined(CONFIG_BT_SMP)
+	.security_changed = on_security_changed,
+#endif
 };
 
 static void temperature_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
@@ -232,6 +556,67 @@ static void humidity_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value
 	LOG_DBG("Humidity Notifications %s", notif_enabled ? "enabled" : "disabled");
 }
 
+static void derived_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	bool notif_enabled = (value == BT_GATT_CCC_NOTIFY);
+
+	LOG_DBG("Derived metric Notifications %s", notif_enabled ? "enabled" : "disabled");
+}
+
+/* Mirrors the CCC value of the writing central into its connection context */
+static ssize_t ess_ccc_write(struct bt_conn *conn, enum ess_channel channel, uint16_t value)
+{
+	struct ble_conn_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	k_spinlock_key_t key = k_spin_lock(&data.conns_lock);
+
+	ctx->subscribed[channel] = (value & BT_GATT_CCC_NOTIFY) != 0;
+	k_spin_unlock(&data.conns_lock, key);
+
+	return sizeof(value);
+}
+
+static ssize_t temperature_ccc_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				     uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	return ess_ccc_write(conn, ESS_CHANNEL_TEMPERATURE, value);
+}
+
+static ssize_t humidity_ccc_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				  uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	return ess_ccc_write(conn, ESS_CHANNEL_HUMIDITY, value);
+}
+
+static ssize_t dew_point_ccc_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				   uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	return ess_ccc_write(conn, ESS_CHANNEL_DEW_POINT, value);
+}
+
+static ssize_t heat_index_ccc_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				    uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	return ess_ccc_write(conn, ESS_CHANNEL_HEAT_INDEX, value);
+}
+
+static ssize_t absolute_humidity_ccc_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+					   uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	return ess_ccc_write(conn, ESS_CHANNEL_ABSOLUTE_HUMIDITY, value);
+}
+
 static ssize_t read_temperature(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
 				uint16_t len, uint16_t offset)
 {
@@ -248,6 +633,31 @@ static ssize_t read_humidity(struct bt_conn *conn, const struct bt_gatt_attr *at
 	return bt_gatt_attr_read(conn, attr, buf, len, offset, &humidity, sizeof(humidity));
 }
 
+static ssize_t read_dew_point(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+			      uint16_t len, uint16_t offset)
+{
+	int8_t dew_point = (int8_t)atomic_get(&data.dew_point);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &dew_point, sizeof(dew_point));
+}
+
+static ssize_t read_heat_index(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+			       uint16_t len, uint16_t offset)
+{
+	int8_t heat_index = (int8_t)atomic_get(&data.heat_index);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &heat_index, sizeof(heat_index));
+}
+
+static ssize_t read_absolute_humidity(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				      void *buf, uint16_t len, uint16_t offset)
+{
+	uint16_t absolute_humidity = (uint16_t)atomic_get(&data.absolute_humidity);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &absolute_humidity,
+				 sizeof(absolute_humidity));
+}
+
 /* Constant values from the Assigned Numbers specification:
  * https://www.bluetooth.com/wp-content/uploads/Files/Specification/Assigned_Numbers.pdf?id=89
  * Per ESS spec: Temperature in 0.01°C, Humidity in 0.01% (exponent = -2)
@@ -268,56 +678,452 @@ static const struct bt_gatt_cpf humidity_cpf = {
 	.description = 0x0106, /* "main" */
 };
 
+/* Dew Point (0x2A7B) and Heat Index (0x2A7A) are sint8 in whole degrees per the ESS spec */
+static const struct bt_gatt_cpf dew_point_cpf = {
+	.format = 0x0C,        /* signed 8-bit integer */
+	.exponent = 0,         /* 1 °C resolution */
+	.unit = 0x272F,        /* degree Celsius */
+	.name_space = 0x01,    /* Bluetooth SIG */
+	.description = 0x0106, /* "main" */
+};
+
+static const struct bt_gatt_cpf heat_index_cpf = {
+	.format = 0x0C,        /* signed 8-bit integer */
+	.exponent = 0,         /* 1 °C resolution */
+	.unit = 0x272F,        /* degree Celsius */
+	.name_space = 0x01,    /* Bluetooth SIG */
+	.description = 0x0106, /* "main" */
+};
+
+/* ESS has no absolute humidity characteristic, the vendor one is a mass density */
+static const struct bt_gatt_cpf absolute_humidity_cpf = {
+	.format = 0x06,        /* unsigned 16-bit integer */
+	.exponent = -5,        /* value = raw * 10^-5 kg/m³ (0.01 g/m³ resolution) */
+	.unit = 0x2715,        /* kilogram per cubic metre */
+	.name_space = 0x01,    /* Bluetooth SIG */
+	.description = 0x0106, /* "main" */
+};
+
+/* ES Measurement descriptor (0x290C) */
+struct es_measurement {
+	uint16_t flags;
+	uint8_t sampling_function;
+	uint8_t measurement_period[3];
+	uint8_t update_interval[3];
+	uint8_t application;
+	uint8_t uncertainty;
+} __packed;
+
+static const struct es_measurement temperature_es_measurement = {
+	.flags = 0,
+	.sampling_function = 0x01, /* Instantaneous */
+	.measurement_period = {BT_BYTES_LIST_LE24(0)},
+	.update_interval = {BT_BYTES_LIST_LE24(CONFIG_MEASURING_PERIOD_SECONDS)},
+	.application = 0x01, /* Air */
+	.uncertainty = 0x02, /* In 0.5 % steps: +-0.2 °C typical for the SHT40 */
+};
+
+static const struct es_measurement humidity_es_measurement = {
+	.flags = 0,
+	.sampling_function = 0x01, /* Instantaneous */
+	.measurement_period = {BT_BYTES_LIST_LE24(0)},
+	.update_interval = {BT_BYTES_LIST_LE24(CONFIG_MEASURING_PERIOD_SECONDS)},
+	.application = 0x01, /* Air */
+	.uncertainty = 0x04, /* In 0.5 % steps: +-1.8 %RH typical for the SHT40 */
+};
+
+/* Computed from temperature and humidity after every measurement */
+static const struct es_measurement derived_es_measurement = {
+	.flags = 0,
+	.sampling_function = 0x01, /* Instantaneous */
+	.measurement_period = {BT_BYTES_LIST_LE24(0)},
+	.update_interval = {BT_BYTES_LIST_LE24(CONFIG_MEASURING_PERIOD_SECONDS)},
+	.application = 0x01, /* Air */
+	.uncertainty = 0xFF, /* Information not available */
+};
+
+static ssize_t read_es_measurement(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				   void *buf, uint16_t len, uint16_t offset)
+{
+	struct es_measurement value = *(const struct es_measurement *)attr->user_data;
+
+	/* The measuring period can change at runtime */
+	sys_put_le24((uint32_t)atomic_get(&data.update_interval), value.update_interval);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &value, sizeof(value));
+}
+
+static ssize_t read_trigger_setting(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				    void *buf, uint16_t len, uint16_t offset)
+{
+	enum ess_channel channel = POINTER_TO_UINT(attr->user_data);
+	struct ess_trigger trigger;
+	uint8_t value[4];
+	uint16_t value_len = 1;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data.conns_lock);
+	trigger = data.conns[bt_conn_index(conn)].triggers[channel];
+	k_spin_unlock(&data.conns_lock, key);
+
+	/* The default reads as the announced update interval, which can change at runtime */
+	if (trigger.is_default) {
+		trigger.operand = (int32_t)atomic_get(&data.update_interval);
+	}
+
+	value[0] = trigger.condition;
+
+	switch (trigger.condition) {
+	case ESS_TRIGGER_FIXED_INTERVAL:
+	case ESS_TRIGGER_MIN_INTERVAL:
+		sys_put_le24(trigger.operand, &value[1]);
+		value_len += 3;
+		break;
+
+	case ESS_TRIGGER_VALUE_CHANGED:
+		if (trigger.operand == 0) {
+			break;
+		}
+		__fallthrough;
+
+	case ESS_TRIGGER_LESS_THAN ... ESS_TRIGGER_NOT_EQUAL:
+		if (ess_channels[channel].size == 1) {
+			value[1] = (uint8_t)trigger.operand;
+		} else {
+			sys_put_le16(trigger.operand, &value[1]);
+		}
+		value_len += ess_channels[channel].size;
+		break;
+
+	default:
+		break;
+	}
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value, value_len);
+}
+
+/*
+ * Conditions 0x00 - 0x09 of the ESS Trigger Setting descriptor. As an extension, "value
+ * changed" (0x03) accepts an optional operand: a deadband the value has to move by before it is
+ * notified again.
+ */
+static ssize_t write_trigger_setting(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+				     const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	enum ess_channel channel = POINTER_TO_UINT(attr->user_data);
+	const uint8_t *value = buf;
+	struct ess_trigger trigger = {0};
+	k_spinlock_key_t key;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	if (len < 1) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	trigger.condition = value[0];
+
+	switch (trigger.condition) {
+	case ESS_TRIGGER_INACTIVE:
+		if (len != 1) {
+			return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+		}
+		break;
+
+	case ESS_TRIGGER_FIXED_INTERVAL:
+	case ESS_TRIGGER_MIN_INTERVAL:
+		if (len != 4) {
+			return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+		}
+		trigger.operand = sys_get_le24(&value[1]);
+		break;
+
+	case ESS_TRIGGER_VALUE_CHANGED:
+		if (len == 1) {
+			break;
+		}
+		__fallthrough;
+
+	case ESS_TRIGGER_LESS_THAN ... ESS_TRIGGER_NOT_EQUAL:
+		/* The operand has the format of the characteristic value */
+		if (len != 1 + ess_channels[channel].size) {
+			return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+		}
+		if (ess_channels[channel].size == 1) {
+			trigger.operand = ess_channels[channel].is_signed ? (int8_t)value[1]
+									  : value[1];
+		} else {
+			trigger.operand = ess_channels[channel].is_signed
+						  ? (int16_t)sys_get_le16(&value[1])
+						  : sys_get_le16(&value[1]);
+		}
+		break;
+
+	default:
+		return BT_GATT_ERR(ESS_ERR_CONDITION_UNSUPPORTED);
+	}
+
+	key = k_spin_lock(&data.conns_lock);
+	data.conns[bt_conn_index(conn)].triggers[channel] = trigger;
+	k_spin_unlock(&data.conns_lock, key);
+
+	LOG_DBG("Trigger of channel %d set to condition %u, operand %d", channel,
+		trigger.condition, trigger.operand);
+
+	return len;
+}
+
 BT_GATT_SERVICE_DEFINE(environmental_sensing_service, BT_GATT_PRIMARY_SERVICE(BT_UUID_ESS),
 		       BT_GATT_CHARACTERISTIC(BT_UUID_TEMPERATURE,
 					      BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
 					      BT_GATT_PERM_READ, read_temperature, NULL, NULL),
-		       BT_GATT_CCC(temperature_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+		       BT_GATT_CCC_WITH_WRITE_CB(temperature_cfg_changed, temperature_ccc_write,
+						 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 		       BT_GATT_CPF(&temperature_cpf),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+					  read_es_measurement, NULL,
+					  (void *)&temperature_es_measurement),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+					  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+					  read_trigger_setting, write_trigger_setting,
+					  UINT_TO_POINTER(ESS_CHANNEL_TEMPERATURE)),
 		       BT_GATT_CHARACTERISTIC(BT_UUID_HUMIDITY,
 					      BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
 					      BT_GATT_PERM_READ, read_humidity, NULL, NULL),
-		       BT_GATT_CCC(humidity_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
-		       BT_GATT_CPF(&humidity_cpf), );
+		       BT_GATT_CCC_WITH_WRITE_CB(humidity_cfg_changed, humidity_ccc_write,
+						 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+		       BT_GATT_CPF(&humidity_cpf),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+					  read_es_measurement, NULL,
+					  (void *)&humidity_es_measurement),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+					  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+					  read_trigger_setting, write_trigger_setting,
+					  UINT_TO_POINTER(ESS_CHANNEL_HUMIDITY)),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_DEW_POINT,
+					      BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+					      BT_GATT_PERM_READ, read_dew_point, NULL, NULL),
+		       BT_GATT_CCC_WITH_WRITE_CB(derived_cfg_changed, dew_point_ccc_write,
+						 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+		       BT_GATT_CPF(&dew_point_cpf),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+					  read_es_measurement, NULL,
+					  (void *)&derived_es_measurement),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+					  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+					  read_trigger_setting, write_trigger_setting,
+					  UINT_TO_POINTER(ESS_CHANNEL_DEW_POINT)),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_HEAT_INDEX,
+					      BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+					      BT_GATT_PERM_READ, read_heat_index, NULL, NULL),
+		       BT_GATT_CCC_WITH_WRITE_CB(derived_cfg_changed, heat_index_ccc_write,
+						 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+		       BT_GATT_CPF(&heat_index_cpf),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+					  read_es_measurement, NULL,
+					  (void *)&derived_es_measurement),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+					  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+					  read_trigger_setting, write_trigger_setting,
+					  UINT_TO_POINTER(ESS_CHANNEL_HEAT_INDEX)),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_ABSOLUTE_HUMIDITY,
+					      BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+					      BT_GATT_PERM_READ, read_absolute_humidity, NULL,
+					      NULL),
+		       BT_GATT_CCC_WITH_WRITE_CB(derived_cfg_changed, absolute_humidity_ccc_write,
+						 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+		       BT_GATT_CPF(&absolute_humidity_cpf),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+					  read_es_measurement, NULL,
+					  (void *)&derived_es_measurement),
+		       BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+					  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+					  read_trigger_setting, write_trigger_setting,
+					  UINT_TO_POINTER(ESS_CHANNEL_ABSOLUTE_HUMIDITY)), );
 
-int ble_svc_update_temperature_value(float temp_value)
+/*
+ * The CCC values of a bonded central are restored by the stack without a write, so
+ * ess_ccc_write() does not see them. Reads them from the stack into the connection context.
+ */
+static void ess_subscriptions_sync(struct bt_conn *conn)
 {
-	int ret;
-	struct bt_conn *conn;
-	int16_t temperature;
+	struct ble_conn_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	bool subscribed[ESS_CHANNEL_COUNT];
+	k_spinlock_key_t key;
 
-	if (temp_value > 125 || temp_value < -20) {
-		return -EINVAL;
+	for (size_t i = 0; i < ESS_CHANNEL_COUNT; i++) {
+		const struct bt_gatt_attr *attr =
+			&environmental_sensing_service.attrs[ess_channels[i].attr_idx];
+
+		subscribed[i] = bt_gatt_is_subscribed(conn, attr, BT_GATT_CCC_NOTIFY);
 	}
 
-	temperature = (int16_t)(temp_value * 100);
-	atomic_set(&data.temperature, temperature);
-	conn = data.ble_connection;
+	key = k_spin_lock(&data.conns_lock);
+	if (ctx->conn == conn) {
+		memcpy(ctx->subscribed, subscribed, sizeof(ctx->subscribed));
+	}
+	k_spin_unlock(&data.conns_lock, key);
+}
 
-	ret = bt_gatt_notify(conn, &environmental_sensing_service.attrs[1], &temperature,
-			     sizeof(temperature));
+static bool ess_trigger_met(const struct ess_trigger *trigger, int32_t value, int64_t now)
+{
+	int64_t elapsed_ms = now - trigger->last_time;
+	int64_t interval_ms = (int64_t)trigger->operand * MSEC_PER_SEC;
+
+	/*
+	 * The measuring period can be shorter than the announced interval, e.g. with adaptive
+	 * sampling, the default must not hold those measurements back
+	 */
+	if (trigger->is_default) {
+		return true;
+	}
 
-	return ret == -ENOTCONN ? 0 : ret;
+	switch (trigger->condition) {
+	case ESS_TRIGGER_FIXED_INTERVAL:
+		return !trigger->notified ||
+		       elapsed_ms + ESS_TRIGGER_TIME_TOLERANCE_MS >= interval_ms;
+	case ESS_TRIGGER_MIN_INTERVAL:
+		/* Never more often than the interval */
+		return !trigger->notified || elapsed_ms >= interval_ms;
+	case ESS_TRIGGER_VALUE_CHANGED:
+		return !trigger->notified || abs(value - trigger->last_value) > trigger->operand;
+	case ESS_TRIGGER_LESS_THAN:
+		return value < trigger->operand;
+	case ESS_TRIGGER_LESS_OR_EQUAL:
+		return value <= trigger->operand;
+	case ESS_TRIGGER_GREATER_THAN:
+		return value > trigger->operand;
+	case ESS_TRIGGER_GREATER_OR_EQUAL:
+		return value >= trigger->operand;
+	case ESS_TRIGGER_EQUAL:
+		return value == trigger->operand;
+	case ESS_TRIGGER_NOT_EQUAL:
+		return value != trigger->operand;
+	default:
+		return false;
+	}
 }
 
-int ble_svc_update_humidity_value(float hum_value)
+/*
+ * Notifies the value to every subscribed central whose trigger condition is met, in one pass
+ * over the connection table.
+ */
+static int ess_notify(enum ess_channel channel, int32_t value, const void *buf, uint16_t len)
 {
-	int ret;
-	struct bt_conn *conn;
-	uint16_t humidity;
+	const struct bt_gatt_attr *attr =
+		&environmental_sensing_service.attrs[ess_channels[channel].attr_idx];
+	int64_t now = k_uptime_get();
+	int err = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(data.conns); i++) {
+		struct ble_conn_ctx *ctx = &data.conns[i];
+		struct bt_conn *conn = NULL;
+		k_spinlock_key_t key;
+		bool met = false;
+		uint32_t start;
+		int ret;
+
+		key = k_spin_lock(&data.conns_lock);
+		/* Live values resume once the missed measurements are replayed */
+		if (ctx->conn != NULL && ctx->subscribed[channel] &&
+		    !(IS_ENABLED(CONFIG_BACKFILL) && backfill_svc_is_replaying(ctx->conn))) {
+			conn = bt_conn_ref(ctx->conn);
+			met = ess_trigger_met(&ctx->triggers[channel], value, now);
+		}
+		k_spin_unlock(&data.conns_lock, key);
+
+		if (conn == NULL) {
+			continue;
+		}
+
+		if (!met) {
+#if defined(CONFIG_STATS)
+			(&ess.temp_suppr)[channel]++;
+#endif
+			LOG_DBG("Notification of channel %d to connection %zu suppressed", channel,
+				i);
+			bt_conn_unref(conn);
+			continue;
+		}
+
+		start = LATENCY_STATS_TIMESTAMP();
+		ret = bt_gatt_notify(conn, attr, buf, len);
+		latency_stats_record(LATENCY_STAGE_GATT_NOTIFY, start);
+		latency_stats_notify_result(ret);
+		if (ret == 0) {
+			key = k_spin_lock(&data.conns_lock);
+			if (ctx->conn == conn) {
+				ctx->triggers[channel].last_value = value;
+				ctx->triggers[channel].last_time = now;
+				ctx->triggers[channel].notified = true;
+			}
+			k_spin_unlock(&data.conns_lock, key);
+		} else if (ret != -ENOTCONN && err == 0) {
+			err = ret;
+		}
+
+		bt_conn_unref(conn);
+	}
 
-	if (hum_value > 100 || hum_value < 0) {
+	return err;
+}
+
+int ble_svc_update_temperature_value(int16_t temperature)
+{
+	if (!IN_RANGE(temperature, SENSOR_TEMP_CENTI_MIN, SENSOR_TEMP_CENTI_MAX)) {
+		return -EINVAL;
+	}
+
+	atomic_set(&data.temperature, temperature);
+
+	return ess_notify(ESS_CHANNEL_TEMPERATURE, temperature, &temperature, sizeof(temperature));
+}
+
+int ble_svc_update_humidity_value(uint16_t humidity)
+{
+	if (humidity > SENSOR_HUMIDITY_CENTI_MAX) {
 		return -EINVAL;
 	}
 
-	humidity = (uint16_t)(hum_value * 100);
 	atomic_set(&data.humidity, humidity);
-	conn = data.ble_connection;
 
-	ret = bt_gatt_notify(conn, &environmental_sensing_service.attrs[5], &humidity,
-			     sizeof(humidity));
+	return ess_notify(ESS_CHANNEL_HUMIDITY, humidity, &humidity, sizeof(humidity));
+}
+
+/* Rounds 0.01 °C to the whole degrees of the sint8 characteristics */
+static int8_t centi_to_sint8(int16_t value)
+{
+	return (int8_t)CLAMP(DIV_ROUND_CLOSEST(value, 100), INT8_MIN + 1, INT8_MAX);
+}
+
+int ble_svc_update_dew_point_value(int16_t dew_point)
+{
+	int8_t value = centi_to_sint8(dew_point);
+
+	atomic_set(&data.dew_point, value);
 
-	return ret == -ENOTCONN ? 0 : ret;
+	return ess_notify(ESS_CHANNEL_DEW_POINT, value, &value, sizeof(value));
+}
+
+int ble_svc_update_heat_index_value(int16_t heat_index)
+{
+	int8_t value = centi_to_sint8(heat_index);
+
+	atomic_set(&data.heat_index, value);
+
+	return ess_notify(ESS_CHANNEL_HEAT_INDEX, value, &value, sizeof(value));
+}
+
+int ble_svc_update_absolute_humidity_value(uint16_t absolute_humidity)
+{
+	/* 0xFFFF means unknown */
+	uint16_t value = MIN(absolute_humidity, UINT16_VALUE_UNKNOWN - 1);
+
+	atomic_set(&data.absolute_humidity, value);
+
+	return ess_notify(ESS_CHANNEL_ABSOLUTE_HUMIDITY, value, &value, sizeof(value));
 }
 
 static int ble_get_payload_size(const struct bt_data *data_array, size_t array_size)
@@ -338,13 +1144,22 @@ static void bt_ready(int ret)
 		return;
 	}
 
-	ret = bt_le_adv_start(adv_param, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
-	if (ret) {
-		LOG_ERR("Advertising failed to start %d", ret);
-		return;
+	if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+		/* Identity, bonds, CCC values and the GATT database hash */
+		ret = settings_load_subtree("bt");
+		if (ret != 0) {
+			LOG_ERR("Failed to load the Bluetooth settings %d", ret);
+		}
 	}
 
-	LOG_INF("Advertising successfully started");
+	boot_timeline_mark(BOOT_PHASE_BT_READY);
+
+	adv_start();
+
+	if (IS_ENABLED(CONFIG_BLE_PERIODIC_ADV)) {
+		/* Failing leaves the connectable advertising for commissioning and DFU running */
+		(void)periodic_adv_start(per_ad, ARRAY_SIZE(per_ad));
+	}
 }
 
 /*
@@ -352,11 +1167,84 @@ static void bt_ready(int ret)
  * The manufacture_data is not mutex-protected; concurrent access from multiple contexts
  * would cause a race condition.
  */
-void ble_svc_increase_button_press_cnt(void)
+int ble_svc_update_advertising_data(void)
+{
+	int ret;
+
+	manufacture_data.temperature = sys_cpu_to_le16((int16_t)atomic_get(&data.temperature));
+	manufacture_data.humidity = sys_cpu_to_le16((uint16_t)atomic_get(&data.humidity));
+	manufacture_data.seq++;
+
+	if (IS_ENABLED(CONFIG_BLE_PERIODIC_ADV)) {
+		/* The periodic train keeps running while connected */
+		ret = periodic_adv_update(per_ad, ARRAY_SIZE(per_ad));
+		if (ret != 0) {
+			LOG_WRN("Failed to update periodic advertising data: %d", ret);
+		}
+	}
+
+	ret = bt_le_adv_update_data(ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+
+	/* Not advertising while connected, the next advertising start picks up the new data */
+	return ret == -EAGAIN ? 0 : ret;
+}
+
+void ble_svc_set_update_interval(uint32_t seconds)
+{
+	atomic_set(&data.update_interval, seconds);
+}
+
+void ble_svc_set_adv_interval(uint32_t min_ms, uint32_t max_ms)
+{
+	atomic_set(&data.adv_min_ms, min_ms);
+	atomic_set(&data.adv_max_ms, max_ms);
+}
+
+void ble_svc_restart_advertising(void)
+{
+	k_work_submit(&adv_restart_work);
+}
+
+/*
+ * A Static Random Address is a 48-bit (6-byte) address structured as follows:
+ * Most significant two bits (MSBs) of the first byte must be 11 (bin) C0, D0, E0, F0 (HEX).
+ * The remaining 46 bits are random, neither all zero nor all one, and remain constant. They are
+ * folded from the unique device ID, so every unit keeps its own address across reflashing.
+ */
+static int identity_from_device_id(bt_addr_le_t *addr)
 {
-	manufacture_data.btn_press_count++;
+	uint8_t id[16];
+	bool zero = true;
+	bool ones = true;
+	ssize_t len;
+
+	len = hwinfo_get_device_id(id, sizeof(id));
+	if (len < 0) {
+		return (int)len;
+	}
+	if (len == 0) {
+		return -ENODATA;
+	}
+
+	*addr = (bt_addr_le_t){.type = BT_ADDR_LE_RANDOM};
+	for (size_t i = 0; i < (size_t)len; i++) {
+		addr->a.val[i % sizeof(addr->a.val)] ^= id[i];
+	}
+	addr->a.val[5] &= 0x3F;
+
+	for (size_t i = 0; i < sizeof(addr->a.val); i++) {
+		uint8_t all = (i == 5) ? 0x3F : 0xFF;
+
+		zero = zero && addr->a.val[i] == 0;
+		ones = ones && addr->a.val[i] == all;
+	}
+	if (zero || ones) {
+		addr->a.val[0] ^= 0x01;
+	}
 
-	bt_le_adv_update_data(ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+	BT_ADDR_SET_STATIC(&addr->a);
+
+	return 0;
 }
 
 int ble_svc_enable_ble(void)
@@ -364,15 +1252,16 @@ int ble_svc_enable_ble(void)
 	int ret;
 	bt_addr_le_t addr;
 
-	/* A Static Random Address is a 48-bit (6-byte) address structured as follows:
-	 * Most significant two bits (MSBs) of the first byte must be 11 (bin) C0, D0, E0, F0 (HEX).
-	 * The remaining 46 bits are randomly generated and remain constant. */
-	ret = bt_addr_le_from_str("DE:8B:49:00:00:01", "random", &addr);
-	if (ret) {
-		LOG_ERR("Invalid BT address %d", ret);
+	ret = identity_from_device_id(&addr);
+	if (ret != 0) {
+		LOG_ERR("Failed to read the device ID %d", ret);
 		return ret;
 	}
 
+	if (IS_ENABLED(CONFIG_BSIM_DEVICE_IDENTITY)) {
+		bsim_identity_apply(&addr);
+	}
+
 	ret = bt_id_create(&addr, NULL);
 	if (ret < 0) {
 		LOG_ERR("Creating new ID failed %d", ret);
@@ -396,6 +1285,12 @@ void ble_svc_init(void)
 	bt_conn_cb_register(&conn_callbacks);
 	bt_gatt_cb_register(&ble_srv_gatt_cb);
 
+#if defined(CONFIG_STATS)
+	if (STATS_INIT_AND_REG(ess, STATS_SIZE_32, "ess") != 0) {
+		LOG_ERR("Failed to register ESS stats");
+	}
+#endif
+
 	adv_size = ble_get_payload_size(ad, ARRAY_SIZE(ad));
 	scan_resp_size = ble_get_payload_size(sd, ARRAY_SIZE(sd));
 
@@ -7,29 +7,90 @@
 #ifndef APP_BLE_SVC_H_
 #define APP_BLE_SVC_H_
 
+#include <stdint.h>
+
 /**
  * @brief Updates BLE humidity value and notifies clients.
  *
- * @param hum_value Humidity in % (0.0 - 100.0).
+ * @param humidity Humidity in 0.01 % (0 - 10000).
  *
  * @return 0 on success, -EINVAL if out of range, or error code.
  */
-int ble_svc_update_humidity_value(float hum_value);
+int ble_svc_update_humidity_value(uint16_t humidity);
 
 /**
  * @brief Updates BLE temperature value and notifies clients.
  *
- * @param temp_value Temperature in °C (-20.0 to 125.0).
+ * @param temperature Temperature in 0.01 °C (-4000 to 12500).
  *
  * @return 0 on success, -EINVAL if out of range, or error code.
  */
-int ble_svc_update_temperature_value(float temp_value);
+int ble_svc_update_temperature_value(int16_t temperature);
+
+/**
+ * @brief Updates the BLE dew point value and notifies clients.
+ *
+ * @param dew_point Dew point in 0.01 °C, rounded to the whole degrees of the characteristic.
+ *
+ * @return 0 on success, or error code.
+ */
+int ble_svc_update_dew_point_value(int16_t dew_point);
+
+/**
+ * @brief Updates the BLE heat index value and notifies clients.
+ *
+ * @param heat_index Heat index in 0.01 °C, rounded to the whole degrees of the characteristic.
+ *
+ * @return 0 on success, or error code.
+ */
+int ble_svc_update_heat_index_value(int16_t heat_index);
+
+/**
+ * @brief Updates the BLE absolute humidity value and notifies clients.
+ *
+ * @param absolute_humidity Absolute humidity in 0.01 g/m³.
+ *
+ * @return 0 on success, or error code.
+ */
+int ble_svc_update_absolute_humidity_value(uint16_t absolute_humidity);
 
 /**
- * @brief Temporaily function to demonstrare updateing the ble advertisement data manually at rum
- * time
+ * @brief Puts the latest temperature and humidity values into the advertising data.
+ *
+ * Call after updating both values. Increments the sequence number of the advertised readings.
+ *
+ * @return 0 on success, or error code.
+ */
+int ble_svc_update_advertising_data(void);
+
+/**
+ * @brief Set the measuring period announced to the centrals.
+ *
+ * Updates the update interval of the ES Measurement descriptors, the default trigger of the
+ * centrals reads as the same interval. Can be called from any thread.
+ *
+ * @param seconds Measuring period in seconds.
+ */
+void ble_svc_set_update_interval(uint32_t seconds);
+
+/**
+ * @brief Set the interval of the connectable advertising.
+ *
+ * Takes effect the next time advertising starts, see ble_svc_restart_advertising(). Can be called
+ * from any thread.
+ *
+ * @param min_ms Minimum advertising interval in ms.
+ * @param max_ms Maximum advertising interval in ms, at least @p min_ms.
+ */
+void ble_svc_set_adv_interval(uint32_t min_ms, uint32_t max_ms);
+
+/**
+ * @brief Restart the connectable advertising with the current interval.
+ *
+ * Runs on the system workqueue. Does nothing while all connection objects are in use, advertising
+ * then starts with the new interval once one is recycled.
  */
-void ble_svc_increase_button_press_cnt(void);
+void ble_svc_restart_advertising(void);
 
 /**
  * @brief Enables BLE and start advertising.
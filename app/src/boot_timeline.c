@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stddef.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/stats/stats.h>
+#include <zephyr/sys/atomic.h>
+
+#include "boot_timeline.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(boot_timeline, LOG_LEVEL_INF);
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+	[BOOT_PHASE_MAIN] = "main",
+	[BOOT_PHASE_STORAGE] = "storage",
+	[BOOT_PHASE_BT_ENABLE] = "bt_enable",
+	[BOOT_PHASE_SENSORS] = "sensors",
+	[BOOT_PHASE_GPIO] = "gpio",
+	[BOOT_PHASE_BT_READY] = "bt_ready",
+	[BOOT_PHASE_ADVERTISING] = "advertising",
+	[BOOT_PHASE_FIRST_MEASUREMENT] = "first_measurement",
+};
+
+#if defined(CONFIG_STATS)
+/* Entries in the order of enum boot_phase, they are indexed from the first one */
+STATS_SECT_START(boot)
+STATS_SECT_ENTRY32(main_us)
+STATS_SECT_ENTRY32(storage_us)
+STATS_SECT_ENTRY32(bt_enable_us)
+STATS_SECT_ENTRY32(sensors_us)
+STATS_SECT_ENTRY32(gpio_us)
+STATS_SECT_ENTRY32(bt_ready_us)
+STATS_SECT_ENTRY32(adv_us)
+STATS_SECT_ENTRY32(first_meas_us)
+STATS_SECT_END;
+
+STATS_SECT_DECL(boot) boot;
+
+STATS_NAME_START(boot)
+STATS_NAME(boot, main_us)
+STATS_NAME(boot, storage_us)
+STATS_NAME(boot, bt_enable_us)
+STATS_NAME(boot, sensors_us)
+STATS_NAME(boot, gpio_us)
+STATS_NAME(boot, bt_ready_us)
+STATS_NAME(boot, adv_us)
+STATS_NAME(boot, first_meas_us)
+STATS_NAME_END(boot);
+
+BUILD_ASSERT(offsetof(STATS_SECT_TYPE(boot), first_meas_us) -
+			     offsetof(STATS_SECT_TYPE(boot), main_us) ==
+		     (BOOT_PHASE_COUNT - 1) * sizeof(uint32_t),
+	     "Stat entries must follow enum boot_phase");
+#endif
+
+/*
+ * Thread-safety: Phases are marked from the main thread, the system workqueue and the BT RX
+ * thread. The first mark of a phase wins the compare-and-set, the one completing the timeline
+ * logs it.
+ */
+struct boot_timeline_data {
+	atomic_t marks_us[BOOT_PHASE_COUNT]; /* 0 while the phase was not reached */
+	atomic_t marked;
+};
+
+static struct boot_timeline_data data;
+
+static void timeline_log(void)
+{
+	LOG_INF("Boot timeline (uptime in us):");
+
+	for (size_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+		LOG_INF("  %-17s %8u", phase_names[i], (uint32_t)atomic_get(&data.marks_us[i]));
+	}
+}
+
+void boot_timeline_mark(enum boot_phase phase)
+{
+	/* Never 0, which marks a phase that was not reached */
+	uint32_t now_us = MAX(k_ticks_to_us_floor32(k_uptime_ticks()), 1U);
+
+	if (!atomic_cas(&data.marks_us[phase], 0, (atomic_val_t)now_us)) {
+		return;
+	}
+
+#if defined(CONFIG_STATS)
+	(&boot.main_us)[phase] = now_us;
+#endif
+
+	if (atomic_inc(&data.marked) + 1 == BOOT_PHASE_COUNT) {
+		timeline_log();
+	}
+}
+
+int boot_timeline_init(void)
+{
+	int ret = 0;
+
+#if defined(CONFIG_STATS)
+	ret = STATS_INIT_AND_REG(boot, STATS_SIZE_32, "boot");
+	if (ret != 0) {
+		LOG_ERR("Failed to register boot stats: %d", ret);
+	}
+#endif
+
+	boot_timeline_mark(BOOT_PHASE_MAIN);
+
+	return ret;
+}
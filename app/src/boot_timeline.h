@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BOOT_TIMELINE_H_
+#define APP_BOOT_TIMELINE_H_
+
+#include <stdint.h>
+
+/*
+ * Boot timeline, exported as the "boot" stat group through MCUmgr and logged once complete.
+ *
+ * Records the uptime in microseconds at which every phase of the startup was reached, the first
+ * time only. The phases overlap, BLE comes up on the system workqueue while the main thread
+ * initializes sensors and GPIOs. Without CONFIG_BOOT_TIMELINE all functions are empty inlines.
+ */
+
+enum boot_phase {
+	BOOT_PHASE_MAIN,              /* main() entered, kernel and drivers initialized */
+	BOOT_PHASE_STORAGE,           /* History log mounted and configuration loaded */
+	BOOT_PHASE_BT_ENABLE,         /* Controller opened, host initialization running */
+	BOOT_PHASE_SENSORS,           /* Sensor registry ready */
+	BOOT_PHASE_GPIO,              /* Status LED and button configured */
+	BOOT_PHASE_BT_READY,          /* Host initialized, Bluetooth settings loaded */
+	BOOT_PHASE_ADVERTISING,       /* Connectable advertising started */
+	BOOT_PHASE_FIRST_MEASUREMENT, /* First measurement completed */
+	BOOT_PHASE_COUNT,
+};
+
+#if defined(CONFIG_BOOT_TIMELINE)
+
+/**
+ * @brief Record that a phase was reached.
+ *
+ * Only the first call per phase is recorded. The timeline is logged once all phases were
+ * reached. Can be called from any thread.
+ *
+ * @param phase Reached phase.
+ */
+void boot_timeline_mark(enum boot_phase phase);
+
+/**
+ * @brief Register the stat group and record BOOT_PHASE_MAIN.
+ *
+ * @return 0 on success, or error code.
+ */
+int boot_timeline_init(void);
+
+#else
+
+static inline void boot_timeline_mark(enum boot_phase phase)
+{
+}
+
+static inline int boot_timeline_init(void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_BOOT_TIMELINE */
+
+#endif /* APP_BOOT_TIMELINE_H_ */
@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/sys/byteorder.h>
+
+#include "bsim_args_runner.h"
+#include "bsim_identity.h"
+
+void bsim_identity_apply(bt_addr_le_t *addr)
+{
+	sys_put_le16(bsim_args_get_global_device_nbr(), &addr->a.val[0]);
+}
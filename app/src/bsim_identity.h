@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BSIM_IDENTITY_H_
+#define APP_BSIM_IDENTITY_H_
+
+#include <zephyr/bluetooth/addr.h>
+
+/**
+ * @brief Make the identity address unique within a simulated fleet.
+ *
+ * Every device of a BabbleSim fleet runs the same image, the global device number keeps their
+ * addresses apart. Test images only (CONFIG_BSIM_DEVICE_IDENTITY).
+ *
+ * @param addr Identity address derived from the device ID, modified in place.
+ */
+void bsim_identity_apply(bt_addr_le_t *addr);
+
+#endif /* APP_BSIM_IDENTITY_H_ */
@@ -0,0 +1,363 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#if defined(CONFIG_MCUMGR_SMP_COMMAND_STATUS_HOOKS)
+#include <zephyr/mgmt/mcumgr/mgmt/callbacks.h>
+#endif
+
+#include "conn_param_policy.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(conn_param_policy, LOG_LEVEL_INF);
+
+#define IDLE_DELAY_MS        (CONFIG_CONN_PARAM_POLICY_IDLE_DELAY_SECONDS * MSEC_PER_SEC)
+#define MIN_WAKE_INTERVAL_US (CONFIG_CONN_PARAM_POLICY_MIN_WAKE_INTERVAL_MS * USEC_PER_MSEC)
+#define MAX_ATTEMPTS         CONFIG_CONN_PARAM_POLICY_MAX_ATTEMPTS
+
+/* Connection interval in 1.25 ms units, supervision timeout in 10 ms units */
+#define INTERVAL_TO_US(interval) ((uint32_t)(interval) * 1250U)
+#define TIMEOUT_TO_MS(timeout)   ((uint32_t)(timeout) * 10U)
+
+BUILD_ASSERT(!IS_ENABLED(CONFIG_BT_GAP_AUTO_UPDATE_CONN_PARAMS) &&
+		     !IS_ENABLED(CONFIG_MCUMGR_TRANSPORT_BT_CONN_PARAM_CONTROL),
+	     "The connection parameters are renegotiated by the policy only");
+
+/* The supervision timeout must exceed twice the time between two events of the peripheral */
+BUILD_ASSERT(CONFIG_BT_PERIPHERAL_PREF_TIMEOUT * 4 >
+		     (CONFIG_BT_PERIPHERAL_PREF_LATENCY + 1) * CONFIG_BT_PERIPHERAL_PREF_MAX_INT,
+	     "Supervision timeout of the idle parameters too short");
+BUILD_ASSERT(CONFIG_CONN_PARAM_POLICY_FAST_TIMEOUT * 4 > CONFIG_CONN_PARAM_POLICY_FAST_MAX_INT,
+	     "Supervision timeout of the fast parameters too short");
+
+enum profile {
+	PROFILE_NONE,
+	PROFILE_IDLE,
+	PROFILE_FAST,
+};
+
+static const char *const profile_names[] = {
+	[PROFILE_NONE] = "none",
+	[PROFILE_IDLE] = "idle",
+	[PROFILE_FAST] = "fast",
+};
+
+static const struct bt_le_conn_param profiles[] = {
+	[PROFILE_IDLE] = BT_LE_CONN_PARAM_INIT(
+		CONFIG_BT_PERIPHERAL_PREF_MIN_INT, CONFIG_BT_PERIPHERAL_PREF_MAX_INT,
+		CONFIG_BT_PERIPHERAL_PREF_LATENCY, CONFIG_BT_PERIPHERAL_PREF_TIMEOUT),
+	[PROFILE_FAST] = BT_LE_CONN_PARAM_INIT(CONFIG_CONN_PARAM_POLICY_FAST_MIN_INT,
+					       CONFIG_CONN_PARAM_POLICY_FAST_MAX_INT, 0,
+					       CONFIG_CONN_PARAM_POLICY_FAST_TIMEOUT),
+};
+
+struct policy_ctx {
+	struct bt_conn *conn;
+	struct k_work_delayable work;
+	uint32_t activities; /* BIT(enum conn_param_activity) of the running activities */
+	int64_t idle_at;     /* Uptime from which the idle parameters are requested */
+	uint16_t interval;
+	uint16_t latency;
+	uint16_t timeout;
+	enum profile wanted;
+	uint8_t attempts; /* Requests of the wanted profile the central did not apply */
+};
+
+/*
+ * Thread-safety: The connection callbacks run on the BT RX thread, the activities are reported
+ * from the system workqueue and the MCUmgr hook runs on the SMP workqueue. All of them only
+ * update the state under the lock and reschedule the work item of the connection, the
+ * parameters are requested by policy_work_handler on the system workqueue.
+ */
+struct conn_param_policy_data {
+	struct k_spinlock lock;
+	int64_t mcumgr_until; /* Uptime until which an MCUmgr session counts as running */
+	struct policy_ctx conns[CONFIG_BT_MAX_CONN];
+};
+
+static struct conn_param_policy_data data;
+
+static bool params_match(const struct policy_ctx *ctx, enum profile profile)
+{
+	const struct bt_le_conn_param *param = &profiles[profile];
+
+	return ctx->interval >= param->interval_min && ctx->interval <= param->interval_max &&
+	       ctx->latency == param->latency;
+}
+
+/* Must be called with the lock held */
+static bool is_idle(const struct policy_ctx *ctx, int64_t now)
+{
+	return ctx->activities == 0 && now >= data.mcumgr_until && now >= ctx->idle_at;
+}
+
+static void policy_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct policy_ctx *ctx = CONTAINER_OF(dwork, struct policy_ctx, work);
+	const struct bt_le_conn_param *param;
+	int64_t now = k_uptime_get();
+	int64_t recheck_ms = 0;
+	struct bt_conn *conn = NULL;
+	enum profile wanted;
+	k_spinlock_key_t key;
+	bool request;
+	int ret;
+
+	key = k_spin_lock(&data.lock);
+
+	if (ctx->conn == NULL) {
+		k_spin_unlock(&data.lock, key);
+		return;
+	}
+
+	if (ctx->activities != 0) {
+		wanted = PROFILE_FAST;
+	} else if (now < data.mcumgr_until) {
+		/* Nothing reports the end of an MCUmgr session, check again once it timed out */
+		wanted = PROFILE_FAST;
+		recheck_ms = data.mcumgr_until - now;
+	} else if (now < ctx->idle_at) {
+		/* Keeps the parameters of the central during service discovery */
+		recheck_ms = ctx->idle_at - now;
+		k_spin_unlock(&data.lock, key);
+
+		k_work_reschedule(&ctx->work, K_MSEC(recheck_ms));
+		return;
+	} else {
+		wanted = PROFILE_IDLE;
+	}
+
+	if (wanted != ctx->wanted) {
+		ctx->wanted = wanted;
+		ctx->attempts = 0;
+	}
+
+	/* A central that keeps different parameters is not asked forever */
+	request = !params_match(ctx, wanted) && ctx->attempts < MAX_ATTEMPTS;
+	if (request) {
+		ctx->attempts++;
+		conn = bt_conn_ref(ctx->conn);
+	}
+	k_spin_unlock(&data.lock, key);
+
+	/* Outside of the lock, k_work_reschedule() takes the lock of the work queues itself */
+	if (recheck_ms > 0) {
+		k_work_reschedule(&ctx->work, K_MSEC(recheck_ms));
+	}
+
+	if (!request) {
+		return;
+	}
+
+	param = &profiles[wanted];
+	ret = bt_conn_le_param_update(conn, param);
+	if (ret != 0) {
+		LOG_WRN("Requesting %s parameters failed: %d", profile_names[wanted], ret);
+	} else {
+		LOG_INF("Requested %s parameters: interval %u-%u us, latency %u, timeout %u ms",
+			profile_names[wanted], INTERVAL_TO_US(param->interval_min),
+			INTERVAL_TO_US(param->interval_max), param->latency,
+			TIMEOUT_TO_MS(param->timeout));
+	}
+
+	bt_conn_unref(conn);
+}
+
+void conn_param_policy_set_activity(struct bt_conn *conn, enum conn_param_activity activity,
+				    bool active)
+{
+	struct policy_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	k_spinlock_key_t key = k_spin_lock(&data.lock);
+
+	if (ctx->conn != conn) {
+		k_spin_unlock(&data.lock, key);
+		return;
+	}
+
+	if (active) {
+		ctx->activities |= BIT(activity);
+	} else {
+		ctx->activities &= ~BIT(activity);
+		if (ctx->activities == 0) {
+			ctx->idle_at = k_uptime_get() + IDLE_DELAY_MS;
+		}
+	}
+
+	k_spin_unlock(&data.lock, key);
+
+	k_work_reschedule(&ctx->work, active ? K_NO_WAIT : K_MSEC(IDLE_DELAY_MS));
+}
+
+static void on_connected(struct bt_conn *conn, uint8_t err)
+{
+	struct policy_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	struct bt_conn_info info;
+	k_spinlock_key_t key;
+
+	if (err != 0 || bt_conn_get_info(conn, &info) != 0) {
+		return;
+	}
+
+	key = k_spin_lock(&data.lock);
+	ctx->conn = bt_conn_ref(conn);
+	ctx->activities = 0;
+	ctx->idle_at = k_uptime_get() + IDLE_DELAY_MS;
+	ctx->interval = info.le.interval;
+	ctx->latency = info.le.latency;
+	ctx->timeout = info.le.timeout;
+	ctx->wanted = PROFILE_NONE;
+	ctx->attempts = 0;
+	k_spin_unlock(&data.lock, key);
+
+	k_work_reschedule(&ctx->work, K_MSEC(IDLE_DELAY_MS));
+}
+
+static void on_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct policy_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	struct bt_conn *old;
+	k_spinlock_key_t key;
+
+	ARG_UNUSED(reason);
+
+	key = k_spin_lock(&data.lock);
+	old = ctx->conn;
+	ctx->conn = NULL;
+	k_spin_unlock(&data.lock, key);
+
+	k_work_cancel_delayable(&ctx->work);
+
+	if (old != NULL) {
+		bt_conn_unref(old);
+	}
+}
+
+static bool on_le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param)
+{
+	struct policy_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	/* The central may choose the shortest interval of the range */
+	uint32_t wake_us = INTERVAL_TO_US(param->interval_min) * (param->latency + 1U);
+	k_spinlock_key_t key;
+	bool idle;
+
+	key = k_spin_lock(&data.lock);
+	idle = ctx->conn == conn && is_idle(ctx, k_uptime_get());
+	k_spin_unlock(&data.lock, key);
+
+	/* Outside of the idle state the fast parameters are wanted anyway */
+	if (idle && wake_us < MIN_WAKE_INTERVAL_US) {
+		LOG_INF("Rejected central request: interval %u-%u us, latency %u, timeout %u ms, "
+			"wakes every %u us",
+			INTERVAL_TO_US(param->interval_min), INTERVAL_TO_US(param->interval_max),
+			param->latency, TIMEOUT_TO_MS(param->timeout), wake_us);
+		return false;
+	}
+
+	LOG_INF("Accepted central request: interval %u-%u us, latency %u, timeout %u ms",
+		INTERVAL_TO_US(param->interval_min), INTERVAL_TO_US(param->interval_max),
+		param->latency, TIMEOUT_TO_MS(param->timeout));
+
+	return true;
+}
+
+static void on_le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+				uint16_t timeout)
+{
+	struct policy_ctx *ctx = &data.conns[bt_conn_index(conn)];
+	enum profile wanted;
+	bool match;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data.lock);
+	ctx->interval = interval;
+	ctx->latency = latency;
+	ctx->timeout = timeout;
+	wanted = ctx->wanted;
+	match = wanted != PROFILE_NONE && params_match(ctx, wanted);
+	if (match) {
+		ctx->attempts = 0;
+	}
+	k_spin_unlock(&data.lock, key);
+
+	if (wanted == PROFILE_NONE) {
+		LOG_INF("Parameters updated by the central: interval %u us, latency %u, "
+			"timeout %u ms",
+			INTERVAL_TO_US(interval), latency, TIMEOUT_TO_MS(timeout));
+		return;
+	}
+
+	LOG_INF("Parameters updated: interval %u us, latency %u, timeout %u ms, %s parameters %s",
+		INTERVAL_TO_US(interval), latency, TIMEOUT_TO_MS(timeout), profile_names[wanted],
+		match ? "applied" : "not applied");
+
+	/* Asks again if the central overrode the wanted parameters */
+	if (!match) {
+		k_work_reschedule(&ctx->work, K_NO_WAIT);
+	}
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.connected = on_connected,
+	.disconnected = on_disconnected,
+	.le_param_req = on_le_param_req,
+	.le_param_updated = on_le_param_updated,
+};
+
+#if defined(CONFIG_MCUMGR_SMP_COMMAND_STATUS_HOOKS)
+static enum mgmt_cb_return mcumgr_cmd_recv(uint32_t event, enum mgmt_cb_return prev_status,
+					   int32_t *rc, uint16_t *group, bool *abort_more,
+					   void *cb_data, size_t data_size)
+{
+	int64_t now = k_uptime_get();
+	k_spinlock_key_t key;
+	bool started;
+
+	ARG_UNUSED(event);
+	ARG_UNUSED(prev_status);
+	ARG_UNUSED(rc);
+	ARG_UNUSED(group);
+	ARG_UNUSED(abort_more);
+	ARG_UNUSED(cb_data);
+	ARG_UNUSED(data_size);
+
+	key = k_spin_lock(&data.lock);
+	started = now >= data.mcumgr_until;
+	data.mcumgr_until = now + IDLE_DELAY_MS;
+	k_spin_unlock(&data.lock, key);
+
+	/* The command does not tell which central sent it, all of them get the fast parameters */
+	if (started) {
+		for (size_t i = 0; i < ARRAY_SIZE(data.conns); i++) {
+			k_work_reschedule(&data.conns[i].work, K_NO_WAIT);
+		}
+	}
+
+	return MGMT_CB_OK;
+}
+
+static struct mgmt_callback mcumgr_cmd_callback = {
+	.callback = mcumgr_cmd_recv,
+	.event_id = MGMT_EVT_OP_CMD_RECV,
+};
+#endif
+
+void conn_param_policy_init(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(data.conns); i++) {
+		k_work_init_delayable(&data.conns[i].work, policy_work_handler);
+	}
+
+	bt_conn_cb_register(&conn_callbacks);
+
+#if defined(CONFIG_MCUMGR_SMP_COMMAND_STATUS_HOOKS)
+	mgmt_callback_register(&mcumgr_cmd_callback);
+#endif
+}
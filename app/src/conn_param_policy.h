@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_CONN_PARAM_POLICY_H_
+#define APP_CONN_PARAM_POLICY_H_
+
+#include <stdbool.h>
+
+#include <zephyr/bluetooth/conn.h>
+
+/*
+ * Connection parameter policy
+ *
+ * Chooses the connection parameters of every central from what the connection is used for:
+ * - Idle: steady-state monitoring, one notification per measuring period. The preferred
+ *   peripheral parameters (CONFIG_BT_PERIPHERAL_PREF_*) with a long interval and a high
+ *   peripheral latency, so the radio only wakes for the keep-alive every (latency + 1)
+ *   intervals. Requested CONFIG_CONN_PARAM_POLICY_IDLE_DELAY_SECONDS after connecting and
+ *   after the last activity ended.
+ * - Fast: a bulk transfer or an MCUmgr session is running on the connection, short interval
+ *   and no latency. Requested as soon as the activity starts.
+ *
+ * While idle, central requests that would wake the radio more often than every
+ * CONFIG_CONN_PARAM_POLICY_MIN_WAKE_INTERVAL_MS are rejected. Every renegotiation is logged
+ * with its outcome.
+ */
+
+/* Activities that need the fast connection parameters */
+enum conn_param_activity {
+	CONN_PARAM_ACTIVITY_HISTORY_TRANSFER,
+	CONN_PARAM_ACTIVITY_BACKFILL,
+	CONN_PARAM_ACTIVITY_COUNT,
+};
+
+/**
+ * @brief Report the start or the end of an activity on a connection.
+ *
+ * The fast parameters are kept while any activity is running on the connection. Can be called
+ * from any thread.
+ *
+ * @param conn Connection of the central.
+ * @param activity Activity that started or ended.
+ * @param active true when the activity starts, false when it ends.
+ */
+void conn_param_policy_set_activity(struct bt_conn *conn, enum conn_param_activity activity,
+				    bool active);
+
+/**
+ * @brief Initialize the connection parameter policy.
+ *
+ * Registers the connection callbacks and the MCUmgr command hook.
+ */
+void conn_param_policy_init(void);
+
+#endif /* APP_CONN_PARAM_POLICY_H_ */
@@ -4,14 +4,117 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stddef.h>
+
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/stats/stats.h>
+#include <zephyr/sys/atomic.h>
 
 #include "events_svc.h"
+#include "latency_stats.h"
 
 LOG_MODULE_REGISTER(events_svc);
 
-K_MSGQ_DEFINE(event_msq, sizeof(struct event), EVENT_QUEUE_SIZE, 4);
+enum event_lane {
+	EVENT_LANE_HIGH,
+	EVENT_LANE_NORMAL,
+	EVENT_LANE_COUNT,
+};
+
+K_MSGQ_DEFINE(event_msq_high, sizeof(struct event), CONFIG_EVENTS_HIGH_PRIO_QUEUE_SIZE, 4);
+K_MSGQ_DEFINE(event_msq_normal, sizeof(struct event), CONFIG_EVENTS_QUEUE_SIZE, 4);
+
+/* Counts the events queued in both lanes */
+static K_SEM_DEFINE(event_pending, 0, K_SEM_MAX_LIMIT);
+
+static struct k_msgq *const lanes[EVENT_LANE_COUNT] = {
+	[EVENT_LANE_HIGH] = &event_msq_high,
+	[EVENT_LANE_NORMAL] = &event_msq_normal,
+};
+
+static const uint8_t event_lane[EVENT_TYPE_COUNT] = {
+	[EVENT_BLE_CONNECTED] = EVENT_LANE_HIGH,
+	[EVENT_BLE_NOT_CONNECTED] = EVENT_LANE_HIGH,
+	[EVENT_BLE_RECONNECTED] = EVENT_LANE_HIGH,
+	[EVENT_BLE_CONN_PARAMS_CHANGED] = EVENT_LANE_NORMAL,
+	[EVENT_MEASUREMENT_READY] = EVENT_LANE_NORMAL,
+	[EVENT_BUTTON] = EVENT_LANE_NORMAL,
+	[EVENT_CONFIG_CHANGED] = EVENT_LANE_NORMAL,
+};
+
+struct event_channel {
+	sys_slist_t subscribers; /* Only used by the dispatching thread */
+	atomic_t dropped;
+	atomic_t high_water_mark; /* Highest lane fill level seen when publishing this type */
+};
+
+static struct event_channel channels[EVENT_TYPE_COUNT];
+
+#if defined(CONFIG_STATS)
+/* Copies of the channel counters, both blocks in the order of enum event_type */
+STATS_SECT_START(events)
+STATS_SECT_ENTRY32(conn_drop)
+STATS_SECT_ENTRY32(disconn_drop)
+STATS_SECT_ENTRY32(reconn_drop)
+STATS_SECT_ENTRY32(params_drop)
+STATS_SECT_ENTRY32(meas_drop)
+STATS_SECT_ENTRY32(button_drop)
+STATS_SECT_ENTRY32(config_drop)
+STATS_SECT_ENTRY32(conn_hwm)
+STATS_SECT_ENTRY32(disconn_hwm)
+STATS_SECT_ENTRY32(reconn_hwm)
+STATS_SECT_ENTRY32(params_hwm)
+STATS_SECT_ENTRY32(meas_hwm)
+STATS_SECT_ENTRY32(button_hwm)
+STATS_SECT_ENTRY32(config_hwm)
+STATS_SECT_END;
+
+STATS_SECT_DECL(events) events;
+
+STATS_NAME_START(events)
+STATS_NAME(events, conn_drop)
+STATS_NAME(events, disconn_drop)
+STATS_NAME(events, reconn_drop)
+STATS_NAME(events, params_drop)
+STATS_NAME(events, meas_drop)
+STATS_NAME(events, button_drop)
+STATS_NAME(events, config_drop)
+STATS_NAME(events, conn_hwm)
+STATS_NAME(events, disconn_hwm)
+STATS_NAME(events, reconn_hwm)
+STATS_NAME(events, params_hwm)
+STATS_NAME(events, meas_hwm)
+STATS_NAME(events, button_hwm)
+STATS_NAME(events, config_hwm)
+STATS_NAME_END(events);
+
+BUILD_ASSERT(offsetof(STATS_SECT_TYPE(events), config_drop) -
+			     offsetof(STATS_SECT_TYPE(events), conn_drop) ==
+		     (EVENT_TYPE_COUNT - 1) * sizeof(uint32_t),
+	     "Drop entries must follow enum event_type");
+BUILD_ASSERT(offsetof(STATS_SECT_TYPE(events), config_hwm) -
+			     offsetof(STATS_SECT_TYPE(events), conn_hwm) ==
+		     (EVENT_TYPE_COUNT - 1) * sizeof(uint32_t),
+	     "High-water mark entries must follow enum event_type");
+
+/* Serializes the copies, so a late writer never stores an older counter value */
+static struct k_spinlock stats_lock;
+
+static void stats_update(enum event_type type)
+{
+	k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+	(&events.conn_drop)[type] = atomic_get(&channels[type].dropped);
+	(&events.conn_hwm)[type] = atomic_get(&channels[type].high_water_mark);
+	k_spin_unlock(&stats_lock, key);
+}
+#else
+static inline void stats_update(enum event_type type)
+{
+	ARG_UNUSED(type);
+}
+#endif
 
 const char *events_svc_type_to_text(enum event_type type)
 {
@@ -20,17 +123,101 @@ const char *events_svc_type_to_text(enum event_type type)
 		return "EVENT_BLE_CONNECTED";
 	case EVENT_BLE_NOT_CONNECTED:
 		return "EVENT_BLE_NOT_CONNECTED";
+	case EVENT_BLE_RECONNECTED:
+		return "EVENT_BLE_RECONNECTED";
+	case EVENT_BLE_CONN_PARAMS_CHANGED:
+		return "EVENT_BLE_CONN_PARAMS_CHANGED";
+	case EVENT_MEASUREMENT_READY:
+		return "EVENT_MEASUREMENT_READY";
+	case EVENT_BUTTON:
+		return "EVENT_BUTTON";
+	case EVENT_CONFIG_CHANGED:
+		return "EVENT_CONFIG_CHANGED";
 	default:
 		return "UNKNOWN";
 	}
 }
 
-int events_svc_send_event(struct event *evt)
+int events_svc_subscribe(enum event_type type, struct events_svc_subscriber *sub)
 {
-	return k_msgq_put(&event_msq, evt, K_NO_WAIT);
+	if (type >= EVENT_TYPE_COUNT) {
+		return -EINVAL;
+	}
+
+	sys_slist_append(&channels[type].subscribers, &sub->node);
+
+	return 0;
 }
 
-int events_svc_get_event(struct event *evt)
+static void update_high_water_mark(atomic_t *hwm, atomic_val_t level)
 {
-	return k_msgq_get(&event_msq, evt, K_FOREVER);
-}
\ No newline at end of file
+	atomic_val_t old = atomic_get(hwm);
+
+	while (level > old && !atomic_cas(hwm, old, level)) {
+		old = atomic_get(hwm);
+	}
+}
+
+int events_svc_publish(const struct event *evt)
+{
+	struct event_channel *channel;
+	struct k_msgq *lane;
+	atomic_val_t dropped;
+	uint32_t depth;
+
+	if (evt->type >= EVENT_TYPE_COUNT) {
+		return -EINVAL;
+	}
+
+	channel = &channels[evt->type];
+	lane = lanes[event_lane[evt->type]];
+
+	if (k_msgq_put(lane, evt, K_NO_WAIT) != 0) {
+		dropped = atomic_inc(&channel->dropped) + 1;
+		latency_stats_event_dropped();
+		stats_update(evt->type);
+		LOG_WRN("%s dropped, lane full (%ld dropped so far)",
+			events_svc_type_to_text(evt->type), dropped);
+		return -ENOMEM;
+	}
+
+	depth = k_msgq_num_used_get(lane);
+	update_high_water_mark(&channel->high_water_mark, depth);
+	stats_update(evt->type);
+	latency_stats_event_queue_depth(depth);
+	k_sem_give(&event_pending);
+
+	return 0;
+}
+
+int events_svc_dispatch(k_timeout_t timeout)
+{
+	struct events_svc_subscriber *sub;
+	struct event evt;
+
+	if (k_sem_take(&event_pending, timeout) != 0) {
+		return -EAGAIN;
+	}
+
+	/* Every given semaphore has an event in one of the lanes, the high lane goes first */
+	for (size_t i = 0; i < EVENT_LANE_COUNT; i++) {
+		if (k_msgq_get(lanes[i], &evt, K_NO_WAIT) == 0) {
+			break;
+		}
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&channels[evt.type].subscribers, sub, node) {
+		sub->handler(&evt, sub->user_data);
+	}
+
+	return 0;
+}
+
+int events_svc_init(void)
+{
+#if defined(CONFIG_STATS)
+	return STATS_INIT_AND_REG(events, STATS_SIZE_32, "events");
+#else
+	return 0;
+#endif
+}
@@ -7,17 +7,67 @@
 #ifndef APP_EVENT_SVC_H_
 #define APP_EVENT_SVC_H_
 
-/* Queue size of 4 is sufficient: only 2 event types (connect/disconnect)
- * and main thread processes events synchronously */
-#define EVENT_QUEUE_SIZE 4
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+/*
+ * Application event bus
+ *
+ * Every event type is a channel with any number of subscribers. Events are queued in one of two
+ * lanes and delivered to the subscribers by the thread calling events_svc_dispatch(), the
+ * main thread. Connection events use the high-priority lane and are always delivered before
+ * the events of the normal lane.
+ */
 
 enum event_type {
 	EVENT_BLE_CONNECTED,
 	EVENT_BLE_NOT_CONNECTED,
+	EVENT_BLE_RECONNECTED, /* A bonded central re-encrypted, its subscriptions are restored */
+	EVENT_BLE_CONN_PARAMS_CHANGED,
+	EVENT_MEASUREMENT_READY,
+	EVENT_BUTTON,
+	EVENT_CONFIG_CHANGED,
+	EVENT_TYPE_COUNT,
 };
 
 struct event {
 	enum event_type type;
+	union {
+		/* EVENT_BLE_CONNECTED, EVENT_BLE_NOT_CONNECTED, EVENT_BLE_RECONNECTED */
+		struct {
+			uint8_t conn_index; /* bt_conn_index() of the connection */
+		} conn;
+		/* EVENT_BLE_CONN_PARAMS_CHANGED */
+		struct {
+			uint8_t conn_index;
+			uint16_t interval; /* In 1.25 ms units */
+			uint16_t latency;  /* In connection events */
+			uint16_t timeout;  /* In 10 ms units */
+		} conn_params;
+		/* EVENT_MEASUREMENT_READY */
+		struct {
+			int16_t temperature; /* In 0.01 °C */
+			uint16_t humidity;   /* In 0.01 % */
+		} measurement;
+		/* EVENT_BUTTON */
+		struct {
+			uint8_t gesture; /* enum button_evt */
+		} button;
+		/* EVENT_CONFIG_CHANGED */
+		struct {
+			uint32_t changed; /* BIT(enum runtime_config_param) of the changed values */
+		} config;
+	};
+};
+
+typedef void (*events_svc_handler_t)(const struct event *evt, void *user_data);
+
+struct events_svc_subscriber {
+	sys_snode_t node;
+	events_svc_handler_t handler;
+	void *user_data;
 };
 
 /**
@@ -29,19 +79,44 @@ struct event {
 const char *events_svc_type_to_text(enum event_type type);
 
 /**
- * @brief Pushes an event to the message queue
+ * @brief Subscribe to an event type
  *
- * @param evt pointer to the event to be sent.
- * @return int
+ * Subscribe during initialization or from a subscriber, the subscriber lists are only used by
+ * the dispatching thread.
+ *
+ * @param type event type to subscribe to.
+ * @param sub subscriber, must stay valid. A subscriber can only be subscribed to one type.
+ * @return 0 on success, or -EINVAL for an unknown type.
  */
-int events_svc_send_event(struct event *evt);
+int events_svc_subscribe(enum event_type type, struct events_svc_subscriber *sub);
 
 /**
- * @brief Gets an event from the message queue
+ * @brief Publish an event
+ *
+ * Copies the event into the lane of its type. Never blocks, can be called from any context.
+ *
+ * @param evt pointer to the event to be published.
+ * @return 0 on success, -ENOMEM if the lane is full and the event was dropped, or -EINVAL for
+ *         an unknown type.
+ */
+int events_svc_publish(const struct event *evt);
+
+/**
+ * @brief Wait for the next event and deliver it to its subscribers
+ *
+ * @param timeout how long to wait for an event.
+ * @return 0 if an event was delivered, or -EAGAIN on timeout.
+ */
+int events_svc_dispatch(k_timeout_t timeout);
+
+/**
+ * @brief Register the event bus statistics
+ *
+ * With CONFIG_STATS the dropped events and the highest lane fill level of every event type are
+ * exported as the stat group "events", readable over MCUmgr.
  *
- * @param evt pointer to the event to be received.
- * @return int
+ * @return 0 on success, or a negative error code.
  */
-int events_svc_get_event(struct event *evt);
+int events_svc_init(void);
 
-#endif /* APP_EVENT_SVC_H_ */
\ No newline at end of file
+#endif /* APP_EVENT_SVC_H_ */
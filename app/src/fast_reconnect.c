@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/kernel.h>
+
+#include "ble_svc.h"
+#include "fast_reconnect.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(fast_reconnect, LOG_LEVEL_INF);
+
+enum reconnect_mode {
+	MODE_OPEN,
+	MODE_DIRECTED,
+	MODE_ACCEPT_LIST,
+};
+
+/*
+ * Thread-safety: The connection callbacks run on the BT RX thread, the advertising is started
+ * and the window ends on the system workqueue. The mode and the peer are only accessed under
+ * the lock. adv_peer is only accessed from the system workqueue.
+ */
+struct fast_reconnect_data {
+	struct k_spinlock lock;
+	enum reconnect_mode mode;
+	bt_addr_le_t peer; /* Bonded central that disconnected last */
+};
+
+static struct fast_reconnect_data data;
+
+/* Passed to bt_le_adv_start() by reference */
+static bt_addr_le_t adv_peer;
+
+static void window_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(window_work, window_work_handler);
+
+static void window_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_spinlock_key_t key = k_spin_lock(&data.lock);
+	bool restart = (data.mode != MODE_OPEN);
+
+	data.mode = MODE_OPEN;
+	k_spin_unlock(&data.lock, key);
+
+	if (restart) {
+		LOG_INF("Bonded central did not reconnect, advertising for everybody");
+		ble_svc_restart_advertising();
+	}
+}
+
+static void accept_list_add(const struct bt_bond_info *info, void *user_data)
+{
+	size_t *count = user_data;
+	int ret;
+
+	ret = bt_le_filter_accept_list_add(&info->addr);
+	if (ret != 0) {
+		LOG_WRN("Failed to add a bond to the accept list: %d", ret);
+		return;
+	}
+
+	(*count)++;
+}
+
+bool fast_reconnect_adv_param(struct bt_le_adv_param *param)
+{
+	k_spinlock_key_t key = k_spin_lock(&data.lock);
+	enum reconnect_mode mode = data.mode;
+	size_t count = 0;
+	int ret;
+
+	bt_addr_le_copy(&adv_peer, &data.peer);
+	k_spin_unlock(&data.lock, key);
+
+	switch (mode) {
+	case MODE_DIRECTED:
+		/* High duty cycle, the interval is given by the controller */
+		param->peer = &adv_peer;
+		param->options &= ~BT_LE_ADV_OPT_DIR_MODE_LOW_DUTY;
+		return true;
+
+	case MODE_ACCEPT_LIST:
+		ret = bt_le_filter_accept_list_clear();
+		if (ret != 0) {
+			LOG_WRN("Failed to clear the accept list: %d", ret);
+			return false;
+		}
+
+		bt_foreach_bond(BT_ID_DEFAULT, accept_list_add, &count);
+		if (count == 0) {
+			return false;
+		}
+
+		param->options |= BT_LE_ADV_OPT_FILTER_CONN;
+		param->interval_min = BT_GAP_ADV_FAST_INT_MIN_1;
+		param->interval_max = BT_GAP_ADV_FAST_INT_MAX_1;
+		return false;
+
+	default:
+		return false;
+	}
+}
+
+void fast_reconnect_directed_timeout(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&data.lock);
+
+	if (data.mode == MODE_DIRECTED) {
+		data.mode = MODE_ACCEPT_LIST;
+	}
+	k_spin_unlock(&data.lock, key);
+}
+
+static void on_connected(struct bt_conn *conn, uint8_t err)
+{
+	ARG_UNUSED(conn);
+
+	k_spinlock_key_t key;
+
+	if (err != 0) {
+		return;
+	}
+
+	key = k_spin_lock(&data.lock);
+	data.mode = MODE_OPEN;
+	k_spin_unlock(&data.lock, key);
+
+	k_work_cancel_delayable(&window_work);
+}
+
+static void on_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	const bt_addr_le_t *dst = bt_conn_get_dst(conn);
+	char addr[BT_ADDR_LE_STR_LEN];
+	k_spinlock_key_t key;
+
+	if (!bt_le_bond_exists(BT_ID_DEFAULT, dst)) {
+		return;
+	}
+
+	key = k_spin_lock(&data.lock);
+	data.mode = MODE_DIRECTED;
+	bt_addr_le_copy(&data.peer, dst);
+	k_spin_unlock(&data.lock, key);
+
+	k_work_reschedule(&window_work, K_SECONDS(CONFIG_BLE_FAST_RECONNECT_WINDOW_SECONDS));
+
+	bt_addr_le_to_str(dst, addr, sizeof(addr));
+	LOG_INF("Bonded central %s disconnected (reason 0x%02x), advertising directed", addr,
+		reason);
+
+	/* Replaces the open advertising if it was kept running for further centrals */
+	ble_svc_restart_advertising();
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.connected = on_connected,
+	.disconnected = on_disconnected,
+};
+
+void fast_reconnect_init(void)
+{
+	bt_conn_cb_register(&conn_callbacks);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_FAST_RECONNECT_H_
+#define APP_FAST_RECONNECT_H_
+
+#include <stdbool.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+/*
+ * Fast reconnection of bonded centrals
+ *
+ * After a bonded central disconnected, the connectable advertising goes through three modes:
+ * - Directed: high duty cycle directed advertising to the central for 1.28 s. A central that
+ *   initiates a connection to the sensor, e.g. a gateway with auto-connect, is reconnected
+ *   within a few milliseconds.
+ * - Accept list: undirected advertising with the fast interval (30 - 60 ms), only centrals in
+ *   the filter accept list (all bonded ones) can connect. Lasts
+ *   CONFIG_BLE_FAST_RECONNECT_WINDOW_SECONDS after the disconnect.
+ * - Open: the configured advertising for everybody, e.g. commissioning and DFU.
+ *
+ * The bonds, the CCC values and the GATT database hash are kept in the settings, so a bonded
+ * central with GATT caching neither pairs nor discovers the services again.
+ */
+
+/**
+ * @brief Adjust the parameters of the connectable advertising to the reconnection mode.
+ *
+ * Called right before advertising starts, on the system workqueue. Fills the accept list in the
+ * accept list mode, advertising must be stopped.
+ *
+ * @param param Parameters of the open advertising, changed for the directed and the accept
+ *              list mode.
+ *
+ * @return true if the advertising is directed and must not carry data, false otherwise.
+ */
+bool fast_reconnect_adv_param(struct bt_le_adv_param *param);
+
+/**
+ * @brief Report the end of the directed advertising without a connection.
+ *
+ * Call when the connected callback reports BT_HCI_ERR_ADV_TIMEOUT, before advertising is
+ * restarted. Switches to the accept list mode.
+ */
+void fast_reconnect_directed_timeout(void);
+
+/**
+ * @brief Initialize the fast reconnection.
+ *
+ * Registers the connection callbacks.
+ */
+void fast_reconnect_init(void);
+
+#endif /* APP_FAST_RECONNECT_H_ */
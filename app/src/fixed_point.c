@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include "fixed_point.h"
+
+int32_t fixed_point_q31_to_scaled(q31_t value, int8_t shift, int32_t scale)
+{
+	int64_t scaled = (int64_t)value * scale;
+	int exp = 31 - shift;
+	int64_t magnitude;
+
+	/* Left shift of a negative value is undefined, multiply instead */
+	if (exp <= 0) {
+		return (int32_t)(scaled * (1LL << -exp));
+	}
+
+	magnitude = (llabs(scaled) + (1LL << (exp - 1))) >> exp;
+
+	return (int32_t)(scaled < 0 ? -magnitude : magnitude);
+}
+
+uint32_t fixed_point_isqrt(uint64_t value)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (uint32_t)root;
+}
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_FIXED_POINT_H_
+#define APP_FIXED_POINT_H_
+
+#include <stdint.h>
+
+#include <zephyr/dsp/types.h>
+
+/*
+ * Integer helpers shared by the measurement and statistics paths, free of FPU and division.
+ */
+
+/**
+ * @brief Convert a Q31 sensor reading to scaled integer units.
+ *
+ * Rounds half away from zero, the result is exact for every reading of the sensor decoders.
+ *
+ * @param value Q31 mantissa of the reading.
+ * @param shift Binary exponent of the reading, value * 2^shift / 2^31 in sensor API units.
+ * @param scale Units of the result per sensor API unit, e.g. 100 for 0.01 °C.
+ *
+ * @return value * 2^shift / 2^31 * scale, rounded to nearest.
+ */
+int32_t fixed_point_q31_to_scaled(q31_t value, int8_t shift, int32_t scale);
+
+/**
+ * @brief Integer square root.
+ *
+ * @param value Radicand.
+ *
+ * @return Square root of value, rounded down.
+ */
+uint32_t fixed_point_isqrt(uint64_t value);
+
+#endif /* APP_FIXED_POINT_H_ */
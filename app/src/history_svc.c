@@ -0,0 +1,813 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/devicetree.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#include "history_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(history_svc, LOG_LEVEL_INF);
+
+/*
+ * Log layout
+ *
+ * Every flash sector of the partition starts with a header that holds the first sample of the
+ * sector as absolute values. All following samples are stored as records relative to their
+ * predecessor, packed into frames of FRAME_SIZE bytes. A record never crosses a frame border,
+ * unused frame bytes are filled with TAG_PAD. Frames are collected in RAM and written once full,
+ * so flash is only touched every few samples.
+ *
+ * Record formats (first byte is the tag):
+ *  0b0TTTTHHH  dt equals the sector period, temperature delta in T (-8..7), humidity delta
+ *              in H (-4..3). A stable room fits 4000 samples into one 4 KiB sector.
+ *  TAG_LONG    dt equals the sector period, followed by zigzag varint deltas of temperature
+ *              and humidity.
+ *  TAG_TIMED   varint dt followed by zigzag varint deltas of temperature and humidity.
+ *
+ * Sectors are used round-robin, the oldest sector is erased when the active one is full. The
+ * header carries the erase count of the sector and a sector that fails to erase or program is
+ * skipped for the rest of the uptime.
+ *
+ * The settings (NVS backend) occupy the first CONFIG_SETTINGS_NVS_SECTOR_COUNT sectors of the
+ * same partition, the log starts behind them.
+ */
+
+#define HISTORY_PARTITION_ID FIXED_PARTITION_ID(storage_partition)
+#define HISTORY_MAX_SECTORS  16
+#define HISTORY_MAGIC        0x474F4C48 /* "HLOG" */
+#define FRAME_SIZE           16
+#define HDR_AREA_SIZE        ROUND_UP(sizeof(struct sector_hdr), FRAME_SIZE)
+#define MAX_RECORD_SIZE      12 /* Tag + 5 bytes dt + 3 bytes per delta */
+
+#if defined(CONFIG_SETTINGS_NVS) && !DT_HAS_CHOSEN(zephyr_settings_partition)
+#define SETTINGS_PAGES (CONFIG_SETTINGS_NVS_SECTOR_COUNT * CONFIG_SETTINGS_NVS_SECTOR_SIZE_MULT)
+#else
+#define SETTINGS_PAGES 0
+#endif
+
+#define TAG_SHORT_MASK 0x80
+#define TAG_LONG       0x80
+#define TAG_TIMED      0xC0
+#define TAG_PAD        0xFE
+#define ERASED_BYTE    0xFF
+
+BUILD_ASSERT(MAX_RECORD_SIZE <= FRAME_SIZE, "A record must fit into one frame");
+
+struct sector_hdr {
+	uint32_t magic;
+	uint32_t seq;        /* Incremented on every sector rotation */
+	uint32_t erase_cnt;  /* Number of times this sector has been erased */
+	uint32_t base_index; /* Index of the sample stored in this header */
+	uint32_t base_time;
+	int16_t base_temperature;
+	uint16_t base_humidity;
+	uint16_t period; /* dt of the short and long records in this sector */
+	uint16_t crc;
+} __packed;
+
+BUILD_ASSERT(HDR_AREA_SIZE == 2 * FRAME_SIZE);
+
+struct sector_state {
+	uint32_t seq;
+	uint32_t erase_cnt;
+	uint32_t base_index;
+	uint32_t base_time;
+	int16_t base_temperature;
+	uint16_t base_humidity;
+	uint16_t period;
+	bool valid;
+	bool bad;
+};
+
+struct history_data {
+	const struct flash_area *fa;
+	struct sector_state sectors[HISTORY_MAX_SECTORS];
+	off_t log_off; /* Offset of the first log sector, behind the settings */
+	uint32_t sector_size;
+	uint8_t sector_cnt;
+	uint8_t active;
+	bool has_active;
+	uint32_t write_off; /* Offset of the pending frame inside the active sector */
+	uint8_t frame[FRAME_SIZE];
+	uint8_t frame_len;
+	uint32_t last_dt;
+	uint32_t time_base;
+	struct history_sample last;
+	bool ready;
+};
+
+static struct history_data data;
+
+static K_MUTEX_DEFINE(history_lock);
+
+static uint32_t zigzag_encode(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t zigzag_decode(uint32_t value)
+{
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static size_t varint_encode(uint32_t value, uint8_t *buf)
+{
+	size_t len = 0;
+
+	while (value >= 0x80) {
+		buf[len++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+	buf[len++] = value;
+
+	return len;
+}
+
+static int varint_decode(const uint8_t *buf, size_t len, uint32_t *value)
+{
+	*value = 0;
+
+	for (size_t i = 0; i < MIN(len, 5); i++) {
+		*value |= (uint32_t)(buf[i] & 0x7F) << (7 * i);
+		if ((buf[i] & 0x80) == 0) {
+			return i + 1;
+		}
+	}
+
+	return -EBADMSG;
+}
+
+static size_t record_encode(const struct history_sample *prev, const struct history_sample *sample,
+			    uint16_t period, uint8_t *buf)
+{
+	int32_t dtemp = sample->temperature - prev->temperature;
+	int32_t dhum = (int32_t)sample->humidity - prev->humidity;
+	uint32_t dt = sample->timestamp - prev->timestamp;
+	size_t len = 1;
+
+	if (dt == period) {
+		if (IN_RANGE(dtemp, -8, 7) && IN_RANGE(dhum, -4, 3)) {
+			buf[0] = ((dtemp & 0xF) << 3) | (dhum & 0x7);
+			return 1;
+		}
+		buf[0] = TAG_LONG;
+	} else {
+		buf[0] = TAG_TIMED;
+		len += varint_encode(dt, &buf[len]);
+	}
+
+	len += varint_encode(zigzag_encode(dtemp), &buf[len]);
+	len += varint_encode(zigzag_encode(dhum), &buf[len]);
+
+	return len;
+}
+
+/* Decodes one record and applies it to @p sample. Returns the record length. */
+static int record_decode(const uint8_t *buf, size_t len, uint16_t period,
+			 struct history_sample *sample)
+{
+	uint32_t dt = period;
+	uint32_t value;
+	int32_t dtemp;
+	int32_t dhum;
+	size_t pos = 1;
+	int ret;
+
+	if ((buf[0] & TAG_SHORT_MASK) == 0) {
+		dtemp = sign_extend(buf[0] >> 3, 3);
+		dhum = sign_extend(buf[0] & 0x7, 2);
+	} else {
+		if (buf[0] == TAG_TIMED) {
+			ret = varint_decode(&buf[pos], len - pos, &dt);
+			if (ret < 0) {
+				return ret;
+			}
+			pos += ret;
+		} else if (buf[0] != TAG_LONG) {
+			return -EBADMSG;
+		}
+
+		ret = varint_decode(&buf[pos], len - pos, &value);
+		if (ret < 0) {
+			return ret;
+		}
+		pos += ret;
+		dtemp = zigzag_decode(value);
+
+		ret = varint_decode(&buf[pos], len - pos, &value);
+		if (ret < 0) {
+			return ret;
+		}
+		pos += ret;
+		dhum = zigzag_decode(value);
+	}
+
+	sample->index++;
+	sample->timestamp += dt;
+	sample->temperature += dtemp;
+	sample->humidity += dhum;
+
+	return pos;
+}
+
+static off_t sector_offset(uint8_t sector)
+{
+	return data.log_off + (off_t)sector * data.sector_size;
+}
+
+static uint16_t hdr_crc(const struct sector_hdr *hdr)
+{
+	return crc16_ccitt(0xFFFF, (const uint8_t *)hdr, offsetof(struct sector_hdr, crc));
+}
+
+static int hdr_read(uint8_t sector, struct sector_hdr *hdr)
+{
+	int ret;
+
+	ret = flash_area_read(data.fa, sector_offset(sector), hdr, sizeof(*hdr));
+	if (ret != 0) {
+		return ret;
+	}
+
+	if (hdr->magic != HISTORY_MAGIC || hdr->crc != hdr_crc(hdr)) {
+		return -ENOENT;
+	}
+
+	return 0;
+}
+
+static void sector_state_set(struct sector_state *state, const struct sector_hdr *hdr)
+{
+	state->seq = hdr->seq;
+	state->erase_cnt = hdr->erase_cnt;
+	state->base_index = hdr->base_index;
+	state->base_time = hdr->base_time;
+	state->base_temperature = hdr->base_temperature;
+	state->base_humidity = hdr->base_humidity;
+	state->period = hdr->period;
+	state->valid = true;
+}
+
+static int frame_write(void)
+{
+	int ret;
+
+	ret = flash_area_write(data.fa, sector_offset(data.active) + data.write_off, data.frame,
+			       FRAME_SIZE);
+	if (ret != 0) {
+		/* The frame content is lost, continue in a fresh sector */
+		LOG_ERR("Failed to write frame at sector %u offset %u: %d", data.active,
+			data.write_off, ret);
+		data.write_off = data.sector_size;
+	} else {
+		data.write_off += FRAME_SIZE;
+	}
+
+	data.frame_len = 0;
+
+	return ret;
+}
+
+static int sector_program(uint8_t sector, const struct sector_hdr *hdr)
+{
+	uint8_t buf[HDR_AREA_SIZE];
+	struct sector_hdr readback;
+	int ret;
+
+	ret = flash_area_erase(data.fa, sector_offset(sector), data.sector_size);
+	if (ret != 0) {
+		return ret;
+	}
+
+	memset(buf, ERASED_BYTE, sizeof(buf));
+	memcpy(buf, hdr, sizeof(*hdr));
+
+	ret = flash_area_write(data.fa, sector_offset(sector), buf, sizeof(buf));
+	if (ret != 0) {
+		return ret;
+	}
+
+	ret = hdr_read(sector, &readback);
+	if (ret != 0 || memcmp(&readback, hdr, sizeof(readback)) != 0) {
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* Recycles the oldest sector and stores @p sample in its header */
+static int sector_start(const struct history_sample *sample)
+{
+	uint8_t sector = data.has_active ? data.active : data.sector_cnt - 1;
+	uint32_t seq = data.has_active ? data.sectors[data.active].seq + 1 : 0;
+	struct sector_hdr hdr = {
+		.magic = HISTORY_MAGIC,
+		.seq = seq,
+		.base_index = sample->index,
+		.base_time = sample->timestamp,
+		.base_temperature = sample->temperature,
+		.base_humidity = sample->humidity,
+		.period = data.last_dt != 0 ? data.last_dt : CONFIG_MEASURING_PERIOD_SECONDS,
+	};
+	int ret;
+
+	for (uint8_t i = 0; i < data.sector_cnt; i++) {
+		struct sector_state *state;
+
+		sector = (sector + 1) % data.sector_cnt;
+		state = &data.sectors[sector];
+		if (state->bad) {
+			continue;
+		}
+
+		/* Invalidate first, cursors still pointing to this sector become stale */
+		state->valid = false;
+		hdr.erase_cnt = state->erase_cnt + 1;
+		hdr.crc = hdr_crc(&hdr);
+
+		ret = sector_program(sector, &hdr);
+		if (ret != 0) {
+			LOG_ERR("Sector %u worn out after %u erases: %d, skipping it", sector,
+				state->erase_cnt, ret);
+			state->bad = true;
+			continue;
+		}
+
+		sector_state_set(state, &hdr);
+		data.active = sector;
+		data.has_active = true;
+		data.write_off = HDR_AREA_SIZE;
+		data.frame_len = 0;
+
+		LOG_DBG("Started sector %u (seq %u, erase count %u)", sector, seq, hdr.erase_cnt);
+		return 0;
+	}
+
+	LOG_ERR("No usable sector left");
+	return -ENOSPC;
+}
+
+/* Restores the write position and the newest sample from the active sector */
+static int sector_scan(uint8_t sector)
+{
+	const struct sector_state *state = &data.sectors[sector];
+	uint8_t frame[FRAME_SIZE];
+	uint32_t off;
+	int ret;
+
+	data.last = (struct history_sample){
+		.index = state->base_index,
+		.timestamp = state->base_time,
+		.temperature = state->base_temperature,
+		.humidity = state->base_humidity,
+	};
+
+	for (off = HDR_AREA_SIZE; off + FRAME_SIZE <= data.sector_size; off += FRAME_SIZE) {
+		size_t pos = 0;
+
+		ret = flash_area_read(data.fa, sector_offset(sector) + off, frame, sizeof(frame));
+		if (ret != 0) {
+			return ret;
+		}
+
+		if (frame[0] == ERASED_BYTE) {
+			break;
+		}
+
+		while (pos < FRAME_SIZE && frame[pos] != TAG_PAD && frame[pos] != ERASED_BYTE) {
+			ret = record_decode(&frame[pos], FRAME_SIZE - pos, state->period,
+					    &data.last);
+			if (ret < 0) {
+				LOG_WRN("Corrupted frame at sector %u offset %u", sector, off);
+				off = data.sector_size;
+				goto out;
+			}
+			pos += ret;
+		}
+	}
+
+out:
+	data.write_off = off;
+	data.frame_len = 0;
+
+	return 0;
+}
+
+static int sector_find_by_seq(uint32_t seq)
+{
+	for (uint8_t i = 0; i < data.sector_cnt; i++) {
+		if (data.sectors[i].valid && data.sectors[i].seq == seq) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static int sector_find_oldest(void)
+{
+	int oldest = -ENOENT;
+
+	for (uint8_t i = 0; i < data.sector_cnt; i++) {
+		if (data.sectors[i].valid &&
+		    (oldest < 0 || data.sectors[i].seq < data.sectors[oldest].seq)) {
+			oldest = i;
+		}
+	}
+
+	return oldest;
+}
+
+static uint32_t history_time(void)
+{
+	return data.time_base + k_uptime_seconds();
+}
+
+static void cursor_enter(struct history_cursor *cursor, uint8_t sector)
+{
+	cursor->sector = sector;
+	cursor->seq = data.sectors[sector].seq;
+	cursor->frame_off = 0;
+	cursor->pos = 0;
+	cursor->buf_valid = false;
+}
+
+static int cursor_next_sector(struct history_cursor *cursor)
+{
+	int sector;
+
+	if (cursor->sector == data.active) {
+		return -ENODATA;
+	}
+
+	sector = sector_find_by_seq(cursor->seq + 1);
+	if (sector < 0) {
+		return -ENODATA;
+	}
+
+	cursor_enter(cursor, sector);
+
+	return 0;
+}
+
+static int read_next_locked(struct history_cursor *cursor, struct history_sample *sample)
+{
+	const struct sector_state *state;
+	const uint8_t *src;
+	size_t len;
+	int ret;
+
+	while (true) {
+		state = &data.sectors[cursor->sector];
+		if (!state->valid || state->seq != cursor->seq) {
+			return -ESTALE;
+		}
+
+		if (cursor->frame_off == 0) {
+			cursor->last = (struct history_sample){
+				.index = state->base_index,
+				.timestamp = state->base_time,
+				.temperature = state->base_temperature,
+				.humidity = state->base_humidity,
+			};
+			cursor->frame_off = HDR_AREA_SIZE;
+			*sample = cursor->last;
+			return 0;
+		}
+
+		if (cursor->sector == data.active && cursor->frame_off == data.write_off) {
+			/* Pending frame, not written to flash yet */
+			if (cursor->pos >= data.frame_len) {
+				return -ENODATA;
+			}
+			src = data.frame;
+			len = data.frame_len;
+		} else {
+			if (cursor->frame_off + FRAME_SIZE > data.sector_size) {
+				ret = cursor_next_sector(cursor);
+				if (ret != 0) {
+					return ret;
+				}
+				continue;
+			}
+
+			if (!cursor->buf_valid) {
+				ret = flash_area_read(data.fa,
+						      sector_offset(cursor->sector) +
+							      cursor->frame_off,
+						      cursor->buf, FRAME_SIZE);
+				if (ret != 0) {
+					return ret;
+				}
+				cursor->buf_valid = true;
+			}
+			src = cursor->buf;
+			len = FRAME_SIZE;
+
+			if (cursor->pos >= len || src[cursor->pos] == TAG_PAD) {
+				cursor->frame_off += FRAME_SIZE;
+				cursor->pos = 0;
+				cursor->buf_valid = false;
+				continue;
+			}
+
+			if (src[cursor->pos] == ERASED_BYTE) {
+				ret = cursor_next_sector(cursor);
+				if (ret != 0) {
+					return ret;
+				}
+				continue;
+			}
+		}
+
+		ret = record_decode(&src[cursor->pos], len - cursor->pos, state->period,
+				    &cursor->last);
+		if (ret < 0) {
+			LOG_WRN("Skipping corrupted sector %u", cursor->sector);
+			cursor->frame_off = data.sector_size;
+			continue;
+		}
+
+		cursor->pos += ret;
+		*sample = cursor->last;
+		return 0;
+	}
+}
+
+static int seek_locked(struct history_cursor *cursor, bool by_time, uint32_t value)
+{
+	struct history_sample sample;
+	int sector = sector_find_oldest();
+	int ret;
+
+	if (sector < 0) {
+		return -ENODATA;
+	}
+
+	/* Newest sector that starts at or before the requested position */
+	for (uint8_t i = 0; i < data.sector_cnt; i++) {
+		const struct sector_state *state = &data.sectors[i];
+		uint32_t base = by_time ? state->base_time : state->base_index;
+
+		if (state->valid && base <= value && state->seq > data.sectors[sector].seq) {
+			sector = i;
+		}
+	}
+
+	cursor_enter(cursor, sector);
+
+	while (true) {
+		struct history_cursor next = *cursor;
+
+		ret = read_next_locked(&next, &sample);
+		if (ret == -ENODATA) {
+			return 0;
+		}
+		if (ret != 0) {
+			return ret;
+		}
+
+		if ((by_time ? sample.timestamp : sample.index) >= value) {
+			return 0;
+		}
+
+		*cursor = next;
+	}
+}
+
+int history_svc_append(int16_t temperature, uint16_t humidity)
+{
+	struct history_sample sample = {
+		.temperature = temperature,
+		.humidity = humidity,
+	};
+	uint8_t record[MAX_RECORD_SIZE];
+	size_t len;
+	int ret = 0;
+
+	if (!data.ready) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&history_lock, K_FOREVER);
+
+	sample.timestamp = history_time();
+	sample.index = data.has_active ? data.last.index + 1 : 0;
+
+	if (!data.has_active) {
+		ret = sector_start(&sample);
+		goto out;
+	}
+
+	len = record_encode(&data.last, &sample, data.sectors[data.active].period, record);
+
+	if (data.frame_len + len > FRAME_SIZE) {
+		memset(&data.frame[data.frame_len], TAG_PAD, FRAME_SIZE - data.frame_len);
+		(void)frame_write();
+	}
+
+	if (data.write_off + FRAME_SIZE > data.sector_size) {
+		ret = sector_start(&sample);
+		goto out;
+	}
+
+	memcpy(&data.frame[data.frame_len], record, len);
+	data.frame_len += len;
+
+	if (data.frame_len == FRAME_SIZE) {
+		ret = frame_write();
+	}
+
+out:
+	if (ret == 0) {
+		if (sample.index != 0) {
+			data.last_dt = sample.timestamp - data.last.timestamp;
+		}
+		data.last = sample;
+	}
+
+	k_mutex_unlock(&history_lock);
+
+	return ret;
+}
+
+int history_svc_flush(void)
+{
+	int ret = 0;
+
+	if (!data.ready) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&history_lock, K_FOREVER);
+
+	if (data.has_active && data.frame_len > 0) {
+		memset(&data.frame[data.frame_len], TAG_PAD, FRAME_SIZE - data.frame_len);
+		ret = frame_write();
+	}
+
+	k_mutex_unlock(&history_lock);
+
+	return ret;
+}
+
+int history_svc_seek_index(struct history_cursor *cursor, uint32_t index)
+{
+	int ret;
+
+	if (!data.ready) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&history_lock, K_FOREVER);
+	ret = seek_locked(cursor, false, index);
+	k_mutex_unlock(&history_lock);
+
+	return ret;
+}
+
+int history_svc_seek_time(struct history_cursor *cursor, uint32_t timestamp)
+{
+	int ret;
+
+	if (!data.ready) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&history_lock, K_FOREVER);
+	ret = seek_locked(cursor, true, timestamp);
+	k_mutex_unlock(&history_lock);
+
+	return ret;
+}
+
+int history_svc_read_next(struct history_cursor *cursor, struct history_sample *sample)
+{
+	int ret;
+
+	if (!data.ready) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&history_lock, K_FOREVER);
+	ret = read_next_locked(cursor, sample);
+	k_mutex_unlock(&history_lock);
+
+	return ret;
+}
+
+void history_svc_get_info(struct history_info *info)
+{
+	int oldest;
+
+	k_mutex_lock(&history_lock, K_FOREVER);
+
+	oldest = sector_find_oldest();
+
+	*info = (struct history_info){
+		.first_index = oldest < 0 ? 0 : data.sectors[oldest].base_index,
+		.next_index = data.has_active ? data.last.index + 1 : 0,
+		.time = history_time(),
+	};
+
+	for (uint8_t i = 0; i < data.sector_cnt; i++) {
+		if (!data.sectors[i].bad) {
+			info->sector_cnt++;
+		}
+		info->max_erase_cnt = MAX(info->max_erase_cnt, data.sectors[i].erase_cnt);
+	}
+
+	k_mutex_unlock(&history_lock);
+}
+
+uint32_t history_svc_get_time(void)
+{
+	return history_time();
+}
+
+int history_svc_init(void)
+{
+	const struct device *flash_dev;
+	struct flash_pages_info page;
+	struct sector_hdr hdr;
+	int newest = -ENOENT;
+	int ret;
+
+	/* Everything is restored from flash, also when mounted again */
+	data = (struct history_data){0};
+
+	ret = flash_area_open(HISTORY_PARTITION_ID, &data.fa);
+	if (ret != 0) {
+		LOG_ERR("Failed to open storage partition: %d", ret);
+		return ret;
+	}
+
+	flash_dev = flash_area_get_device(data.fa);
+	if (!device_is_ready(flash_dev)) {
+		LOG_ERR("Flash device not ready");
+		return -ENODEV;
+	}
+
+	ret = flash_get_page_info_by_offs(flash_dev, data.fa->fa_off, &page);
+	if (ret != 0) {
+		LOG_ERR("Failed to get flash page info: %d", ret);
+		return ret;
+	}
+
+	if (FRAME_SIZE % flash_get_write_block_size(flash_dev) != 0) {
+		LOG_ERR("Unsupported flash write block size");
+		return -ENOTSUP;
+	}
+
+	data.sector_size = page.size;
+	data.log_off = (off_t)SETTINGS_PAGES * page.size;
+	if (data.fa->fa_size > (size_t)data.log_off) {
+		data.sector_cnt =
+			MIN((data.fa->fa_size - data.log_off) / page.size, HISTORY_MAX_SECTORS);
+	}
+	if (data.sector_cnt < 2) {
+		LOG_ERR("History log needs at least 2 sectors");
+		return -ENOSPC;
+	}
+
+	for (uint8_t i = 0; i < data.sector_cnt; i++) {
+		if (hdr_read(i, &hdr) != 0) {
+			continue;
+		}
+
+		sector_state_set(&data.sectors[i], &hdr);
+		if (newest < 0 || hdr.seq > data.sectors[newest].seq) {
+			newest = i;
+		}
+	}
+
+	if (newest >= 0) {
+		ret = sector_scan(newest);
+		if (ret != 0) {
+			LOG_ERR("Failed to scan active sector: %d", ret);
+			return ret;
+		}
+		data.active = newest;
+		data.has_active = true;
+		data.last_dt = data.sectors[newest].period;
+		data.time_base = data.last.timestamp;
+	}
+
+	data.ready = true;
+
+	LOG_INF("History log: %u sectors of %u bytes, %s", data.sector_cnt, data.sector_size,
+		data.has_active ? "restored" : "empty");
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_HISTORY_SVC_H_
+#define APP_HISTORY_SVC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct history_sample {
+	uint32_t index;      /* Monotonic sample index */
+	uint32_t timestamp;  /* Log time in seconds, monotonic across reboots */
+	int16_t temperature; /* Temperature in 0.01 °C */
+	uint16_t humidity;   /* Humidity in 0.01 % */
+};
+
+struct history_info {
+	uint32_t first_index;   /* Index of the oldest sample still stored */
+	uint32_t next_index;    /* Index the next appended sample will get */
+	uint32_t time;          /* Current log time in seconds */
+	uint32_t max_erase_cnt; /* Highest erase count of all log sectors */
+	uint8_t sector_cnt;     /* Number of usable log sectors */
+};
+
+/*
+ * Read position inside the log. The content is private to the history service,
+ * it is only exposed so callers can keep cursors on the stack or in static data.
+ */
+struct history_cursor {
+	uint32_t seq;
+	uint32_t frame_off;
+	uint8_t sector;
+	uint8_t pos;
+	bool buf_valid;
+	uint8_t buf[16];
+	struct history_sample last;
+};
+
+/**
+ * @brief Append a measurement to the history log.
+ *
+ * Encodes the sample as a delta to the previous one. Flash is only written once a full
+ * frame of samples is collected, or a sector is rotated, so the cost per call is constant.
+ *
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Humidity in 0.01 %.
+ *
+ * @return 0 on success, -ENODEV if the log is not available, or error code.
+ */
+int history_svc_append(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Write the samples that are still buffered in RAM to flash.
+ *
+ * Pads the pending frame, so calling this often wastes log space. Use it before a
+ * planned reboot only.
+ *
+ * @return 0 on success, or error code.
+ */
+int history_svc_flush(void);
+
+/**
+ * @brief Position a cursor at the first stored sample with an index >= @p index.
+ *
+ * @param cursor Cursor to initialize.
+ * @param index Sample index to start from. Older indexes are clamped to the oldest sample.
+ *
+ * @return 0 on success, -ENODATA if the log is empty, or error code.
+ */
+int history_svc_seek_index(struct history_cursor *cursor, uint32_t index);
+
+/**
+ * @brief Position a cursor at the first stored sample with a timestamp >= @p timestamp.
+ *
+ * @param cursor Cursor to initialize.
+ * @param timestamp Log time in seconds.
+ *
+ * @return 0 on success, -ENODATA if the log is empty, or error code.
+ */
+int history_svc_seek_time(struct history_cursor *cursor, uint32_t timestamp);
+
+/**
+ * @brief Read the next sample and advance the cursor.
+ *
+ * @param cursor Cursor positioned by one of the seek functions.
+ * @param sample Decoded sample.
+ *
+ * @return 0 on success, -ENODATA when all samples are read, -ESTALE if the sector the cursor
+ *         points to was recycled meanwhile, or error code.
+ */
+int history_svc_read_next(struct history_cursor *cursor, struct history_sample *sample);
+
+/**
+ * @brief Get the current state of the history log.
+ *
+ * @param info Filled with the log state.
+ */
+void history_svc_get_info(struct history_info *info);
+
+/**
+ * @brief Current log time in seconds.
+ *
+ * The log time continues from the newest stored sample after a reboot, it is not a wall clock.
+ *
+ * @return Log time in seconds.
+ */
+uint32_t history_svc_get_time(void);
+
+/**
+ * @brief Mount the history log in the storage partition.
+ *
+ * Scans the sector headers and the active sector to restore the write position. The log starts
+ * behind the settings sectors of the partition.
+ *
+ * @return 0 on success, or error code.
+ */
+int history_svc_init(void);
+
+#endif /* APP_HISTORY_SVC_H_ */
@@ -0,0 +1,434 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/att.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "conn_param_policy.h"
+#include "history_svc.h"
+#include "history_transfer_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(history_transfer_svc, LOG_LEVEL_INF);
+
+#define BT_UUID_HISTORY_SVC_VAL                                                                    \
+	BT_UUID_128_ENCODE(0x8b5a0000, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+#define BT_UUID_HISTORY_CTRL_VAL                                                                   \
+	BT_UUID_128_ENCODE(0x8b5a0001, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+#define BT_UUID_HISTORY_DATA_VAL                                                                   \
+	BT_UUID_128_ENCODE(0x8b5a0002, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+
+#define BT_UUID_HISTORY_SVC  BT_UUID_DECLARE_128(BT_UUID_HISTORY_SVC_VAL)
+#define BT_UUID_HISTORY_CTRL BT_UUID_DECLARE_128(BT_UUID_HISTORY_CTRL_VAL)
+#define BT_UUID_HISTORY_DATA BT_UUID_DECLARE_128(BT_UUID_HISTORY_DATA_VAL)
+
+#define OPCODE_START_INDEX 0x01
+#define OPCODE_START_TIME  0x02
+#define OPCODE_ABORT       0x03
+
+#define PACKET_TYPE_DATA     0x01
+#define PACKET_TYPE_COMPLETE 0x02
+
+#define DATA_HDR_SIZE   10
+#define DATA_ENTRY_SIZE 6
+#define COMPLETE_SIZE   17
+#define ATT_NOTIFY_HDR  3
+/* One notification per 251 byte LL PDU: 251 - 4 (L2CAP) - 3 (ATT) */
+#define PACKET_MAX_SIZE 244
+/* Keep one ACL buffer free for the ESS notifications and MCUmgr */
+#define MAX_IN_FLIGHT   MAX(1, CONFIG_BT_BUF_ACL_TX_COUNT - 1)
+#define DATA_ATTR_IDX   3
+/* Retry of a notification that found no TX buffer while none of ours was in flight */
+#define RETRY_DELAY_MS  20
+/* Gives up after 1 s without a TX buffer */
+#define RETRY_MAX       50
+
+/* Every packet of a transfer fits into a notification at the default ATT MTU */
+BUILD_ASSERT(COMPLETE_SIZE <= BT_ATT_DEFAULT_LE_MTU - ATT_NOTIFY_HDR);
+BUILD_ASSERT(DATA_HDR_SIZE + DATA_ENTRY_SIZE <= BT_ATT_DEFAULT_LE_MTU - ATT_NOTIFY_HDR);
+
+enum transfer_request {
+	REQUEST_NONE,
+	REQUEST_START_INDEX,
+	REQUEST_START_TIME,
+	REQUEST_ABORT,
+};
+
+/*
+ * Thread-safety: The control point only stores the request under the lock and submits the
+ * work item. The transfer state is only touched by transfer_work_handler on the system workqueue,
+ * except for conn, which is also read by the disconnect callback and therefore only changed and
+ * read under the lock.
+ */
+struct history_transfer_data {
+	struct k_spinlock lock;
+	enum transfer_request request;
+	uint32_t request_arg;
+	struct bt_conn *request_conn;
+
+	struct bt_conn *conn;
+	bool active;
+	struct history_cursor cursor;
+	struct history_sample next;
+	bool has_next;
+	uint32_t first_index;
+	uint32_t next_index;
+	uint32_t count;
+	uint32_t crc;
+	uint8_t packet[PACKET_MAX_SIZE];
+	uint16_t packet_len;
+	uint8_t retries;
+	atomic_t in_flight;
+};
+
+static struct history_transfer_data data;
+
+static void transfer_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(transfer_work, transfer_work_handler);
+
+static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags);
+
+static void data_cfg_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	bool notif_enabled = (value == BT_GATT_CCC_NOTIFY);
+
+	LOG_DBG("History data notifications %s", notif_enabled ? "enabled" : "disabled");
+}
+
+BT_GATT_SERVICE_DEFINE(history_transfer_service, BT_GATT_PRIMARY_SERVICE(BT_UUID_HISTORY_SVC),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_HISTORY_CTRL, BT_GATT_CHRC_WRITE,
+					      BT_GATT_PERM_WRITE, NULL, write_control, NULL),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_HISTORY_DATA, BT_GATT_CHRC_NOTIFY,
+					      BT_GATT_PERM_NONE, NULL, NULL, NULL),
+		       BT_GATT_CCC(data_cfg_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf,
+			     uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const uint8_t *value = buf;
+	enum transfer_request request;
+	uint32_t arg = 0;
+	k_spinlock_key_t key;
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	if (len < 1) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	switch (value[0]) {
+	case OPCODE_START_INDEX:
+	case OPCODE_START_TIME:
+		if (len != 1 + sizeof(uint32_t)) {
+			return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+		}
+		if (!bt_gatt_is_subscribed(conn, &history_transfer_service.attrs[DATA_ATTR_IDX],
+					   BT_GATT_CCC_NOTIFY)) {
+			return BT_GATT_ERR(BT_ATT_ERR_CCC_IMPROPER_CONF);
+		}
+		request = value[0] == OPCODE_START_INDEX ? REQUEST_START_INDEX : REQUEST_START_TIME;
+		arg = sys_get_le32(&value[1]);
+		break;
+
+	case OPCODE_ABORT:
+		request = REQUEST_ABORT;
+		break;
+
+	default:
+		return BT_GATT_ERR(BT_ATT_ERR_NOT_SUPPORTED);
+	}
+
+	key = k_spin_lock(&data.lock);
+	if (data.request_conn != NULL) {
+		bt_conn_unref(data.request_conn);
+	}
+	data.request = request;
+	data.request_arg = arg;
+	data.request_conn = bt_conn_ref(conn);
+	k_spin_unlock(&data.lock, key);
+
+	k_work_reschedule(&transfer_work, K_NO_WAIT);
+
+	return len;
+}
+
+static void notify_sent(struct bt_conn *conn, void *user_data)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(user_data);
+
+	atomic_dec(&data.in_flight);
+	k_work_reschedule(&transfer_work, K_NO_WAIT);
+}
+
+static void transfer_stop(void)
+{
+	struct bt_conn *conn;
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data.lock);
+	conn = data.conn;
+	data.conn = NULL;
+	k_spin_unlock(&data.lock, key);
+
+	if (conn != NULL) {
+		if (IS_ENABLED(CONFIG_CONN_PARAM_POLICY)) {
+			conn_param_policy_set_activity(conn, CONN_PARAM_ACTIVITY_HISTORY_TRANSFER,
+						       false);
+		}
+		bt_conn_unref(conn);
+	}
+	data.active = false;
+	data.packet_len = 0;
+	data.retries = 0;
+}
+
+static int transfer_start(struct bt_conn *conn, enum transfer_request request, uint32_t arg)
+{
+	struct history_info info;
+	k_spinlock_key_t key;
+	int ret;
+
+	transfer_stop();
+
+	if (request == REQUEST_START_INDEX) {
+		ret = history_svc_seek_index(&data.cursor, arg);
+	} else {
+		ret = history_svc_seek_time(&data.cursor, arg);
+	}
+
+	key = k_spin_lock(&data.lock);
+	data.conn = bt_conn_ref(conn);
+	k_spin_unlock(&data.lock, key);
+
+	data.active = true;
+	if (IS_ENABLED(CONFIG_CONN_PARAM_POLICY)) {
+		conn_param_policy_set_activity(conn, CONN_PARAM_ACTIVITY_HISTORY_TRANSFER, true);
+	}
+	data.has_next = false;
+	data.count = 0;
+	data.crc = 0;
+
+	if (ret == -ENODATA) {
+		/* Empty log, the transfer consists of the completion record only */
+		data.first_index = 0;
+		data.next_index = 0;
+		return 0;
+	}
+
+	if (ret != 0) {
+		transfer_stop();
+		return ret;
+	}
+
+	ret = history_svc_read_next(&data.cursor, &data.next);
+	if (ret == 0) {
+		data.has_next = true;
+		data.first_index = data.next.index;
+	} else {
+		/* Nothing stored at or after the requested position yet */
+		history_svc_get_info(&info);
+		data.first_index = info.next_index;
+	}
+	data.next_index = data.first_index;
+
+	LOG_INF("History transfer started at index %u", data.first_index);
+
+	return 0;
+}
+
+/* Packs as many samples as fit into the negotiated ATT MTU */
+static int packet_build(uint16_t max_len)
+{
+	uint8_t *packet = data.packet;
+	struct history_sample prev;
+	uint8_t count = 0;
+	uint16_t len = DATA_HDR_SIZE;
+	int ret;
+
+	if (!data.has_next) {
+		return -ENODATA;
+	}
+
+	packet[0] = PACKET_TYPE_DATA;
+	sys_put_le32(data.next.index, &packet[1]);
+	sys_put_le32(data.next.timestamp, &packet[5]);
+	prev = data.next;
+
+	while (data.has_next && len + DATA_ENTRY_SIZE <= max_len && count < UINT8_MAX) {
+		uint32_t dt = data.next.timestamp - prev.timestamp;
+
+		if (dt > UINT16_MAX) {
+			break;
+		}
+
+		sys_put_le16(dt, &packet[len]);
+		sys_put_le16(data.next.temperature, &packet[len + 2]);
+		sys_put_le16(data.next.humidity, &packet[len + 4]);
+		len += DATA_ENTRY_SIZE;
+		count++;
+
+		prev = data.next;
+		ret = history_svc_read_next(&data.cursor, &data.next);
+		if (ret == -ESTALE) {
+			/* The log overtook us, skip ahead to the oldest stored sample */
+			LOG_WRN("History transfer lost samples after index %u", prev.index);
+			ret = history_svc_seek_index(&data.cursor, prev.index + 1);
+			if (ret == 0) {
+				ret = history_svc_read_next(&data.cursor, &data.next);
+			}
+		}
+		data.has_next = (ret == 0);
+	}
+
+	packet[9] = count;
+	data.packet_len = len;
+	data.next_index = prev.index + 1;
+	data.count += count;
+
+	return 0;
+}
+
+static void packet_build_complete(void)
+{
+	uint8_t *packet = data.packet;
+
+	packet[0] = PACKET_TYPE_COMPLETE;
+	sys_put_le32(data.next_index, &packet[1]);
+	sys_put_le32(data.count, &packet[5]);
+	sys_put_le32(history_svc_get_time(), &packet[9]);
+	sys_put_le32(data.crc, &packet[13]);
+	data.packet_len = COMPLETE_SIZE;
+}
+
+static void transfer_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	enum transfer_request request;
+	struct bt_conn *request_conn;
+	uint32_t request_arg;
+	k_spinlock_key_t key;
+	bool complete = false;
+	int ret;
+
+	key = k_spin_lock(&data.lock);
+	request = data.request;
+	request_arg = data.request_arg;
+	request_conn = data.request_conn;
+	data.request = REQUEST_NONE;
+	data.request_conn = NULL;
+	k_spin_unlock(&data.lock, key);
+
+	if (request == REQUEST_ABORT) {
+		LOG_INF("History transfer aborted");
+		transfer_stop();
+	} else if (request != REQUEST_NONE) {
+		ret = transfer_start(request_conn, request, request_arg);
+		if (ret != 0) {
+			LOG_ERR("Failed to start history transfer: %d", ret);
+		}
+	}
+
+	if (request_conn != NULL) {
+		bt_conn_unref(request_conn);
+	}
+
+	while (data.active && atomic_get(&data.in_flight) < MAX_IN_FLIGHT) {
+		struct bt_gatt_notify_params params = {
+			.attr = &history_transfer_service.attrs[DATA_ATTR_IDX],
+			.func = notify_sent,
+		};
+
+		if (data.packet_len == 0) {
+			uint16_t max_len = MIN(bt_gatt_get_mtu(data.conn) - ATT_NOTIFY_HDR,
+					       PACKET_MAX_SIZE);
+
+			ret = packet_build(max_len);
+			if (ret == -ENODATA) {
+				packet_build_complete();
+				complete = true;
+			}
+		}
+
+		params.data = data.packet;
+		params.len = data.packet_len;
+
+		atomic_inc(&data.in_flight);
+		ret = bt_gatt_notify_cb(data.conn, &params);
+		if (ret == -ENOMEM) {
+			/*
+			 * Out of TX buffers, retried when the next notification is sent. If none
+			 * of ours is in flight, other traffic holds the buffers, poll for them.
+			 */
+			if (atomic_dec(&data.in_flight) != 1) {
+				break;
+			}
+			if (++data.retries > RETRY_MAX) {
+				LOG_WRN("History transfer stopped, no TX buffer");
+				transfer_stop();
+				break;
+			}
+			k_work_schedule(&transfer_work, K_MSEC(RETRY_DELAY_MS));
+			break;
+		}
+		if (ret != 0) {
+			atomic_dec(&data.in_flight);
+			LOG_WRN("History transfer stopped: %d", ret);
+			transfer_stop();
+			break;
+		}
+		data.retries = 0;
+
+		if (complete) {
+			LOG_INF("History transfer complete, %u samples", data.count);
+			transfer_stop();
+			break;
+		}
+
+		data.crc = crc32_ieee_update(data.crc, data.packet, data.packet_len);
+		data.packet_len = 0;
+	}
+}
+
+static void on_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	ARG_UNUSED(reason);
+
+	k_spinlock_key_t key = k_spin_lock(&data.lock);
+	bool transferring = (data.conn == conn);
+
+	/* Let the workqueue drop the transfer, it owns the transfer state */
+	if (transferring && data.request == REQUEST_NONE) {
+		data.request = REQUEST_ABORT;
+	}
+	k_spin_unlock(&data.lock, key);
+
+	if (transferring) {
+		k_work_reschedule(&transfer_work, K_NO_WAIT);
+	}
+}
+
+static struct bt_conn_cb conn_callbacks = {
+	.disconnected = on_disconnected,
+};
+
+void history_transfer_svc_init(void)
+{
+	bt_conn_cb_register(&conn_callbacks);
+}
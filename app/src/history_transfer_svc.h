@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_HISTORY_TRANSFER_SVC_H_
+#define APP_HISTORY_TRANSFER_SVC_H_
+
+/*
+ * History transfer GATT service
+ *
+ * Control point (write):
+ *   0x01 <u32 index>      Stream samples starting at sample index. Resuming an interrupted
+ *                         download is a start at the next index of the last received packet.
+ *   0x02 <u32 timestamp>  Stream samples starting at log time in seconds.
+ *   0x03                  Abort a running transfer.
+ *
+ * Data (notify), all values little endian:
+ *   0x01 <u32 first index> <u32 first timestamp> <u8 count>
+ *        count x (<u16 dt> <s16 temperature> <u16 humidity>)
+ *        dt is the time since the previous sample of the packet (0 for the first one),
+ *        temperature in 0.01 °C, humidity in 0.01 %.
+ *   0x02 <u32 next index> <u32 count> <u32 log time> <u32 crc>
+ *        Completion record. crc is the CRC-32 (IEEE) over all data packets of the transfer.
+ *        17 bytes, it fits into a notification at the default ATT MTU of 23.
+ */
+
+/**
+ * @brief Initialize the history transfer service.
+ */
+void history_transfer_svc_init(void);
+
+#endif /* APP_HISTORY_TRANSFER_SVC_H_ */
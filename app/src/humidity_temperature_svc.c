@@ -4,68 +4,608 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
+
 #include <zephyr/device.h>
+#include <zephyr/devicetree.h>
 #include <zephyr/kernel.h>
+#include <zephyr/rtio/rtio.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
 
+#include "fixed_point.h"
 #include "humidity_temperature_svc.h"
+#include "latency_stats.h"
+#include "measurement_filter.h"
 
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_REGISTER(humidity_temperature_svc, LOG_LEVEL_DBG);
 
-static const struct device *const rh_temp_dev = DEVICE_DT_GET(DT_ALIAS(sht_sensor));
+/*
+ * Sensor registry. A board lists its sensors in the environmental-sensors property of the
+ * zephyr,user node, boards without the list have a single sensor under the sht-sensor alias.
+ */
+#define ZEPHYR_USER_NODE DT_PATH(zephyr_user)
+
+#if DT_NODE_HAS_PROP(ZEPHYR_USER_NODE, environmental_sensors)
+#define SENSOR_COUNT     DT_PROP_LEN(ZEPHYR_USER_NODE, environmental_sensors)
+#define SENSOR_NODE(idx) DT_PHANDLE_BY_IDX(ZEPHYR_USER_NODE, environmental_sensors, idx)
+#else
+#define SENSOR_COUNT     1
+#define SENSOR_NODE(idx) DT_ALIAS(sht_sensor)
+#endif
+
+/* Channel set by compatible: temperature and humidity (TH), plus pressure (THP), or TP */
+#define SENSOR_KIND(node)                                                                          \
+	COND_CODE_1(DT_NODE_HAS_COMPAT(node, bosch_bme280), (THP),                                 \
+		    (COND_CODE_1(DT_NODE_HAS_COMPAT(node, bosch_bmp388), (TP),                     \
+				 (COND_CODE_1(DT_NODE_HAS_COMPAT(node, bosch_bmp581), (TP),        \
+					      (TH))))))
+
+#define TEMPERATURE_SPEC {SENSOR_CHAN_AMBIENT_TEMP, 0}
+#define HUMIDITY_SPEC    {SENSOR_CHAN_HUMIDITY, 0}
+#define PRESSURE_SPEC    {SENSOR_CHAN_PRESS, 0}
+
+#define KIND_SPECS_TH  TEMPERATURE_SPEC, HUMIDITY_SPEC
+#define KIND_SPECS_THP TEMPERATURE_SPEC, HUMIDITY_SPEC, PRESSURE_SPEC
+#define KIND_SPECS_TP  TEMPERATURE_SPEC, PRESSURE_SPEC
+
+#define KIND_MASK_TH  (BIT(MEASUREMENT_CHANNEL_TEMPERATURE) | BIT(MEASUREMENT_CHANNEL_HUMIDITY))
+#define KIND_MASK_THP (KIND_MASK_TH | BIT(MEASUREMENT_CHANNEL_PRESSURE))
+#define KIND_MASK_TP  (BIT(MEASUREMENT_CHANNEL_TEMPERATURE) | BIT(MEASUREMENT_CHANNEL_PRESSURE))
+
+#define KIND_SLOTS_TH  2
+#define KIND_SLOTS_THP 3
+#define KIND_SLOTS_TP  2
+
+#define SENSOR_IODEV_DEFINE(idx, ...)                                                              \
+	SENSOR_DT_READ_IODEV(sensor_iodev_##idx, SENSOR_NODE(idx),                                 \
+			     UTIL_CAT(KIND_SPECS_, SENSOR_KIND(SENSOR_NODE(idx))))
+
+#define SENSOR_ENTRY(idx, ...)                                                                     \
+	{                                                                                          \
+		.dev = DEVICE_DT_GET(SENSOR_NODE(idx)),                                            \
+		.bus = DEVICE_DT_GET(DT_BUS(SENSOR_NODE(idx))),                                    \
+		.iodev = &sensor_iodev_##idx,                                                      \
+		.channels = UTIL_CAT(KIND_MASK_, SENSOR_KIND(SENSOR_NODE(idx))),                   \
+	}
+
+#define SENSOR_SLOTS(idx, ...) +UTIL_CAT(KIND_SLOTS_, SENSOR_KIND(SENSOR_NODE(idx)))
+
+/* One slot per channel of every sensor */
+#define SLOT_COUNT (0 LISTIFY(SENSOR_COUNT, SENSOR_SLOTS, ()))
+
+BUILD_ASSERT(SENSOR_COUNT <= 32, "The sensor masks hold at most 32 sensors");
+
+/* A round takes one read per sensor plus one callback per bus, each read one buffer */
+#define SENSOR_RTIO_QUEUE_SIZE (2 * SENSOR_COUNT)
+#define SENSOR_BUF_BLOCK_COUNT (SENSOR_COUNT + 1)
+#define SENSOR_BUF_BLOCK_SIZE  64
+#define OVERSAMPLING           CONFIG_MEASUREMENT_OVERSAMPLING
+/* A failed read cancels the rest of its bus chain, including the chain callback */
+#define ROUND_TIMEOUT_MS       500
+
+/* Read user data: the low 24 bits of the round above the sensor index */
+#define ROUND_TAG(round)          ((uint32_t)(round) & 0xFFFFFF)
+#define READ_TAG(round, idx)      ((void *)(uintptr_t)((ROUND_TAG(round) << 8) | (idx)))
+#define READ_TAG_ROUND(userdata)  ((uint32_t)((uintptr_t)(userdata) >> 8) & 0xFFFFFF)
+#define READ_TAG_SENSOR(userdata) ((size_t)((uintptr_t)(userdata) & 0xFF))
+
+#if defined(CONFIG_MEASUREMENT_BURST_OUTLIER_MEAN)
+#define TEMPERATURE_OUTLIER_LIMIT CONFIG_MEASUREMENT_OUTLIER_LIMIT_TEMP_CENTI
+#define HUMIDITY_OUTLIER_LIMIT    CONFIG_MEASUREMENT_OUTLIER_LIMIT_HUMIDITY_CENTI
+#define PRESSURE_OUTLIER_LIMIT    CONFIG_MEASUREMENT_OUTLIER_LIMIT_PRESSURE_PA
+#else
+#define TEMPERATURE_OUTLIER_LIMIT 0
+#define HUMIDITY_OUTLIER_LIMIT    0
+#define PRESSURE_OUTLIER_LIMIT    0
+#endif
+
+struct sensor_entry {
+	const struct device *dev;
+	const struct device *bus;
+	struct rtio_iodev *iodev;
+	uint8_t channels; /* BIT(enum measurement_channel) of every channel it provides */
+};
+
+struct channel_desc {
+	enum sensor_channel chan;
+	int32_t scale; /* Units of the store per unit of the sensor API */
+	int32_t outlier_limit;
+};
+
+LISTIFY(SENSOR_COUNT, SENSOR_IODEV_DEFINE, (;));
 
+static const struct sensor_entry sensors[] = {
+	LISTIFY(SENSOR_COUNT, SENSOR_ENTRY, (,)),
+};
+
+static const struct channel_desc channels[MEASUREMENT_CHANNEL_COUNT] = {
+	[MEASUREMENT_CHANNEL_TEMPERATURE] = {SENSOR_CHAN_AMBIENT_TEMP, 100,
+					     TEMPERATURE_OUTLIER_LIMIT},
+	[MEASUREMENT_CHANNEL_HUMIDITY] = {SENSOR_CHAN_HUMIDITY, 100, HUMIDITY_OUTLIER_LIMIT},
+	/* The sensor API reports kPa */
+	[MEASUREMENT_CHANNEL_PRESSURE] = {SENSOR_CHAN_PRESS, 1000, PRESSURE_OUTLIER_LIMIT},
+};
+
+RTIO_DEFINE_WITH_MEMPOOL(sensor_rtio, SENSOR_RTIO_QUEUE_SIZE, SENSOR_RTIO_QUEUE_SIZE,
+			 SENSOR_BUF_BLOCK_COUNT, SENSOR_BUF_BLOCK_SIZE, sizeof(void *));
+
+/*
+ * Struct-of-arrays sample store. The channels of a sensor occupy consecutive slots from its
+ * first_slot on, in the order of enum measurement_channel.
+ */
+struct sample_store {
+	int32_t value[SLOT_COUNT];
+	int16_t status[SLOT_COUNT]; /* 0 or a negative error code */
+	/* IIR state, kept across measurements */
+	struct measurement_filter_channel filter[SLOT_COUNT];
+	/* Reads of the burst in progress */
+	int32_t burst[SLOT_COUNT][OVERSAMPLING];
+};
+
+/*
+ * Thread-safety: Apart from the RTIO chain callbacks, which only count down chains_pending and
+ * submit read_done_work, everything runs on the system workqueue.
+ */
 struct humidity_temperature_data {
-	struct sensor_value humidity;
-	struct sensor_value temperature;
+	humidity_temperature_svc_cb_t callback;
+	bool pending;
+	uint32_t read_start; /* Cycle count at submit, for the latency statistics */
+	atomic_t round;      /* Tags the reads and chains of the round in flight */
+	atomic_t chains_pending;
+	uint8_t rounds;
+	/* Registry layout, set up by init */
+	uint32_t ready_mask;
+	uint8_t bus_count;
+	uint8_t bus_index[SENSOR_COUNT];
+	uint8_t first_slot[SENSOR_COUNT];
+	int8_t primary_slot[MEASUREMENT_CHANNEL_COUNT];
+	/* Per sensor: good reads of the burst and the last read error */
+	uint8_t reads[SENSOR_COUNT];
+	int16_t error[SENSOR_COUNT];
+	struct sample_store store;
 };
 
 static struct humidity_temperature_data data;
 
-int humidity_temperature_svc_trigger_measurement(void)
+static int decode_channel(const struct device *dev, const uint8_t *buf,
+			  enum measurement_channel channel, int32_t *value)
 {
+	const struct sensor_decoder_api *decoder;
+	struct sensor_q31_data q31_data = {0};
+	uint32_t fit = 0;
 	int ret;
 
-	ret = sensor_sample_fetch(rh_temp_dev);
+	ret = sensor_get_decoder(dev, &decoder);
 	if (ret != 0) {
 		return ret;
 	}
 
-	ret = sensor_channel_get(rh_temp_dev, SENSOR_CHAN_AMBIENT_TEMP, &data.temperature);
-	if (ret != 0) {
-		LOG_ERR("Failed to get temperature channel: %d", ret);
+	ret = decoder->decode(buf, (struct sensor_chan_spec){channels[channel].chan, 0}, &fit, 1,
+			      &q31_data);
+	if (ret < 0) {
 		return ret;
 	}
+	if (ret != 1) {
+		return -ENODATA;
+	}
 
-	ret = sensor_channel_get(rh_temp_dev, SENSOR_CHAN_HUMIDITY, &data.humidity);
-	if (ret != 0) {
-		LOG_ERR("Failed to get humidity channel: %d", ret);
-		return ret;
+	*value = fixed_point_q31_to_scaled(q31_data.readings[0].value, q31_data.shift,
+					   channels[channel].scale);
+
+	return 0;
+}
+
+static size_t slot_of(size_t sensor, enum measurement_channel channel)
+{
+	return data.first_slot[sensor] + POPCOUNT(sensors[sensor].channels & (BIT(channel) - 1));
+}
+
+/* Decodes a read into the next burst entry of every channel of the sensor */
+static int collect_sample(size_t sensor, const uint8_t *buf)
+{
+	int32_t values[MEASUREMENT_CHANNEL_COUNT];
+	size_t slot = data.first_slot[sensor];
+	int ret;
+
+	for (int ch = 0; ch < MEASUREMENT_CHANNEL_COUNT; ch++) {
+		if ((sensors[sensor].channels & BIT(ch)) == 0) {
+			continue;
+		}
+
+		ret = decode_channel(sensors[sensor].dev, buf, ch, &values[ch]);
+		if (ret != 0) {
+			LOG_ERR("Failed to decode channel %d of %s: %d", ch,
+				sensors[sensor].dev->name, ret);
+			return ret;
+		}
+	}
+
+	/* Only complete reads enter the burst */
+	for (int ch = 0; ch < MEASUREMENT_CHANNEL_COUNT; ch++) {
+		if ((sensors[sensor].channels & BIT(ch)) != 0) {
+			data.store.burst[slot++][data.reads[sensor]] = values[ch];
+		}
+	}
+
+	data.reads[sensor]++;
+
+	return 0;
+}
+
+/* Collects the completions of the current round, those of an earlier round are dropped */
+static void consume_completions(void)
+{
+	uint32_t round = ROUND_TAG(atomic_get(&data.round));
+	struct rtio_cqe *cqe;
+
+	while ((cqe = rtio_cqe_consume(&sensor_rtio)) != NULL) {
+		size_t sensor = READ_TAG_SENSOR(cqe->userdata);
+		int result = cqe->result;
+		uint8_t *buf = NULL;
+		uint32_t buf_len = 0;
+
+		if (rtio_cqe_get_mempool_buffer(&sensor_rtio, cqe, &buf, &buf_len) != 0) {
+			buf = NULL;
+		}
+
+		if (READ_TAG_ROUND(cqe->userdata) == round && sensor < SENSOR_COUNT) {
+			if (result == 0 && buf != NULL) {
+				result = collect_sample(sensor, buf);
+			}
+
+			if (result != 0) {
+				LOG_ERR("Read of %s failed: %d", sensors[sensor].dev->name, result);
+				data.error[sensor] = result;
+				latency_stats_sensor_error();
+			}
+		}
+
+		if (buf != NULL) {
+			rtio_release_buffer(&sensor_rtio, buf, buf_len);
+		}
+
+		rtio_cqe_release(&sensor_rtio, cqe);
+	}
+}
+
+/* Runs the reduced burst of a slot through its IIR */
+static void store_value(size_t slot, enum measurement_channel channel, int32_t value)
+{
+	/* An out of range reading is a sensor fault, it must not pull the filter away */
+	if (channel == MEASUREMENT_CHANNEL_TEMPERATURE &&
+	    !IN_RANGE(value, SENSOR_TEMP_CENTI_MIN, SENSOR_TEMP_CENTI_MAX)) {
+		LOG_ERR("Temperature out of sensor range: %d", value);
+		data.store.status[slot] = -ERANGE;
+		return;
+	}
+
+	if (channel == MEASUREMENT_CHANNEL_HUMIDITY) {
+		value = CLAMP(value, SENSOR_HUMIDITY_CENTI_MIN, SENSOR_HUMIDITY_CENTI_MAX);
+	}
+
+	data.store.value[slot] = measurement_filter_ema(&data.store.filter[slot], value);
+	data.store.status[slot] = 0;
+}
+
+/* Reduces the bursts, returns 0 if at least one sensor delivered */
+static int finish_measurement(void)
+{
+	int result = -EIO;
+
+	for (size_t sensor = 0; sensor < SENSOR_COUNT; sensor++) {
+		size_t slot = data.first_slot[sensor];
+		int error = data.error[sensor] != 0 ? data.error[sensor] : -EIO;
+
+		if ((data.ready_mask & BIT(sensor)) == 0) {
+			continue;
+		}
+
+		if (data.reads[sensor] == 0) {
+			LOG_ERR("No valid read from %s", sensors[sensor].dev->name);
+			if (result != 0) {
+				result = error;
+			}
+		} else {
+			result = 0;
+		}
+
+		for (int ch = 0; ch < MEASUREMENT_CHANNEL_COUNT; ch++) {
+			if ((sensors[sensor].channels & BIT(ch)) == 0) {
+				continue;
+			}
+
+			if (data.reads[sensor] == 0) {
+				data.store.status[slot++] = error;
+				continue;
+			}
+
+			store_value(slot, ch,
+				    measurement_filter_reduce(data.store.burst[slot],
+							      data.reads[sensor],
+							      channels[ch].outlier_limit));
+
+			LOG_DBG("%s channel %d: %d (%u reads)", sensors[sensor].dev->name, ch,
+				data.store.value[slot], data.reads[sensor]);
+			slot++;
+		}
+	}
+
+	return result;
+}
+
+static void read_done_work_handler(struct k_work *work);
+K_WORK_DEFINE(read_done_work, read_done_work_handler);
+
+static void round_timeout_work_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(round_timeout_work, round_timeout_work_handler);
+
+/* Runs in the context completing the last read of a bus (RTIO workqueue or driver ISR) */
+static void chain_complete_cb(struct rtio *r, const struct rtio_sqe *sqe, int result, void *arg0)
+{
+	ARG_UNUSED(r);
+	ARG_UNUSED(sqe);
+	ARG_UNUSED(result);
+
+	if ((uint32_t)(uintptr_t)arg0 != (uint32_t)atomic_get(&data.round)) {
+		/* Chain of a round which was given up */
+		return;
 	}
 
-	LOG_DBG("Temperature: %3d.%06d [°C]", data.temperature.val1, data.temperature.val2);
-	LOG_DBG("Humidity: %3d.%06d [%%]", data.humidity.val1, data.humidity.val2);
+	if (atomic_dec(&data.chains_pending) == 1) {
+		latency_stats_record(LATENCY_STAGE_SENSOR_READ, data.read_start);
+		k_work_submit(&read_done_work);
+	}
+}
+
+/*
+ * Reads every ready sensor once. The reads of a bus are chained, so they run back to back
+ * without a round trip through the application, while the chains of different buses run in
+ * parallel.
+ */
+static int start_round(void)
+{
+	uint32_t round = (uint32_t)atomic_inc(&data.round) + 1;
+	struct rtio_sqe *sqe;
+	uint8_t chains = 0;
+
+	for (uint8_t bus = 0; bus < data.bus_count; bus++) {
+		bool reads = false;
+
+		for (size_t sensor = 0; sensor < SENSOR_COUNT; sensor++) {
+			if (data.bus_index[sensor] != bus || (data.ready_mask & BIT(sensor)) == 0) {
+				continue;
+			}
+
+			sqe = rtio_sqe_acquire(&sensor_rtio);
+			if (sqe == NULL) {
+				goto no_mem;
+			}
+
+			rtio_sqe_prep_read_with_pool(sqe, sensors[sensor].iodev, RTIO_PRIO_NORM,
+						     READ_TAG(round, sensor));
+			sqe->flags |= RTIO_SQE_CHAINED;
+			reads = true;
+		}
+
+		if (!reads) {
+			continue;
+		}
+
+		sqe = rtio_sqe_acquire(&sensor_rtio);
+		if (sqe == NULL) {
+			goto no_mem;
+		}
+
+		rtio_sqe_prep_callback_no_cqe(sqe, chain_complete_cb, (void *)(uintptr_t)round,
+					      NULL);
+		chains++;
+	}
+
+	atomic_set(&data.chains_pending, chains);
+	data.read_start = LATENCY_STATS_TIMESTAMP();
+	k_work_reschedule(&round_timeout_work, K_MSEC(ROUND_TIMEOUT_MS));
+
+	return rtio_submit(&sensor_rtio, 0);
+
+no_mem:
+	rtio_sqe_drop_all(&sensor_rtio);
+	return -ENOMEM;
+}
+
+static void round_done(bool timed_out)
+{
+	humidity_temperature_svc_cb_t callback = data.callback;
+	int result;
+
+	if (!data.pending || (!timed_out && atomic_get(&data.chains_pending) != 0)) {
+		/* Already handled, by the timeout or a newer trigger_measurement() */
+		return;
+	}
+
+	k_work_cancel_delayable(&round_timeout_work);
+
+	if (timed_out) {
+		LOG_WRN("Sensor read round timed out, %ld bus chains pending",
+			(long)atomic_get(&data.chains_pending));
+	}
+
+	consume_completions();
+
+	if (++data.rounds < OVERSAMPLING) {
+		/* Next read of the burst */
+		result = start_round();
+		if (result == 0) {
+			return;
+		}
+
+		LOG_ERR("Failed to submit sensor reads: %d", result);
+	}
+
+	data.pending = false;
+	result = finish_measurement();
+
+	if (callback != NULL) {
+		callback(result);
+	}
+}
+
+static void read_done_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	round_done(false);
+}
+
+static void round_timeout_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	round_done(true);
+}
+
+int humidity_temperature_svc_trigger_measurement(humidity_temperature_svc_cb_t callback)
+{
+	int ret;
+
+	if (data.pending) {
+		LOG_WRN("Previous sensor read did not complete");
+		k_work_cancel_delayable(&round_timeout_work);
+		data.pending = false;
+	}
+
+	/* Retires the round in flight, its completions no longer match */
+	atomic_inc(&data.round);
+	consume_completions();
+
+	data.callback = callback;
+	data.rounds = 0;
+	memset(data.reads, 0, sizeof(data.reads));
+	memset(data.error, 0, sizeof(data.error));
+	for (size_t slot = 0; slot < SLOT_COUNT; slot++) {
+		data.store.status[slot] = -ENODATA;
+	}
+
+	ret = start_round();
+	if (ret == 0) {
+		data.pending = true;
+	}
+
+	return ret;
+}
+
+size_t humidity_temperature_svc_sensor_count(void)
+{
+	return SENSOR_COUNT;
+}
+
+static int get_slot(size_t slot, int32_t *value)
+{
+	if (data.store.status[slot] != 0) {
+		return data.store.status[slot];
+	}
+
+	*value = data.store.value[slot];
 
 	return 0;
 }
 
-float humidity_temperature_svc_get_temperature(void)
+int humidity_temperature_svc_get_sample(size_t sensor, enum measurement_channel channel,
+					int32_t *value)
 {
-	return sensor_value_to_float(&data.temperature);
+	if (sensor >= SENSOR_COUNT || channel >= MEASUREMENT_CHANNEL_COUNT ||
+	    (sensors[sensor].channels & BIT(channel)) == 0) {
+		return -EINVAL;
+	}
+
+	return get_slot(slot_of(sensor, channel), value);
 }
 
-float humidity_temperature_svc_get_humidity(void)
+int humidity_temperature_svc_get_temperature(int16_t *temperature)
 {
-	return sensor_value_to_float(&data.humidity);
+	int32_t value;
+	int ret;
+
+	if (data.primary_slot[MEASUREMENT_CHANNEL_TEMPERATURE] < 0) {
+		return -ENODATA;
+	}
+
+	ret = get_slot(data.primary_slot[MEASUREMENT_CHANNEL_TEMPERATURE], &value);
+	if (ret == 0) {
+		*temperature = (int16_t)value;
+	}
+
+	return ret;
+}
+
+int humidity_temperature_svc_get_humidity(uint16_t *humidity)
+{
+	int32_t value;
+	int ret;
+
+	if (data.primary_slot[MEASUREMENT_CHANNEL_HUMIDITY] < 0) {
+		return -ENODATA;
+	}
+
+	ret = get_slot(data.primary_slot[MEASUREMENT_CHANNEL_HUMIDITY], &value);
+	if (ret == 0) {
+		*humidity = (uint16_t)value;
+	}
+
+	return ret;
 }
 
 int humidity_temperature_svc_init(void)
 {
-	if (!device_is_ready(rh_temp_dev)) {
+	uint8_t slot = 0;
+
+	for (int ch = 0; ch < MEASUREMENT_CHANNEL_COUNT; ch++) {
+		data.primary_slot[ch] = -1;
+	}
+
+	for (size_t sensor = 0; sensor < SENSOR_COUNT; sensor++) {
+		size_t other;
+
+		data.first_slot[sensor] = slot;
+		slot += POPCOUNT(sensors[sensor].channels);
+
+		/* Sensors on the same bus share its chain */
+		for (other = 0; other < sensor; other++) {
+			if (sensors[other].bus == sensors[sensor].bus) {
+				break;
+			}
+		}
+		data.bus_index[sensor] = other < sensor ? data.bus_index[other] : data.bus_count++;
+
+		if (!device_is_ready(sensors[sensor].dev)) {
+			/* A missing probe must not take the others down */
+			LOG_ERR("Sensor %s is not ready", sensors[sensor].dev->name);
+			continue;
+		}
+
+		data.ready_mask |= BIT(sensor);
+
+		for (int ch = 0; ch < MEASUREMENT_CHANNEL_COUNT; ch++) {
+			if ((sensors[sensor].channels & BIT(ch)) != 0 &&
+			    data.primary_slot[ch] < 0) {
+				data.primary_slot[ch] = slot_of(sensor, ch);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < SLOT_COUNT; i++) {
+		data.store.status[i] = -ENODATA;
+	}
+
+	if (data.ready_mask == 0) {
 		LOG_ERR("Failed to initialize humidity and temperature sensor!");
 		return -ENODEV;
 	}
 
-	LOG_DBG("Humidity and temperature sensor initialized successfully");
+	LOG_DBG("%u of %u sensors ready on %u buses", (unsigned int)POPCOUNT(data.ready_mask),
+		(unsigned int)SENSOR_COUNT, data.bus_count);
+
 	return 0;
 }
@@ -10,44 +10,107 @@
 #include <zephyr/drivers/sensor.h>
 
 /* Measurements ranges for SHT40 sensor */
-#define SENSOR_TEMP_CELSIUS_MIN       -40
-#define SENSOR_TEMP_CELSIUS_MAX       125
-#define SENSOR_TEMP_CELSIUS_TOLERANCE 0.2
-#define SENSOR_HUMIDITY_PERCENT_MIN   0
-#define SENSOR_HUMIDITY_PERCENT_MAX   100
+#define SENSOR_TEMP_CELSIUS_MIN     -40
+#define SENSOR_TEMP_CELSIUS_MAX     125
+#define SENSOR_HUMIDITY_PERCENT_MIN 0
+#define SENSOR_HUMIDITY_PERCENT_MAX 100
+
+/* Same ranges in the fixed-point units of the measurement API (0.01 °C and 0.01 %) */
+#define SENSOR_TEMP_CENTI_MIN       (SENSOR_TEMP_CELSIUS_MIN * 100)
+#define SENSOR_TEMP_CENTI_MAX       (SENSOR_TEMP_CELSIUS_MAX * 100)
+#define SENSOR_HUMIDITY_CENTI_MIN   (SENSOR_HUMIDITY_PERCENT_MIN * 100)
+#define SENSOR_HUMIDITY_CENTI_MAX   (SENSOR_HUMIDITY_PERCENT_MAX * 100)
+
+/** Channels of the sensor registry */
+enum measurement_channel {
+	MEASUREMENT_CHANNEL_TEMPERATURE, /* 0.01 °C */
+	MEASUREMENT_CHANNEL_HUMIDITY,    /* 0.01 % */
+	MEASUREMENT_CHANNEL_PRESSURE,    /* Pa */
+	MEASUREMENT_CHANNEL_COUNT,
+};
+
+/**
+ * @brief Callback reporting the end of a measurement.
+ *
+ * Called from the system workqueue.
+ *
+ * @param result 0 if the sensor was read successfully, or a negative error code
+ */
+typedef void (*humidity_temperature_svc_cb_t)(int result);
 
 /**
- * @brief Triggers a new measurement for humidity and temperature.
+ * @brief Triggers a new measurement of all registered sensors.
+ *
+ * The sensors are read asynchronously through RTIO, the calling thread is not blocked while they
+ * convert. The reads of sensors sharing a bus are chained, different buses run in parallel. A
+ * measurement is a burst of CONFIG_MEASUREMENT_OVERSAMPLING reads, reduced
+ * to one value per channel and smoothed by the IIR filter of the channel (measurement_filter.h),
+ * whose state is kept from one measurement to the next.
  *
- * This function fetches new sensor data and caches the values internally.
- * Call get_temperature() and get_humidity() after this returns successfully.
+ * @param callback Called once the measurement completed. Its result is 0 if at least one
+ *                 sensor delivered a reading.
  *
- * @return 0 on success, or a negative error code if the measurement fails.
+ * @return 0 if the read was submitted, or a negative error code
  */
-int humidity_temperature_svc_trigger_measurement(void);
+int humidity_temperature_svc_trigger_measurement(humidity_temperature_svc_cb_t callback);
 
 /**
- * @brief Get the last measured humidity value.
+ * @brief Get the last measured humidity value of the primary sensor.
+ *
+ * The primary sensor of a channel is the first ready sensor in the registry providing it.
  *
- * @note Call trigger_measurement() first to get fresh data.
+ * @note Only valid after the callback of trigger_measurement() reported success.
  *
- * @return Humidity value in percent (0.0 - 100.0).
+ * @param humidity Filtered humidity in 0.01 % (0 - 10000), rounded to nearest. Values outside
+ *                 of the sensor range are cropped, as recommended by Sensirion.
+ *
+ * @return 0 on success, -ENODATA if there is no reading
  */
-float humidity_temperature_svc_get_humidity(void);
+int humidity_temperature_svc_get_humidity(uint16_t *humidity);
 
 /**
- * @brief Get the last measured temperature value.
+ * @brief Get the last measured temperature value of the primary sensor.
+ *
+ * @note Only valid after the callback of trigger_measurement() reported success.
  *
- * @note Call trigger_measurement() first to get fresh data.
+ * @param temperature Filtered temperature in 0.01 °C (-4000 - 12500), rounded to nearest.
  *
- * @return Temperature value in degrees Celsius.
+ * @return 0 on success, -ERANGE if the temperature is outside of the sensor range, -ENODATA if
+ *         there is no reading
  */
-float humidity_temperature_svc_get_temperature(void);
+int humidity_temperature_svc_get_temperature(int16_t *temperature);
 
 /**
- * @brief Initialize the humidity and temperature sensor.
+ * @brief Get the number of sensors in the registry.
+ *
+ * The registry is the environmental-sensors list of the zephyr,user devicetree node, or the
+ * sht-sensor alias alone if the board has no list.
+ *
+ * @return Number of sensors, ready or not
+ */
+size_t humidity_temperature_svc_sensor_count(void);
+
+/**
+ * @brief Get the last measured value of one channel of one sensor.
+ *
+ * @note Only valid after the callback of trigger_measurement() reported success.
+ *
+ * @param sensor Index of the sensor in the registry.
+ * @param channel Channel to get.
+ * @param value Filtered value in the unit of the channel (enum measurement_channel).
+ *
+ * @return 0 on success, -EINVAL if the sensor does not have the channel, -ERANGE or -ENODATA as
+ *         for the primary getters, or the error of the failed read
+ */
+int humidity_temperature_svc_get_sample(size_t sensor, enum measurement_channel channel,
+					int32_t *value);
+
+/**
+ * @brief Initialize the sensor registry.
+ *
+ * Sensors which are not ready are left out of the measurements.
  *
- * @return 0 on success, or -ENODEV on failure
+ * @return 0 on success, or -ENODEV if no sensor is ready
  */
 int humidity_temperature_svc_init(void);
 
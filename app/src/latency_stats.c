@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/stats/stats.h>
+
+#include "latency_stats.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(latency_stats, LOG_LEVEL_INF);
+
+#define LATENCY_BUCKET_COUNT    7
+#define LATENCY_FIRST_BUCKET_US 64
+#define DEPTH_BUCKET_COUNT      6
+
+/* Histogram buckets must be consecutive entries, they are indexed from the first one */
+#define LATENCY_HIST_ENTRIES(p)                                                                    \
+	STATS_SECT_ENTRY32(p##_lt64us)                                                             \
+	STATS_SECT_ENTRY32(p##_lt256us)                                                            \
+	STATS_SECT_ENTRY32(p##_lt1ms)                                                              \
+	STATS_SECT_ENTRY32(p##_lt4ms)                                                              \
+	STATS_SECT_ENTRY32(p##_lt16ms)                                                             \
+	STATS_SECT_ENTRY32(p##_lt66ms)                                                             \
+	STATS_SECT_ENTRY32(p##_ge66ms)
+
+#define LATENCY_HIST_NAMES(p)                                                                      \
+	STATS_NAME(latency, p##_lt64us)                                                            \
+	STATS_NAME(latency, p##_lt256us)                                                           \
+	STATS_NAME(latency, p##_lt1ms)                                                             \
+	STATS_NAME(latency, p##_lt4ms)                                                             \
+	STATS_NAME(latency, p##_lt16ms)                                                            \
+	STATS_NAME(latency, p##_lt66ms)                                                            \
+	STATS_NAME(latency, p##_ge66ms)
+
+STATS_SECT_START(latency)
+LATENCY_HIST_ENTRIES(read)
+LATENCY_HIST_ENTRIES(wq)
+LATENCY_HIST_ENTRIES(notify)
+STATS_SECT_ENTRY32(evq_depth1)
+STATS_SECT_ENTRY32(evq_depth2)
+STATS_SECT_ENTRY32(evq_depth4)
+STATS_SECT_ENTRY32(evq_depth8)
+STATS_SECT_ENTRY32(evq_depth16)
+STATS_SECT_ENTRY32(evq_depth_gt16)
+STATS_SECT_ENTRY32(read_err)
+STATS_SECT_ENTRY32(notify_ok)
+STATS_SECT_ENTRY32(notify_enomem)
+STATS_SECT_ENTRY32(notify_enotconn)
+STATS_SECT_ENTRY32(notify_err)
+STATS_SECT_ENTRY32(evq_dropped)
+STATS_SECT_END;
+
+STATS_SECT_DECL(latency) latency;
+
+STATS_NAME_START(latency)
+LATENCY_HIST_NAMES(read)
+LATENCY_HIST_NAMES(wq)
+LATENCY_HIST_NAMES(notify)
+STATS_NAME(latency, evq_depth1)
+STATS_NAME(latency, evq_depth2)
+STATS_NAME(latency, evq_depth4)
+STATS_NAME(latency, evq_depth8)
+STATS_NAME(latency, evq_depth16)
+STATS_NAME(latency, evq_depth_gt16)
+STATS_NAME(latency, read_err)
+STATS_NAME(latency, notify_ok)
+STATS_NAME(latency, notify_enomem)
+STATS_NAME(latency, notify_enotconn)
+STATS_NAME(latency, notify_err)
+STATS_NAME(latency, evq_dropped)
+STATS_NAME_END(latency);
+
+BUILD_ASSERT(offsetof(STATS_SECT_TYPE(latency), read_ge66ms) -
+			     offsetof(STATS_SECT_TYPE(latency), read_lt64us) ==
+		     (LATENCY_BUCKET_COUNT - 1) * sizeof(uint32_t),
+	     "Histogram buckets must be consecutive");
+BUILD_ASSERT(offsetof(STATS_SECT_TYPE(latency), evq_depth_gt16) -
+			     offsetof(STATS_SECT_TYPE(latency), evq_depth1) ==
+		     (DEPTH_BUCKET_COUNT - 1) * sizeof(uint32_t),
+	     "Histogram buckets must be consecutive");
+
+/*
+ * Thread-safety: The counters are incremented from the system workqueue, the BT RX thread and
+ * the RTIO workqueue. A lost increment on a concurrent update is accepted, as everywhere in
+ * the stats subsystem.
+ */
+static uint32_t *const histograms[LATENCY_STAGE_COUNT] = {
+	[LATENCY_STAGE_SENSOR_READ] = &latency.read_lt64us,
+	[LATENCY_STAGE_MEASURING_WORK] = &latency.wq_lt64us,
+	[LATENCY_STAGE_GATT_NOTIFY] = &latency.notify_lt64us,
+};
+
+void latency_stats_record_us(enum latency_stage stage, uint32_t us)
+{
+	uint32_t limit = LATENCY_FIRST_BUCKET_US;
+	size_t bucket = 0;
+
+	while (bucket < LATENCY_BUCKET_COUNT - 1 && us >= limit) {
+		limit <<= 2;
+		bucket++;
+	}
+
+	histograms[stage][bucket]++;
+}
+
+void latency_stats_record(enum latency_stage stage, uint32_t start)
+{
+	latency_stats_record_us(stage, k_cyc_to_us_floor32(k_cycle_get_32() - start));
+}
+
+void latency_stats_sensor_error(void)
+{
+	STATS_INC(latency, read_err);
+}
+
+void latency_stats_notify_result(int ret)
+{
+	switch (ret) {
+	case 0:
+		STATS_INC(latency, notify_ok);
+		break;
+	case -ENOMEM:
+		STATS_INC(latency, notify_enomem);
+		break;
+	case -ENOTCONN:
+		STATS_INC(latency, notify_enotconn);
+		break;
+	default:
+		STATS_INC(latency, notify_err);
+		break;
+	}
+}
+
+void latency_stats_event_queue_depth(uint32_t depth)
+{
+	uint32_t limit = 1;
+	size_t bucket = 0;
+
+	while (bucket < DEPTH_BUCKET_COUNT - 1 && depth > limit) {
+		limit <<= 1;
+		bucket++;
+	}
+
+	(&latency.evq_depth1)[bucket]++;
+}
+
+void latency_stats_event_dropped(void)
+{
+	STATS_INC(latency, evq_dropped);
+}
+
+int latency_stats_init(void)
+{
+	int ret;
+
+	ret = STATS_INIT_AND_REG(latency, STATS_SIZE_32, "latency");
+	if (ret != 0) {
+		LOG_ERR("Failed to register latency stats: %d", ret);
+	}
+
+	return ret;
+}
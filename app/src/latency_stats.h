@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_LATENCY_STATS_H_
+#define APP_LATENCY_STATS_H_
+
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+
+/*
+ * Hot-path latency histograms, exported as the "latency" stat group through MCUmgr.
+ *
+ * Durations are measured in hardware cycles and sorted into fixed buckets with a factor of 4
+ * between them: < 64 us, < 256 us, < 1 ms, < 4 ms, < 16 ms, < 66 ms and above. Without
+ * CONFIG_LATENCY_STATS all functions are empty inlines and LATENCY_STATS_TIMESTAMP() is 0, so
+ * the instrumentation compiles to nothing.
+ */
+
+enum latency_stage {
+	LATENCY_STAGE_SENSOR_READ,    /* Sensor read submit until completion */
+	LATENCY_STAGE_MEASURING_WORK, /* measuring_work due until it runs */
+	LATENCY_STAGE_GATT_NOTIFY,    /* bt_gatt_notify() call */
+	LATENCY_STAGE_COUNT,
+};
+
+#if defined(CONFIG_LATENCY_STATS)
+
+#define LATENCY_STATS_TIMESTAMP() k_cycle_get_32()
+
+/**
+ * @brief Record the duration of a stage.
+ *
+ * @param stage Instrumented stage.
+ * @param start Cycle count at the start of the stage, from LATENCY_STATS_TIMESTAMP().
+ */
+void latency_stats_record(enum latency_stage stage, uint32_t start);
+
+/**
+ * @brief Record the duration of a stage measured in microseconds.
+ *
+ * @param stage Instrumented stage.
+ * @param us Duration in microseconds.
+ */
+void latency_stats_record_us(enum latency_stage stage, uint32_t us);
+
+/**
+ * @brief Count a failed sensor read.
+ */
+void latency_stats_sensor_error(void);
+
+/**
+ * @brief Count the return code of a bt_gatt_notify() call.
+ *
+ * @param ret Return code.
+ */
+void latency_stats_notify_result(int ret);
+
+/**
+ * @brief Record the fill level of an event bus lane after publishing.
+ *
+ * @param depth Number of queued events.
+ */
+void latency_stats_event_queue_depth(uint32_t depth);
+
+/**
+ * @brief Count an event dropped because its lane was full.
+ */
+void latency_stats_event_dropped(void);
+
+/**
+ * @brief Register the stat group.
+ *
+ * @return 0 on success, or error code.
+ */
+int latency_stats_init(void);
+
+#else
+
+#define LATENCY_STATS_TIMESTAMP() 0
+
+static inline void latency_stats_record(enum latency_stage stage, uint32_t start)
+{
+}
+
+static inline void latency_stats_record_us(enum latency_stage stage, uint32_t us)
+{
+}
+
+static inline void latency_stats_sensor_error(void)
+{
+}
+
+static inline void latency_stats_notify_result(int ret)
+{
+}
+
+static inline void latency_stats_event_queue_depth(uint32_t depth)
+{
+}
+
+static inline void latency_stats_event_dropped(void)
+{
+}
+
+static inline int latency_stats_init(void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_LATENCY_STATS */
+
+#endif /* APP_LATENCY_STATS_H_ */
@@ -5,10 +5,21 @@
  */
 
 #include <app_version.h>
+#include "adaptive_sampling.h"
+#include "backfill_svc.h"
+#include "boot_timeline.h"
 #include "ble_svc.h"
+#include "conn_param_policy.h"
 #include "events_svc.h"
+#include "fast_reconnect.h"
+#include "history_svc.h"
+#include "history_transfer_svc.h"
 #include "humidity_temperature_svc.h"
+#include "latency_stats.h"
+#include "psychrometrics.h"
+#include "runtime_config_svc.h"
 #include "user_interface.h"
+#include "window_stats_svc.h"
 
 #include <zephyr/logging/log.h>
 
@@ -17,50 +28,205 @@ LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 #define MEASUREMENT_PERIOD_MSEC             (1000 * CONFIG_MEASURING_PERIOD_SECONDS)
 #define FIRST_MEASUREMENT_DELAY_MSEC        (1000 * CONFIG_FIRST_MEASUREMENT_DELAY_SECONDS)
 #define STATUS_LED_ON_TIME_FOR_STARTUP_MSEC 250
+#define MEASURE_WHILE_DISCONNECTED                                                                 \
+	(IS_ENABLED(CONFIG_HISTORY_LOG) || IS_ENABLED(CONFIG_BLE_BROADCAST_READINGS) ||            \
+	 IS_ENABLED(CONFIG_BACKFILL) || IS_ENABLED(CONFIG_WINDOW_STATS) ||                         \
+	 IS_ENABLED(CONFIG_BLE_PERIODIC_ADV))
 
 /*
  * Thread-safety: This struct is only accessed from the main thread context.
- * BLE events arrive via the thread-safe message queue (events_svc), ensuring
- * no concurrent access occurs.
+ * Events are delivered to the subscribers by the main thread (events_svc_dispatch),
+ * ensuring no concurrent access occurs.
  */
 struct main_data {
-	bool ble_is_connected;
+	uint32_t connections; /* BIT(conn_index) of every connected central */
 	bool measuring_started;
 };
 
 static struct main_data data;
 
-static void measuring_work_handler(struct k_work *_work)
+/* Only accessed from the system workqueue, period chosen by adaptive sampling */
+static uint32_t measuring_period_ms = MEASUREMENT_PERIOD_MSEC;
+
+/* Uptime in ticks when measuring_work is due, for the queueing delay statistics */
+static atomic_t measuring_due_ticks;
+
+static void measuring_work_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(measuring_work, measuring_work_handler);
+
+/* Configured measuring period, changeable at runtime */
+static uint32_t measuring_config_period_ms(void)
 {
+	if (IS_ENABLED(CONFIG_RUNTIME_CONFIG)) {
+		return MSEC_PER_SEC * runtime_config_svc_get(RUNTIME_CONFIG_MEASURING_PERIOD);
+	}
+
+	return MEASUREMENT_PERIOD_MSEC;
+}
+
+static uint32_t first_measurement_delay_ms(void)
+{
+	enum runtime_config_param param = RUNTIME_CONFIG_FIRST_MEASUREMENT_DELAY;
+
+	if (IS_ENABLED(CONFIG_RUNTIME_CONFIG)) {
+		return MSEC_PER_SEC * runtime_config_svc_get(param);
+	}
+
+	return FIRST_MEASUREMENT_DELAY_MSEC;
+}
+
+static void measuring_reschedule(uint32_t delay_ms)
+{
+	if (IS_ENABLED(CONFIG_LATENCY_STATS)) {
+		atomic_set(&measuring_due_ticks,
+			   (atomic_val_t)(k_uptime_ticks() + k_ms_to_ticks_ceil32(delay_ms)));
+	}
+
+	k_work_reschedule(&measuring_work, K_MSEC(delay_ms));
+}
+
+static void measurement_done(int result)
+{
+	struct event evt = {.type = EVENT_MEASUREMENT_READY};
 	int ret;
-	struct k_work_delayable *work = k_work_delayable_from_work(_work);
+	int16_t temperature;
+	uint16_t humidity;
+
+	if (result != 0) {
+		LOG_ERR("Humidity and temperature measurement failed: %d", result);
+		return;
+	}
+
+	boot_timeline_mark(BOOT_PHASE_FIRST_MEASUREMENT);
 
-	ret = humidity_temperature_svc_trigger_measurement();
+	ret = humidity_temperature_svc_get_temperature(&temperature);
 	if (ret != 0) {
-		LOG_ERR("Failed to trigger humidity and temperature measurement: %d", ret);
-	} else {
-		ret = ble_svc_update_humidity_value(humidity_temperature_svc_get_humidity());
+		LOG_ERR("Failed to get temperature measurement: %d", ret);
+		return;
+	}
+
+	ret = humidity_temperature_svc_get_humidity(&humidity);
+	if (ret != 0) {
+		LOG_ERR("Failed to get humidity measurement: %d", ret);
+		return;
+	}
+
+	if (IS_ENABLED(CONFIG_HISTORY_LOG)) {
+		ret = history_svc_append(temperature, humidity);
 		if (ret != 0) {
-			LOG_WRN("Failed to update humidity measurement over BLE: %d", ret);
+			LOG_WRN("Failed to append measurement to history log: %d", ret);
 		}
+	}
 
-		ret = ble_svc_update_temperature_value(humidity_temperature_svc_get_temperature());
-		if (ret != 0) {
-			LOG_WRN("Failed to update temperature measurement over BLE: %d", ret);
+	if (IS_ENABLED(CONFIG_BACKFILL)) {
+		backfill_svc_append(temperature, humidity);
+	}
+
+	if (IS_ENABLED(CONFIG_WINDOW_STATS)) {
+		window_stats_svc_append(temperature, humidity);
+	}
+
+	ret = ble_svc_update_humidity_value(humidity);
+	if (ret != 0) {
+		LOG_WRN("Failed to update humidity measurement over BLE: %d", ret);
+	}
+
+	ret = ble_svc_update_temperature_value(temperature);
+	if (ret != 0) {
+		LOG_WRN("Failed to update temperature measurement over BLE: %d", ret);
+	}
+
+	/* Derived on the device, so the backend does not have to for every notification */
+	ret = ble_svc_update_dew_point_value(psychrometrics_dew_point(temperature, humidity));
+	if (ret != 0) {
+		LOG_WRN("Failed to update dew point over BLE: %d", ret);
+	}
+
+	ret = ble_svc_update_heat_index_value(psychrometrics_heat_index(temperature, humidity));
+	if (ret != 0) {
+		LOG_WRN("Failed to update heat index over BLE: %d", ret);
+	}
+
+	ret = ble_svc_update_absolute_humidity_value(
+		psychrometrics_absolute_humidity(temperature, humidity));
+	if (ret != 0) {
+		LOG_WRN("Failed to update absolute humidity over BLE: %d", ret);
+	}
+
+	ret = ble_svc_update_advertising_data();
+	if (ret != 0) {
+		LOG_WRN("Failed to update advertising data: %d", ret);
+	}
+
+	evt.measurement.temperature = temperature;
+	evt.measurement.humidity = humidity;
+	events_svc_publish(&evt);
+
+	if (IS_ENABLED(CONFIG_ADAPTIVE_SAMPLING)) {
+		measuring_period_ms =
+			adaptive_sampling_next_period_ms(temperature, humidity, k_uptime_get());
+
+		/*
+		 * Not pending means measuring was stopped in the meantime. The system workqueue
+		 * is cooperative, so the main thread cannot cancel between check and reschedule.
+		 */
+		if (k_work_delayable_is_pending(&measuring_work)) {
+			measuring_reschedule(measuring_period_ms);
 		}
 	}
+}
+
+static void measuring_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	int ret;
+
+	if (IS_ENABLED(CONFIG_LATENCY_STATS)) {
+		uint32_t delay = (uint32_t)k_uptime_ticks() - atomic_get(&measuring_due_ticks);
+
+		latency_stats_record_us(LATENCY_STAGE_MEASURING_WORK, k_ticks_to_us_floor32(delay));
+	}
+
+	/* Scheduled before triggering, so the period keeps running if the read never completes */
+	measuring_reschedule(IS_ENABLED(CONFIG_ADAPTIVE_SAMPLING) ? measuring_period_ms
+								   : measuring_config_period_ms());
 
-	k_work_reschedule(work, K_MSEC(MEASUREMENT_PERIOD_MSEC));
+	ret = humidity_temperature_svc_trigger_measurement(measurement_done);
+	if (ret != 0) {
+		LOG_ERR("Failed to trigger humidity and temperature measurement: %d", ret);
+	}
 }
-K_WORK_DELAYABLE_DEFINE(measuring_work, measuring_work_handler);
 
-static void btn_callback(enum button_evt evt)
+/* Single measurement at boot when measuring only while connected */
+static void first_measurement_work_handler(struct k_work *work)
 {
-	switch (evt) {
-	case BUTTON_EVT_PRESSED_1_SEC:
-		ble_svc_increase_button_press_cnt();
-		break;
+	ARG_UNUSED(work);
+
+	int ret;
 
+	ret = humidity_temperature_svc_trigger_measurement(measurement_done);
+	if (ret != 0) {
+		LOG_ERR("Failed to trigger humidity and temperature measurement: %d", ret);
+	}
+}
+static K_WORK_DEFINE(first_measurement_work, first_measurement_work_handler);
+
+static void btn_callback(enum button_evt gesture)
+{
+	struct event evt = {
+		.type = EVENT_BUTTON,
+		.button.gesture = gesture,
+	};
+
+	events_svc_publish(&evt);
+}
+
+static void on_button(const struct event *evt, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	switch (evt->button.gesture) {
 	case BUTTON_EVT_PRESSED_10_SEC:
 		/* TODO: Trigger factory Reset */
 		break;
@@ -70,6 +236,95 @@ static void btn_callback(enum button_evt evt)
 	}
 }
 
+static void on_connected(const struct event *evt, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	LOG_INF("Event: %s (connection %u)", events_svc_type_to_text(evt->type),
+		evt->conn.conn_index);
+
+	/*
+	 * The first central gets its first measurement after the initial delay. Further centrals
+	 * only pull the next measurement in, they must not delay the notifications of the ones
+	 * already connected.
+	 */
+	if (data.connections == 0 ||
+	    k_ticks_to_ms_floor64(k_work_delayable_remaining_get(&measuring_work)) >
+		    first_measurement_delay_ms()) {
+		measuring_reschedule(first_measurement_delay_ms());
+	}
+	data.connections |= BIT(evt->conn.conn_index);
+	data.measuring_started = true;
+}
+
+static void on_reconnected(const struct event *evt, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	LOG_INF("Event: %s (connection %u)", events_svc_type_to_text(evt->type),
+		evt->conn.conn_index);
+
+	/*
+	 * A bonded central is subscribed from the stored CCCs as soon as the link is encrypted, it
+	 * gets its first notification now instead of after the initial delay.
+	 */
+	if (data.connections & BIT(evt->conn.conn_index)) {
+		measuring_reschedule(0);
+	}
+}
+
+static void on_disconnected(const struct event *evt, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	struct k_work_sync sync;
+
+	LOG_INF("Event: %s (connection %u)", events_svc_type_to_text(evt->type),
+		evt->conn.conn_index);
+
+	data.connections &= ~BIT(evt->conn.conn_index);
+	if (data.connections == 0 && data.measuring_started == true &&
+	    !MEASURE_WHILE_DISCONNECTED) {
+		k_work_cancel_delayable_sync(&measuring_work, &sync);
+		data.measuring_started = false;
+	}
+}
+
+static void on_config_changed(const struct event *evt, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	uint32_t period_ms = measuring_config_period_ms();
+
+	if (evt->config.changed & BIT(RUNTIME_CONFIG_MEASURING_PERIOD)) {
+		ble_svc_set_update_interval(period_ms / MSEC_PER_SEC);
+
+		/*
+		 * A shorter period starts right away, a longer one with the next measurement.
+		 * Adaptive sampling keeps choosing its own period.
+		 */
+		if (!IS_ENABLED(CONFIG_ADAPTIVE_SAMPLING) &&
+		    k_work_delayable_is_pending(&measuring_work) &&
+		    k_ticks_to_ms_floor64(k_work_delayable_remaining_get(&measuring_work)) >
+			    period_ms) {
+			measuring_reschedule(period_ms);
+		}
+	}
+
+	if (evt->config.changed & (BIT(RUNTIME_CONFIG_MIN_ADV_INTERVAL) |
+				   BIT(RUNTIME_CONFIG_MAX_ADV_INTERVAL))) {
+		ble_svc_set_adv_interval(runtime_config_svc_get(RUNTIME_CONFIG_MIN_ADV_INTERVAL),
+					 runtime_config_svc_get(RUNTIME_CONFIG_MAX_ADV_INTERVAL));
+		ble_svc_restart_advertising();
+	}
+}
+
+static struct events_svc_subscriber button_sub = {.handler = on_button};
+static struct events_svc_subscriber connected_sub = {.handler = on_connected};
+static struct events_svc_subscriber reconnected_sub = {.handler = on_reconnected};
+static struct events_svc_subscriber disconnected_sub = {.handler = on_disconnected};
+static struct events_svc_subscriber config_changed_sub = {.handler = on_config_changed};
+
 int main(void)
 {
 	int ret;
@@ -77,28 +332,110 @@ int main(void)
 	LOG_INF("Starting up .. .. ..");
 	LOG_INF("Application Version: %s", APP_VERSION_STRING);
 
-	ret = humidity_temperature_svc_init();
+	ret = boot_timeline_init();
 	if (ret != 0) {
-		LOG_ERR("Failed to initialize humidity and temperature service!");
-		return ret;
+		LOG_WRN("Failed to initialize boot timeline: %d", ret);
 	}
 
-	ret = ui_gpio_init();
+	ret = latency_stats_init();
 	if (ret != 0) {
-		LOG_ERR("Failed to initialize user interface service!");
-		return ret;
+		LOG_WRN("Failed to initialize latency statistics: %d", ret);
 	}
 
-	ui_register_button_callback(btn_callback);
+	ret = events_svc_init();
+	if (ret != 0) {
+		LOG_WRN("Failed to register event bus statistics: %d", ret);
+	}
+
+	if (IS_ENABLED(CONFIG_HISTORY_LOG)) {
+		ret = history_svc_init();
+		if (ret != 0) {
+			LOG_ERR("Failed to initialize history log!");
+			return ret;
+		}
+	}
+
+	/* Loads the stored configuration, advertising starts with its intervals */
+	if (IS_ENABLED(CONFIG_RUNTIME_CONFIG)) {
+		ret = runtime_config_svc_init();
+		if (ret != 0) {
+			LOG_WRN("Failed to load the runtime configuration: %d", ret);
+		}
+
+		ble_svc_set_update_interval(measuring_config_period_ms() / MSEC_PER_SEC);
+		ble_svc_set_adv_interval(runtime_config_svc_get(RUNTIME_CONFIG_MIN_ADV_INTERVAL),
+					 runtime_config_svc_get(RUNTIME_CONFIG_MAX_ADV_INTERVAL));
+	}
+
+	boot_timeline_mark(BOOT_PHASE_STORAGE);
+
+	/* Connection events are queued until the dispatch loop below runs */
+	events_svc_subscribe(EVENT_BUTTON, &button_sub);
+	events_svc_subscribe(EVENT_BLE_CONNECTED, &connected_sub);
+	events_svc_subscribe(EVENT_BLE_RECONNECTED, &reconnected_sub);
+	events_svc_subscribe(EVENT_BLE_NOT_CONNECTED, &disconnected_sub);
+	if (IS_ENABLED(CONFIG_RUNTIME_CONFIG)) {
+		events_svc_subscribe(EVENT_CONFIG_CHANGED, &config_changed_sub);
+	}
 
 	ble_svc_init();
 
+	if (IS_ENABLED(CONFIG_CONN_PARAM_POLICY)) {
+		conn_param_policy_init();
+	}
+
+	if (IS_ENABLED(CONFIG_BLE_FAST_RECONNECT)) {
+		fast_reconnect_init();
+	}
+
+	if (IS_ENABLED(CONFIG_HISTORY_TRANSFER)) {
+		history_transfer_svc_init();
+	}
+
+	if (IS_ENABLED(CONFIG_BACKFILL)) {
+		backfill_svc_init();
+	}
+
+	/*
+	 * The host comes up on the system workqueue and starts advertising from bt_ready, while
+	 * this thread continues with sensors and GPIOs. Advertising does not need a reading, the
+	 * advertised values are marked as not measured until the first measurement.
+	 */
 	ret = ble_svc_enable_ble();
 	if (ret != 0) {
 		LOG_ERR("Failed to enable BLE: %d", ret);
 		return ret;
 	}
 
+	boot_timeline_mark(BOOT_PHASE_BT_ENABLE);
+
+	ret = humidity_temperature_svc_init();
+	if (ret != 0) {
+		LOG_ERR("Failed to initialize humidity and temperature service!");
+		return ret;
+	}
+
+	boot_timeline_mark(BOOT_PHASE_SENSORS);
+
+	/* Logging, broadcasting, backfill and statistics need measurements while disconnected */
+	if (MEASURE_WHILE_DISCONNECTED) {
+		measuring_reschedule(0);
+		data.measuring_started = true;
+	} else {
+		/* Fills the advertising data and the characteristics once */
+		k_work_submit(&first_measurement_work);
+	}
+
+	ret = ui_gpio_init();
+	if (ret != 0) {
+		LOG_ERR("Failed to initialize user interface service!");
+		return ret;
+	}
+
+	ui_register_button_callback(btn_callback);
+
+	boot_timeline_mark(BOOT_PHASE_GPIO);
+
 	ret = ui_flash_status_led(STATUS_LED_ON_TIME_FOR_STARTUP_MSEC);
 	if (ret != 0) {
 		LOG_WRN("Failed to flash status LED: %d", ret);
@@ -106,36 +443,8 @@ int main(void)
 	}
 
 	while (true) {
-		struct event evt;
-
-		/* Wait for the next event */
-		ret = events_svc_get_event(&evt);
-		if (ret != 0) {
-			LOG_WRN("Unable to get event: %d", ret);
-			continue;
-		}
-
-		LOG_INF("Event: %s", events_svc_type_to_text(evt.type));
-
-		switch (evt.type) {
-		case EVENT_BLE_CONNECTED:
-			data.ble_is_connected = true;
-			k_work_reschedule(&measuring_work, K_MSEC(FIRST_MEASUREMENT_DELAY_MSEC));
-			data.measuring_started = true;
-			break;
-
-		case EVENT_BLE_NOT_CONNECTED:
-			struct k_work_sync sync;
-			data.ble_is_connected = false;
-			if (data.measuring_started == true) {
-				k_work_cancel_delayable_sync(&measuring_work, &sync);
-				data.measuring_started = false;
-			}
-			break;
-
-		default:
-			break;
-		}
+		/* Deliver the next event to its subscribers */
+		events_svc_dispatch(K_FOREVER);
 	}
 
 	return 0;
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include <zephyr/sys/util.h>
+
+#include "measurement_filter.h"
+
+#define EMA_FRACTION_BITS 8
+#define EMA_ONE           (1 << EMA_FRACTION_BITS)
+
+/* Insertion sort, the fewest cycles for the handful of reads in a burst */
+static void sort(int32_t *samples, size_t count)
+{
+	for (size_t i = 1; i < count; i++) {
+		int32_t value = samples[i];
+		size_t j = i;
+
+		while (j > 0 && samples[j - 1] > value) {
+			samples[j] = samples[j - 1];
+			j--;
+		}
+
+		samples[j] = value;
+	}
+}
+
+static int32_t mean(const int32_t *samples, size_t count)
+{
+	int32_t sum = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		sum += samples[i];
+	}
+
+	return DIV_ROUND_CLOSEST(sum, (int32_t)count);
+}
+
+/* Expects sorted samples */
+static int32_t median(const int32_t *samples, size_t count)
+{
+	if (count % 2 != 0) {
+		return samples[count / 2];
+	}
+
+	return DIV_ROUND_CLOSEST(samples[count / 2 - 1] + samples[count / 2], 2);
+}
+
+/* Expects sorted samples, the median itself always survives */
+static int32_t mean_without_outliers(const int32_t *samples, size_t count, int32_t limit)
+{
+	int32_t center = median(samples, count);
+	size_t first = 0;
+	size_t last = count;
+
+	while (abs(samples[first] - center) > limit) {
+		first++;
+	}
+
+	while (abs(samples[last - 1] - center) > limit) {
+		last--;
+	}
+
+	return mean(&samples[first], last - first);
+}
+
+/*
+ * Rounds to nearest, halves away from zero. A plain shift floors, the IIR would then settle up to
+ * 2^shift - 1 below a rising input but exactly on a falling one.
+ */
+static int32_t shift_round(int32_t value, unsigned int shift)
+{
+	int32_t half = 1 << (shift - 1);
+
+	if (value < 0) {
+		return -((-value + half) >> shift);
+	}
+
+	return (value + half) >> shift;
+}
+
+int32_t measurement_filter_reduce(int32_t *samples, size_t count, int32_t outlier_limit)
+{
+	if (count == 1) {
+		return samples[0];
+	}
+
+	if (IS_ENABLED(CONFIG_MEASUREMENT_BURST_MEAN)) {
+		return mean(samples, count);
+	}
+
+	sort(samples, count);
+
+	if (IS_ENABLED(CONFIG_MEASUREMENT_BURST_OUTLIER_MEAN)) {
+		return mean_without_outliers(samples, count, outlier_limit);
+	}
+
+	return median(samples, count);
+}
+
+int32_t measurement_filter_ema(struct measurement_filter_channel *channel, int32_t value)
+{
+	if (CONFIG_MEASUREMENT_EMA_SHIFT == 0) {
+		return value;
+	}
+
+	if (!channel->primed) {
+		channel->ema = value * EMA_ONE;
+		channel->primed = true;
+	} else {
+		channel->ema +=
+			shift_round(value * EMA_ONE - channel->ema, CONFIG_MEASUREMENT_EMA_SHIFT);
+	}
+
+	return DIV_ROUND_CLOSEST(channel->ema, EMA_ONE);
+}
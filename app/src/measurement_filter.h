@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_MEASUREMENT_FILTER_H_
+#define APP_MEASUREMENT_FILTER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Integer filter stage of the measurement path, in the 0.01 units of the measurement API.
+ *
+ * A burst of reads is reduced to one value (median, mean without outliers or mean, see
+ * CONFIG_MEASUREMENT_OVERSAMPLING), then smoothed across measurements by a first-order IIR
+ * (exponential moving average) with a weight of 1 / 2^CONFIG_MEASUREMENT_EMA_SHIFT. The work is
+ * bounded by the burst size: an insertion sort of at most 15 values plus one shift-add. Its cycle
+ * count has not been measured.
+ */
+
+/* IIR state of one channel, kept between measurements */
+struct measurement_filter_channel {
+	int32_t ema; /* Q8 fixed point, 0.01 units << 8 */
+	bool primed;
+};
+
+/**
+ * @brief Reduce a burst of reads to one value.
+ *
+ * @param samples Reads of the burst, sorted in place.
+ * @param count Number of reads, at least 1.
+ * @param outlier_limit Largest accepted distance from the median for the mean without
+ *                      outliers, ignored by the other reductions.
+ *
+ * @return Combined value, rounded to nearest.
+ */
+int32_t measurement_filter_reduce(int32_t *samples, size_t count, int32_t outlier_limit);
+
+/**
+ * @brief Feed a value into the IIR of a channel.
+ *
+ * The first value primes the filter and passes unchanged.
+ *
+ * @param channel Filter state of the channel.
+ * @param value New value.
+ *
+ * @return Filtered value, rounded to nearest.
+ */
+int32_t measurement_filter_ema(struct measurement_filter_channel *channel, int32_t value);
+
+#endif /* APP_MEASUREMENT_FILTER_H_ */
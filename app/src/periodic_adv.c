@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+
+#include "periodic_adv.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(periodic_adv, LOG_LEVEL_INF);
+
+#define DEVICE_NAME     CONFIG_BT_DEVICE_NAME
+#define DEVICE_NAME_LEN (sizeof(DEVICE_NAME) - 1)
+/* Advertising SID of the set, lets gateways tell the train apart from other sets */
+#define PERIODIC_ADV_SID 1
+
+/* Extended advertising interval in 0.625 ms units, periodic interval in 1.25 ms units */
+#define EXT_ADV_INTERVAL      ((CONFIG_BLE_PERIODIC_ADV_EXT_INTERVAL_MS * 8) / 5)
+#define PERIODIC_ADV_INTERVAL ((CONFIG_BLE_PERIODIC_ADV_INTERVAL_MS * 4) / 5)
+
+/* Only accessed from the system workqueue */
+static struct bt_le_ext_adv *adv;
+
+/* Identifies the train to scanning gateways, the readings are in the periodic data */
+static const struct bt_data ext_ad[] = {
+	BT_DATA(BT_DATA_NAME_COMPLETE, DEVICE_NAME, DEVICE_NAME_LEN),
+	BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_ESS_VAL)),
+};
+
+int periodic_adv_start(const struct bt_data *ad, size_t ad_len)
+{
+	/* The identity address keeps the train attributable to the sensor */
+	const struct bt_le_adv_param param = {
+		.id = BT_ID_DEFAULT,
+		.sid = PERIODIC_ADV_SID,
+		.options = BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_USE_IDENTITY,
+		.interval_min = EXT_ADV_INTERVAL,
+		.interval_max = EXT_ADV_INTERVAL,
+	};
+	const struct bt_le_per_adv_param per_param = {
+		.interval_min = PERIODIC_ADV_INTERVAL,
+		.interval_max = PERIODIC_ADV_INTERVAL,
+		.options = BT_LE_PER_ADV_OPT_NONE,
+	};
+	int ret;
+
+	ret = bt_le_ext_adv_create(&param, NULL, &adv);
+	if (ret != 0) {
+		LOG_ERR("Failed to create extended advertising set: %d", ret);
+		return ret;
+	}
+
+	ret = bt_le_ext_adv_set_data(adv, ext_ad, ARRAY_SIZE(ext_ad), NULL, 0);
+	if (ret != 0) {
+		LOG_ERR("Failed to set extended advertising data: %d", ret);
+		goto err;
+	}
+
+	ret = bt_le_per_adv_set_param(adv, &per_param);
+	if (ret != 0) {
+		LOG_ERR("Failed to set periodic advertising parameters: %d", ret);
+		goto err;
+	}
+
+	ret = bt_le_per_adv_set_data(adv, ad, ad_len);
+	if (ret != 0) {
+		LOG_ERR("Failed to set periodic advertising data: %d", ret);
+		goto err;
+	}
+
+	ret = bt_le_per_adv_start(adv);
+	if (ret != 0) {
+		LOG_ERR("Failed to start periodic advertising: %d", ret);
+		goto err;
+	}
+
+	ret = bt_le_ext_adv_start(adv, BT_LE_EXT_ADV_START_DEFAULT);
+	if (ret != 0) {
+		LOG_ERR("Failed to start extended advertising: %d", ret);
+		goto err;
+	}
+
+	LOG_INF("Periodic advertising successfully started");
+
+	return 0;
+
+err:
+	(void)bt_le_ext_adv_delete(adv);
+	adv = NULL;
+
+	return ret;
+}
+
+int periodic_adv_update(const struct bt_data *ad, size_t ad_len)
+{
+	if (adv == NULL) {
+		return 0;
+	}
+
+	return bt_le_per_adv_set_data(adv, ad, ad_len);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_PERIODIC_ADV_H_
+#define APP_PERIODIC_ADV_H_
+
+#include <stddef.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+
+/*
+ * Periodic advertising train with the readings
+ *
+ * A second, non-connectable extended advertising set announces a periodic advertising train
+ * from the identity address. Gateways sync to the train once and then only receive at its known
+ * instants instead of scanning continuously. The connectable legacy set of ble_svc is not
+ * affected and keeps serving commissioning and DFU.
+ */
+
+/**
+ * @brief Create the extended advertising set and start the periodic train.
+ *
+ * Must be called from the system workqueue after Bluetooth is enabled.
+ *
+ * @param ad Initial periodic advertising data.
+ * @param ad_len Number of elements in @p ad.
+ *
+ * @return 0 on success, or error code.
+ */
+int periodic_adv_start(const struct bt_data *ad, size_t ad_len);
+
+/**
+ * @brief Replace the periodic advertising data.
+ *
+ * Must be called from the system workqueue. Without a running train this does nothing.
+ *
+ * @param ad Periodic advertising data.
+ * @param ad_len Number of elements in @p ad.
+ *
+ * @return 0 on success, or error code.
+ */
+int periodic_adv_update(const struct bt_data *ad, size_t ad_len);
+
+#endif /* APP_PERIODIC_ADV_H_ */
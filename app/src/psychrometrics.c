@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include <zephyr/sys/util.h>
+
+#include "fixed_point.h"
+#include "psychrometrics.h"
+
+#define Q16_ONE (1 << 16)
+
+/* Magnus coefficients over water (Sensirion): a = 17.62, b = 243.12 °C */
+#define MAGNUS_A_CENTI 1762
+#define MAGNUS_B_CENTI 24312
+
+#define LOG2_10000_Q16 870824 /* log2(10000), full scale of the 0.01 % humidity */
+#define LOG2_E_Q16     94548
+#define LN_2_Q16       45426
+
+/* 216.7 g K / (m³ hPa) * 6.112 hPa, in 0.01 g/m³ per 0.01 K */
+#define ABSOLUTE_HUMIDITY_FACTOR 13244704
+#define KELVIN_OFFSET_CENTI      27315
+
+/* log2(1 + i / 32) and 2^(i / 32) in Q16 */
+static const uint32_t log2_table[33] = {
+	0,     2909,  5732,  8473,  11136, 13727, 16248, 18704, 21098, 23433, 25711,
+	27936, 30109, 32234, 34312, 36346, 38336, 40286, 42196, 44068, 45904, 47705,
+	49472, 51207, 52911, 54584, 56229, 57845, 59434, 60997, 62534, 64047, 65536,
+};
+
+static const uint32_t exp2_table[33] = {
+	65536,  66971,  68438,  69936,  71468,  73032,  74632,  76266,  77936,
+	79642,  81386,  83169,  84990,  86851,  88752,  90696,  92682,  94711,
+	96785,  98905,  101070, 103283, 105545, 107856, 110218, 112631, 115098,
+	117618, 120194, 122825, 125515, 128263, 131072,
+};
+
+/* Rothfusz regression coefficients, scaled by 10^9, for °F and % */
+static const int64_t rothfusz[3][3] = {
+	/* RH^0, RH^1, RH^2 */
+	{-42379000000LL, 10143331270LL, -54817170LL}, /* T^0 */
+	{2049015230LL, -224755410LL, 852820LL},       /* T^1 */
+	{-6837830LL, 1228740LL, -1990LL},             /* T^2 */
+};
+
+/* Division rounding half away from zero, for a positive divisor */
+static int64_t div_round(int64_t num, int64_t den)
+{
+	return num < 0 ? (num - den / 2) / den : (num + den / 2) / den;
+}
+
+/* log2(x) in Q16 for x >= 1 */
+static int32_t log2_q16(uint32_t x)
+{
+	int exponent = 31 - __builtin_clz(x);
+	uint32_t fraction = (x << (31 - exponent)) & 0x7FFFFFFF;
+	uint32_t idx = fraction >> 26;
+	uint32_t rem = (fraction >> 10) & 0xFFFF;
+
+	return (exponent << 16) + log2_table[idx] +
+	       (((log2_table[idx + 1] - log2_table[idx]) * rem) >> 16);
+}
+
+/* 2^y in Q16 for y in Q16, 0 below the resolution */
+static uint32_t exp2_q16(int32_t y)
+{
+	int32_t exponent = y >> 16; /* Floor, also for negative y */
+	uint32_t fraction = (uint32_t)y & 0xFFFF;
+	uint32_t idx = fraction >> 11;
+	uint32_t rem = fraction & 0x7FF;
+	uint32_t mantissa;
+
+	mantissa = exp2_table[idx] + (((exp2_table[idx + 1] - exp2_table[idx]) * rem) >> 11);
+
+	if (exponent >= 15) {
+		return UINT32_MAX;
+	}
+
+	if (exponent >= 0) {
+		return mantissa << exponent;
+	}
+
+	if (exponent < -31) {
+		return 0;
+	}
+
+	return (mantissa + (1U << (-exponent - 1))) >> -exponent;
+}
+
+/* gamma = ln(RH / 100 %) + a * T / (b + T), in Q16 */
+static int32_t magnus_gamma_q16(int16_t temperature, uint16_t humidity)
+{
+	int32_t log2_rh = log2_q16(MAX(humidity, 1)) - LOG2_10000_Q16;
+	int64_t ln_rh = div_round((int64_t)log2_rh * LN_2_Q16, Q16_ONE);
+	int64_t ratio = div_round((int64_t)MAGNUS_A_CENTI * temperature * Q16_ONE,
+				  100LL * (MAGNUS_B_CENTI + temperature));
+
+	return (int32_t)(ln_rh + ratio);
+}
+
+int16_t psychrometrics_dew_point(int16_t temperature, uint16_t humidity)
+{
+	int64_t gamma = magnus_gamma_q16(temperature, humidity);
+	int64_t dew_point;
+
+	/* Td = b * gamma / (a - gamma), gamma stays far below a in the sensor range */
+	dew_point = div_round(MAGNUS_B_CENTI * gamma * 100,
+			      (int64_t)MAGNUS_A_CENTI * Q16_ONE - 100 * gamma);
+
+	return (int16_t)CLAMP(dew_point, INT16_MIN, INT16_MAX);
+}
+
+uint16_t psychrometrics_absolute_humidity(int16_t temperature, uint16_t humidity)
+{
+	int32_t gamma = magnus_gamma_q16(temperature, humidity);
+	/* Vapour pressure over 6.112 hPa: e^gamma = 2^(gamma * log2(e)) */
+	uint32_t pressure = exp2_q16((int32_t)div_round((int64_t)gamma * LOG2_E_Q16, Q16_ONE));
+	int64_t density;
+
+	density = div_round((int64_t)ABSOLUTE_HUMIDITY_FACTOR * pressure,
+			    (int64_t)(KELVIN_OFFSET_CENTI + temperature) * Q16_ONE);
+
+	return (uint16_t)MIN(density, UINT16_MAX);
+}
+
+/* Heat index in 0.001 °F from temperature in 0.001 °F and humidity in 0.01 % */
+static int32_t heat_index_fahrenheit(int32_t t, int32_t rh)
+{
+	/* Steadman: (T + 61 + (T - 68) * 1.2 + RH * 0.094) / 2, over 200 to stay exact */
+	int32_t steadman = 100 * t + 6100000 + 120 * (t - 68000) + 94 * rh;
+	int64_t sum = 0;
+	int32_t index;
+
+	/* The regression takes over where the mean of Steadman and T reaches 80 °F */
+	if (steadman + 200 * t < 32000000) {
+		return (int32_t)div_round(steadman, 200);
+	}
+
+	for (int i = 0; i < 3; i++) {
+		for (int j = 0; j < 3; j++) {
+			int64_t term = rothfusz[i][j];
+
+			for (int k = 0; k < i; k++) {
+				term = term * t / 1000;
+			}
+			for (int k = 0; k < j; k++) {
+				term = term * rh / 100;
+			}
+
+			sum += term;
+		}
+	}
+
+	index = (int32_t)div_round(sum, 1000000);
+
+	if (rh < 1300 && IN_RANGE(t, 80000, 112000)) {
+		/* ((13 - RH) / 4) * sqrt((17 - |T - 95|) / 17) */
+		uint64_t ratio = ((uint64_t)(17000 - abs(t - 95000)) << 32) / 17000;
+		uint32_t root = fixed_point_isqrt(ratio);
+
+		index -= (int32_t)(((int64_t)(1300 - rh) * 10 * root / 4) >> 16);
+	} else if (rh > 8500 && IN_RANGE(t, 80000, 87000)) {
+		/* ((RH - 85) / 10) * ((87 - T) / 5) */
+		index += (rh - 8500) * (87000 - t) / 5000;
+	}
+
+	return index;
+}
+
+int16_t psychrometrics_heat_index(int16_t temperature, uint16_t humidity)
+{
+	/* Exact in 0.001 °F */
+	int32_t fahrenheit = 18 * temperature + 32000;
+	int32_t index = heat_index_fahrenheit(fahrenheit, MIN(humidity, 10000));
+
+	return (int16_t)CLAMP(div_round((int64_t)(index - 32000) * 5, 90),
+			      PSYCHROMETRICS_HEAT_INDEX_MIN, PSYCHROMETRICS_HEAT_INDEX_MAX);
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_PSYCHROMETRICS_H_
+#define APP_PSYCHROMETRICS_H_
+
+#include <stdint.h>
+
+/*
+ * Quantities derived from temperature and relative humidity, in the 0.01 units of the
+ * measurement API. Integer arithmetic only: the logarithm and exponential of the Magnus formula
+ * come from 33-entry tables of log2 and exp2 with linear interpolation.
+ *
+ * Error bounds, against the same formulas in double precision over -40 - 60 °C and
+ * 1 - 100 %RH:
+ * - Dew point: within 0.01 °C. The Magnus formula itself (a = 17.62, b = 243.12 °C) deviates
+ *   by up to 0.35 °C from the exact saturation curve over water in -45 - 60 °C.
+ * - Absolute humidity: within 0.02 % of the value plus 0.01 g/m³.
+ * - Heat index: within 0.01 °C up to the clamp below. The NOAA regression itself is accurate to
+ *   0.7 °C within its tables, which end at a heat index of about 57 °C.
+ */
+
+/*
+ * Range of the heat index, the range of the sint8 ESS characteristic in 0.01 °C. The regression
+ * grows with the square of temperature and humidity and leaves int16 from about 60 °C at 97.5 %RH.
+ */
+#define PSYCHROMETRICS_HEAT_INDEX_MIN -12700
+#define PSYCHROMETRICS_HEAT_INDEX_MAX 12700
+
+/**
+ * @brief Dew point by the Magnus formula.
+ *
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Relative humidity in 0.01 %, 0 is evaluated as 0.01 %.
+ *
+ * @return Dew point in 0.01 °C, rounded to nearest.
+ */
+int16_t psychrometrics_dew_point(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Absolute humidity from the Magnus vapour pressure and the ideal gas law.
+ *
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Relative humidity in 0.01 %.
+ *
+ * @return Water vapour density in 0.01 g/m³, rounded to nearest, saturated at UINT16_MAX.
+ */
+uint16_t psychrometrics_absolute_humidity(int16_t temperature, uint16_t humidity);
+
+/**
+ * @brief Heat index by the NOAA algorithm.
+ *
+ * Steadman's simple formula below 80 °F (26.7 °C), the Rothfusz regression with the low and
+ * high humidity adjustments above.
+ *
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Relative humidity in 0.01 %.
+ *
+ * @return Heat index in 0.01 °C, rounded to nearest, clamped to PSYCHROMETRICS_HEAT_INDEX_MIN -
+ *         PSYCHROMETRICS_HEAT_INDEX_MAX.
+ */
+int16_t psychrometrics_heat_index(int16_t temperature, uint16_t humidity);
+
+#endif /* APP_PSYCHROMETRICS_H_ */
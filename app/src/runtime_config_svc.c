@@ -0,0 +1,366 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#if defined(CONFIG_MCUMGR)
+#include <zcbor_common.h>
+#include <zcbor_decode.h>
+#include <zcbor_encode.h>
+#include <zephyr/mgmt/mcumgr/mgmt/handlers.h>
+#include <zephyr/mgmt/mcumgr/mgmt/mgmt.h>
+#include <zephyr/mgmt/mcumgr/smp/smp.h>
+#include <zephyr/mgmt/mcumgr/util/zcbor_bulk.h>
+#endif
+
+#include "events_svc.h"
+#include "runtime_config_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(runtime_config_svc, LOG_LEVEL_INF);
+
+#define BT_UUID_RUNTIME_CONFIG_SVC_VAL                                                             \
+	BT_UUID_128_ENCODE(0x8b5a0040, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+#define BT_UUID_RUNTIME_CONFIG_DATA_VAL                                                            \
+	BT_UUID_128_ENCODE(0x8b5a0041, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+
+#define BT_UUID_RUNTIME_CONFIG_SVC  BT_UUID_DECLARE_128(BT_UUID_RUNTIME_CONFIG_SVC_VAL)
+#define BT_UUID_RUNTIME_CONFIG_DATA BT_UUID_DECLARE_128(BT_UUID_RUNTIME_CONFIG_DATA_VAL)
+
+#define RUNTIME_CONFIG_VERSION 1
+#define RUNTIME_CONFIG_SIZE    13
+#define SETTINGS_SUBTREE       "app"
+#define SETTINGS_NAME          "cfg"
+#define MGMT_ID_CONFIG         0
+
+struct param_info {
+	const char *name; /* Key in the MCUmgr map */
+	uint32_t min;
+	uint32_t max;
+	uint8_t size; /* Bytes in the GATT record */
+};
+
+static const struct param_info params[RUNTIME_CONFIG_COUNT] = {
+	[RUNTIME_CONFIG_MEASURING_PERIOD] = {"period", 1, 86400, sizeof(uint32_t)},
+	[RUNTIME_CONFIG_FIRST_MEASUREMENT_DELAY] = {"first_delay", 0, 3600, sizeof(uint32_t)},
+	[RUNTIME_CONFIG_MIN_ADV_INTERVAL] = {"adv_min", 20, 10240, sizeof(uint16_t)},
+	[RUNTIME_CONFIG_MAX_ADV_INTERVAL] = {"adv_max", 20, 10240, sizeof(uint16_t)},
+};
+
+/* Stored as a single settings record, loaded in one read */
+struct config_record {
+	uint8_t version;
+	uint32_t values[RUNTIME_CONFIG_COUNT];
+} __packed;
+
+/*
+ * Thread-safety: The values are read from any thread as atomics. Writes come from the BT RX
+ * thread (GATT) and the SMP workqueue (MCUmgr), set_lock serializes the validation and the
+ * update of all values. The settings are written by save_work on the system workqueue.
+ */
+struct runtime_config_data {
+	atomic_t values[RUNTIME_CONFIG_COUNT];
+};
+
+static struct runtime_config_data data = {
+	.values = {
+		[RUNTIME_CONFIG_MEASURING_PERIOD] = ATOMIC_INIT(CONFIG_MEASURING_PERIOD_SECONDS),
+		[RUNTIME_CONFIG_FIRST_MEASUREMENT_DELAY] =
+			ATOMIC_INIT(CONFIG_FIRST_MEASUREMENT_DELAY_SECONDS),
+		[RUNTIME_CONFIG_MIN_ADV_INTERVAL] = ATOMIC_INIT(CONFIG_MIN_ADV_INTERVAL_MS),
+		[RUNTIME_CONFIG_MAX_ADV_INTERVAL] = ATOMIC_INIT(CONFIG_MAX_ADV_INTERVAL_MS),
+	},
+};
+
+static K_MUTEX_DEFINE(set_lock);
+
+static void save_work_handler(struct k_work *work);
+static K_WORK_DEFINE(save_work, save_work_handler);
+
+static bool values_valid(const uint32_t values[RUNTIME_CONFIG_COUNT])
+{
+	for (size_t i = 0; i < RUNTIME_CONFIG_COUNT; i++) {
+		if (values[i] < params[i].min || values[i] > params[i].max) {
+			return false;
+		}
+	}
+
+	return values[RUNTIME_CONFIG_MIN_ADV_INTERVAL] <= values[RUNTIME_CONFIG_MAX_ADV_INTERVAL];
+}
+
+static void values_get(uint32_t values[RUNTIME_CONFIG_COUNT])
+{
+	for (size_t i = 0; i < RUNTIME_CONFIG_COUNT; i++) {
+		values[i] = (uint32_t)atomic_get(&data.values[i]);
+	}
+}
+
+uint32_t runtime_config_svc_get(enum runtime_config_param param)
+{
+	return (uint32_t)atomic_get(&data.values[param]);
+}
+
+int runtime_config_svc_set(const uint32_t values[RUNTIME_CONFIG_COUNT])
+{
+	struct event evt = {.type = EVENT_CONFIG_CHANGED};
+
+	if (!values_valid(values)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&set_lock, K_FOREVER);
+
+	for (size_t i = 0; i < RUNTIME_CONFIG_COUNT; i++) {
+		if ((uint32_t)atomic_set(&data.values[i], values[i]) != values[i]) {
+			evt.config.changed |= BIT(i);
+		}
+	}
+
+	k_mutex_unlock(&set_lock);
+
+	if (evt.config.changed == 0) {
+		return 0;
+	}
+
+	LOG_INF("Configuration changed: period %u s, first delay %u s, advertising %u-%u ms",
+		values[RUNTIME_CONFIG_MEASURING_PERIOD],
+		values[RUNTIME_CONFIG_FIRST_MEASUREMENT_DELAY],
+		values[RUNTIME_CONFIG_MIN_ADV_INTERVAL], values[RUNTIME_CONFIG_MAX_ADV_INTERVAL]);
+
+	events_svc_publish(&evt);
+	k_work_submit(&save_work);
+
+	return 0;
+}
+
+static void save_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	struct config_record record = {.version = RUNTIME_CONFIG_VERSION};
+	int ret;
+
+	values_get(record.values);
+
+	ret = settings_save_one(SETTINGS_SUBTREE "/" SETTINGS_NAME, &record, sizeof(record));
+	if (ret != 0) {
+		LOG_ERR("Failed to store the configuration: %d", ret);
+	}
+}
+
+static int settings_load_cb(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg,
+			    void *param)
+{
+	struct config_record *record = param;
+	ssize_t ret;
+
+	if (!settings_name_steq(key, SETTINGS_NAME, NULL)) {
+		return 0;
+	}
+
+	if (len != sizeof(*record)) {
+		LOG_WRN("Ignoring stored configuration of %zu bytes", len);
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, record, sizeof(*record));
+	if (ret != sizeof(*record)) {
+		LOG_WRN("Failed to read the stored configuration: %d", (int)ret);
+		record->version = 0;
+	}
+
+	return 0;
+}
+
+static void record_encode(uint8_t buf[RUNTIME_CONFIG_SIZE])
+{
+	uint32_t values[RUNTIME_CONFIG_COUNT];
+	uint8_t *pos = buf;
+
+	values_get(values);
+
+	*pos++ = RUNTIME_CONFIG_VERSION;
+	for (size_t i = 0; i < RUNTIME_CONFIG_COUNT; i++) {
+		if (params[i].size == sizeof(uint32_t)) {
+			sys_put_le32(values[i], pos);
+		} else {
+			sys_put_le16((uint16_t)values[i], pos);
+		}
+		pos += params[i].size;
+	}
+}
+
+static ssize_t read_config(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+			   uint16_t len, uint16_t offset)
+{
+	uint8_t value[RUNTIME_CONFIG_SIZE];
+
+	record_encode(value);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+static ssize_t write_config(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf,
+			    uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const uint8_t *pos = buf;
+	uint32_t values[RUNTIME_CONFIG_COUNT];
+
+	ARG_UNUSED(conn);
+	ARG_UNUSED(attr);
+	ARG_UNUSED(flags);
+
+	if (offset != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	if (len != RUNTIME_CONFIG_SIZE) {
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	if (*pos++ != RUNTIME_CONFIG_VERSION) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	for (size_t i = 0; i < RUNTIME_CONFIG_COUNT; i++) {
+		values[i] = params[i].size == sizeof(uint32_t) ? sys_get_le32(pos)
+							       : sys_get_le16(pos);
+		pos += params[i].size;
+	}
+
+	if (runtime_config_svc_set(values) != 0) {
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+
+	return len;
+}
+
+BT_GATT_SERVICE_DEFINE(runtime_config_service, BT_GATT_PRIMARY_SERVICE(BT_UUID_RUNTIME_CONFIG_SVC),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_RUNTIME_CONFIG_DATA,
+					      BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+					      BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT,
+					      read_config, write_config, NULL), );
+
+#if defined(CONFIG_MCUMGR)
+static bool mgmt_values_encode(zcbor_state_t *zse)
+{
+	uint32_t values[RUNTIME_CONFIG_COUNT];
+	bool ok = true;
+
+	values_get(values);
+
+	for (size_t i = 0; i < RUNTIME_CONFIG_COUNT && ok; i++) {
+		ok = zcbor_tstr_encode_ptr(zse, params[i].name, strlen(params[i].name)) &&
+		     zcbor_uint32_put(zse, values[i]);
+	}
+
+	return ok;
+}
+
+static int mgmt_config_read(struct smp_streamer *ctxt)
+{
+	return mgmt_values_encode(ctxt->writer->zs) ? MGMT_ERR_EOK : MGMT_ERR_EMSGSIZE;
+}
+
+static int mgmt_config_write(struct smp_streamer *ctxt)
+{
+	uint32_t values[RUNTIME_CONFIG_COUNT];
+	size_t decoded;
+	struct zcbor_map_decode_key_val map[] = {
+		ZCBOR_MAP_DECODE_KEY_DECODER("period", zcbor_uint32_decode,
+					     &values[RUNTIME_CONFIG_MEASURING_PERIOD]),
+		ZCBOR_MAP_DECODE_KEY_DECODER("first_delay", zcbor_uint32_decode,
+					     &values[RUNTIME_CONFIG_FIRST_MEASUREMENT_DELAY]),
+		ZCBOR_MAP_DECODE_KEY_DECODER("adv_min", zcbor_uint32_decode,
+					     &values[RUNTIME_CONFIG_MIN_ADV_INTERVAL]),
+		ZCBOR_MAP_DECODE_KEY_DECODER("adv_max", zcbor_uint32_decode,
+					     &values[RUNTIME_CONFIG_MAX_ADV_INTERVAL]),
+	};
+
+	/* Values left out of the request keep their current setting */
+	values_get(values);
+
+	if (zcbor_map_decode_bulk(ctxt->reader->zs, map, ARRAY_SIZE(map), &decoded) != 0) {
+		return MGMT_ERR_EINVAL;
+	}
+
+	if (runtime_config_svc_set(values) != 0) {
+		return MGMT_ERR_EINVAL;
+	}
+
+	return mgmt_values_encode(ctxt->writer->zs) ? MGMT_ERR_EOK : MGMT_ERR_EMSGSIZE;
+}
+
+static const struct mgmt_handler mgmt_config_handlers[] = {
+	[MGMT_ID_CONFIG] = {
+		.mh_read = mgmt_config_read,
+		.mh_write = mgmt_config_write,
+	},
+};
+
+static struct mgmt_group mgmt_config_group = {
+	.mg_handlers = mgmt_config_handlers,
+	.mg_handlers_count = ARRAY_SIZE(mgmt_config_handlers),
+	.mg_group_id = CONFIG_RUNTIME_CONFIG_MGMT_GROUP_ID,
+};
+
+static void mgmt_config_register(void)
+{
+	mgmt_register_group(&mgmt_config_group);
+}
+
+MCUMGR_HANDLER_DEFINE(runtime_config, mgmt_config_register);
+#endif
+
+int runtime_config_svc_init(void)
+{
+	struct config_record record = {0};
+	int ret;
+
+	ret = settings_subsys_init();
+	if (ret != 0) {
+		LOG_ERR("Failed to initialize settings: %d", ret);
+		return ret;
+	}
+
+	ret = settings_load_subtree_direct(SETTINGS_SUBTREE, settings_load_cb, &record);
+	if (ret != 0) {
+		LOG_ERR("Failed to load the configuration: %d", ret);
+		return ret;
+	}
+
+	if (record.version != RUNTIME_CONFIG_VERSION) {
+		LOG_INF("No stored configuration, using the defaults");
+		return 0;
+	}
+
+	if (!values_valid(record.values)) {
+		LOG_WRN("Stored configuration out of range, using the defaults");
+		return 0;
+	}
+
+	for (size_t i = 0; i < RUNTIME_CONFIG_COUNT; i++) {
+		atomic_set(&data.values[i], record.values[i]);
+	}
+
+	LOG_INF("Configuration loaded: period %u s, first delay %u s, advertising %u-%u ms",
+		record.values[RUNTIME_CONFIG_MEASURING_PERIOD],
+		record.values[RUNTIME_CONFIG_FIRST_MEASUREMENT_DELAY],
+		record.values[RUNTIME_CONFIG_MIN_ADV_INTERVAL],
+		record.values[RUNTIME_CONFIG_MAX_ADV_INTERVAL]);
+
+	return 0;
+}
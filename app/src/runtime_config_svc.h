@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_RUNTIME_CONFIG_SVC_H_
+#define APP_RUNTIME_CONFIG_SVC_H_
+
+#include <stdint.h>
+
+/*
+ * Runtime configuration GATT service and MCUmgr group
+ *
+ * Holds the parameters that trade power against latency, initialized from Kconfig and changeable
+ * without a DFU. Changes are validated as a whole, applied right away (EVENT_CONFIG_CHANGED) and
+ * persisted as one settings record in storage_partition, so booting loads all of them in a single
+ * read.
+ *
+ * Configuration (read, write), all values little endian:
+ *   <u8 version = 1> <u32 measuring period> <u32 first measurement delay>
+ *   <u16 minimum advertising interval> <u16 maximum advertising interval>
+ *     Periods in seconds, intervals in milliseconds. A write carries all values.
+ *
+ * MCUmgr group CONFIG_RUNTIME_CONFIG_MGMT_GROUP_ID, command 0: a read returns and a write takes
+ * a map of "period", "first_delay", "adv_min" and "adv_max", a write may leave values out.
+ */
+
+enum runtime_config_param {
+	RUNTIME_CONFIG_MEASURING_PERIOD,        /* In seconds */
+	RUNTIME_CONFIG_FIRST_MEASUREMENT_DELAY, /* In seconds, applies from the next connection */
+	RUNTIME_CONFIG_MIN_ADV_INTERVAL,        /* In milliseconds */
+	RUNTIME_CONFIG_MAX_ADV_INTERVAL,        /* In milliseconds */
+	RUNTIME_CONFIG_COUNT,
+};
+
+/**
+ * @brief Get a configuration value.
+ *
+ * Can be called from any thread.
+ *
+ * @param param Configuration parameter.
+ *
+ * @return Current value of @p param.
+ */
+uint32_t runtime_config_svc_get(enum runtime_config_param param);
+
+/**
+ * @brief Change the configuration.
+ *
+ * Validates all values, applies and persists them. Can be called from any thread, the settings
+ * are written on the system workqueue.
+ *
+ * @param values New value of every parameter, indexed by enum runtime_config_param.
+ *
+ * @return 0 on success, -EINVAL if a value is out of range.
+ */
+int runtime_config_svc_set(const uint32_t values[RUNTIME_CONFIG_COUNT]);
+
+/**
+ * @brief Initialize the settings subsystem and load the stored configuration.
+ *
+ * Call after history_svc_init() if the history log is enabled, they share the partition.
+ *
+ * @return 0 on success, or error code.
+ */
+int runtime_config_svc_init(void);
+
+#endif /* APP_RUNTIME_CONFIG_SVC_H_ */
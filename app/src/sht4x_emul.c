@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT sensirion_sht4x
+
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "sht4x_emul.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(sht4x_emul, LOG_LEVEL_INF);
+
+#define SHT4X_CMD_MEASURE_HPM 0xFD
+#define SHT4X_CMD_MEASURE_MPM 0xF6
+#define SHT4X_CMD_MEASURE_LPM 0xE0
+#define SHT4X_CMD_READ_SERIAL 0x89
+#define SHT4X_CMD_RESET       0x94
+
+#define SHT4X_CRC_POLY 0x31
+#define SHT4X_CRC_INIT 0xFF
+
+/* Two 16-bit words, each followed by its CRC */
+#define SHT4X_RESPONSE_SIZE 6
+
+/* Transfer functions in 0.01 units: T = -45 + 175 * raw / 65535, RH = -6 + 125 * raw / 65535 */
+#define SHT4X_TEMP_OFFSET_CENTI 4500
+#define SHT4X_TEMP_SPAN_CENTI   17500
+#define SHT4X_RH_OFFSET_CENTI   600
+#define SHT4X_RH_SPAN_CENTI     12500
+
+#define SHT4X_EMUL_SERIAL 0x53484D31 /* "SHM1" */
+
+#define DEFAULT_TEMPERATURE_CENTI 2150
+#define DEFAULT_HUMIDITY_CENTI    5500
+
+/*
+ * Thread-safety: The transfer runs in the context of the driver (RTIO workqueue), the setters
+ * in the caller's, both take the lock.
+ */
+struct sht4x_emul_data {
+	struct k_spinlock lock;
+	uint8_t cmd;
+	uint16_t raw_temperature;
+	uint16_t raw_humidity;
+	uint32_t measurements;
+};
+
+static int raw_from_centi(int32_t centi, int32_t offset, int32_t span, uint16_t *raw)
+{
+	int64_t scaled = ((int64_t)(centi + offset) * UINT16_MAX + span / 2) / span;
+
+	if (!IN_RANGE(scaled, 0, UINT16_MAX)) {
+		return -EINVAL;
+	}
+
+	*raw = (uint16_t)scaled;
+
+	return 0;
+}
+
+static void put_word(uint8_t *buf, uint16_t word)
+{
+	sys_put_be16(word, buf);
+	buf[2] = crc8(buf, 2, SHT4X_CRC_POLY, SHT4X_CRC_INIT, false);
+}
+
+static int sht4x_emul_read(const struct emul *target, uint8_t *buf, uint32_t len)
+{
+	struct sht4x_emul_data *data = target->data;
+	uint8_t response[SHT4X_RESPONSE_SIZE];
+	k_spinlock_key_t key;
+
+	if (len > sizeof(response)) {
+		return -EIO;
+	}
+
+	if (IS_ENABLED(CONFIG_SHT4X_EMUL_TRACE)) {
+		int16_t temperature;
+		int16_t humidity;
+
+		/* The trace loader rejects values the sensor cannot encode */
+		if (sht4x_emul_trace_get(k_uptime_get(), &temperature, &humidity) == 0) {
+			(void)sht4x_emul_set_measurement(target, temperature, humidity);
+		}
+	}
+
+	key = k_spin_lock(&data->lock);
+
+	switch (data->cmd) {
+	case SHT4X_CMD_MEASURE_HPM:
+	case SHT4X_CMD_MEASURE_MPM:
+	case SHT4X_CMD_MEASURE_LPM:
+		put_word(&response[0], data->raw_temperature);
+		put_word(&response[3], data->raw_humidity);
+		data->measurements++;
+		break;
+
+	case SHT4X_CMD_READ_SERIAL:
+		put_word(&response[0], SHT4X_EMUL_SERIAL >> 16);
+		put_word(&response[3], SHT4X_EMUL_SERIAL & 0xFFFF);
+		break;
+
+	default:
+		/* The sensor NACKs reads without a command that produces data */
+		k_spin_unlock(&data->lock, key);
+		return -EIO;
+	}
+
+	/* Every command produces one response */
+	data->cmd = 0;
+
+	k_spin_unlock(&data->lock, key);
+
+	memcpy(buf, response, len);
+
+	return 0;
+}
+
+static int sht4x_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs,
+			       int addr)
+{
+	struct sht4x_emul_data *data = target->data;
+	k_spinlock_key_t key;
+	int ret;
+
+	ARG_UNUSED(addr);
+
+	for (int i = 0; i < num_msgs; i++) {
+		if (msgs[i].flags & I2C_MSG_READ) {
+			ret = sht4x_emul_read(target, msgs[i].buf, msgs[i].len);
+			if (ret != 0) {
+				return ret;
+			}
+			continue;
+		}
+
+		/* All SHT4x commands are a single byte without arguments */
+		if (msgs[i].len != 1) {
+			LOG_WRN("Unexpected write of %u bytes", msgs[i].len);
+			return -EIO;
+		}
+
+		key = k_spin_lock(&data->lock);
+		data->cmd = msgs[i].buf[0] == SHT4X_CMD_RESET ? 0 : msgs[i].buf[0];
+		k_spin_unlock(&data->lock, key);
+	}
+
+	return 0;
+}
+
+int sht4x_emul_set_measurement(const struct emul *target, int16_t temperature, int16_t humidity)
+{
+	struct sht4x_emul_data *data = target->data;
+	k_spinlock_key_t key;
+	uint16_t raw_temperature;
+	uint16_t raw_humidity;
+	int ret;
+
+	ret = raw_from_centi(temperature, SHT4X_TEMP_OFFSET_CENTI, SHT4X_TEMP_SPAN_CENTI,
+			     &raw_temperature);
+	if (ret != 0) {
+		return ret;
+	}
+
+	ret = raw_from_centi(humidity, SHT4X_RH_OFFSET_CENTI, SHT4X_RH_SPAN_CENTI, &raw_humidity);
+	if (ret != 0) {
+		return ret;
+	}
+
+	key = k_spin_lock(&data->lock);
+	data->raw_temperature = raw_temperature;
+	data->raw_humidity = raw_humidity;
+	k_spin_unlock(&data->lock, key);
+
+	return 0;
+}
+
+uint32_t sht4x_emul_get_measurement_count(const struct emul *target)
+{
+	struct sht4x_emul_data *data = target->data;
+	k_spinlock_key_t key = k_spin_lock(&data->lock);
+	uint32_t count = data->measurements;
+
+	k_spin_unlock(&data->lock, key);
+
+	return count;
+}
+
+static int sht4x_emul_init(const struct emul *target, const struct device *parent)
+{
+	int ret;
+
+	ARG_UNUSED(parent);
+
+	if (IS_ENABLED(CONFIG_SHT4X_EMUL_TRACE)) {
+		ret = sht4x_emul_trace_load();
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
+	return sht4x_emul_set_measurement(target, DEFAULT_TEMPERATURE_CENTI,
+					  DEFAULT_HUMIDITY_CENTI);
+}
+
+static const struct i2c_emul_api sht4x_emul_api_i2c = {
+	.transfer = sht4x_emul_transfer,
+};
+
+#define SHT4X_EMUL(n)                                                                              \
+	static struct sht4x_emul_data sht4x_emul_data_##n;                                         \
+	EMUL_DT_INST_DEFINE(n, sht4x_emul_init, &sht4x_emul_data_##n, NULL, &sht4x_emul_api_i2c,   \
+			    NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(SHT4X_EMUL)
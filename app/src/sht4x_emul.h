@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_SHT4X_EMUL_H_
+#define APP_SHT4X_EMUL_H_
+
+#include <stdint.h>
+
+#include <zephyr/drivers/emul.h>
+
+/*
+ * I2C emulator of the Sensirion SHT4x for the simulated build (native_sim). It answers the
+ * measure commands of all three repeatabilities with the programmed reading, encoded and
+ * CRC-protected like the real sensor, so the Zephyr sht4x driver runs unmodified on top of it.
+ */
+
+/**
+ * @brief Set the reading returned by the following measurements.
+ *
+ * Thread-safe, may be called while the driver is reading.
+ *
+ * @param target Emulator instance, e.g. EMUL_DT_GET(DT_ALIAS(sht_sensor)).
+ * @param temperature Temperature in 0.01 °C, -45.00 °C to 130.00 °C.
+ * @param humidity Relative humidity in 0.01 %, -6.00 % to 119.00 % (the driver clamps).
+ * @return 0 on success, -EINVAL if a value cannot be encoded by the sensor.
+ */
+int sht4x_emul_set_measurement(const struct emul *target, int16_t temperature, int16_t humidity);
+
+/**
+ * @brief Get the number of measurements served so far.
+ *
+ * @param target Emulator instance.
+ * @return Number of measurement results read by the driver.
+ */
+uint32_t sht4x_emul_get_measurement_count(const struct emul *target);
+
+/*
+ * Trace replay (CONFIG_SHT4X_EMUL_TRACE): with --sht4x-trace=<file> on the command line of the
+ * simulated build, every measurement returns the trace reading at the current uptime, linearly
+ * interpolated between samples. --sht4x-trace-speed=<n> replays n trace seconds per second of
+ * uptime, on top of the simulator's own --rt-ratio or --no-rt.
+ */
+
+/**
+ * @brief Load the trace given on the command line.
+ *
+ * Called by the emulator while it initializes.
+ *
+ * @return 0 on success or if no trace was given, negative error code otherwise.
+ */
+int sht4x_emul_trace_load(void);
+
+/**
+ * @brief Get the trace reading at an uptime.
+ *
+ * Holds the last sample once the trace is exhausted.
+ *
+ * @param uptime_ms Uptime in milliseconds, the first trace sample is the reading at boot.
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Relative humidity in 0.01 %.
+ * @return 0 on success, -ENODATA if no trace is loaded.
+ */
+int sht4x_emul_trace_get(int64_t uptime_ms, int16_t *temperature, int16_t *humidity);
+
+#endif /* APP_SHT4X_EMUL_H_ */
@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <cmdline.h>
+#include <nsi_host_trampolines.h>
+#include <posix_native_task.h>
+
+#include "sht4x_emul.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(sht4x_emul_trace, LOG_LEVEL_INF);
+
+#define HOST_O_RDONLY   0
+#define READ_CHUNK_SIZE 4096
+
+#define BINARY_MAGIC       "SHT4TRC1"
+#define BINARY_MAGIC_SIZE  (sizeof(BINARY_MAGIC) - 1)
+#define BINARY_RECORD_SIZE 8
+
+/* Range the sensor can encode, see sht4x_emul_set_measurement() */
+#define TEMPERATURE_CENTI_MIN (-4500)
+#define TEMPERATURE_CENTI_MAX 13000
+#define HUMIDITY_CENTI_MIN    (-600)
+#define HUMIDITY_CENTI_MAX    11900
+
+struct trace_row {
+	uint32_t time_ms;
+	int16_t temperature;
+	int16_t humidity;
+};
+
+/*
+ * Thread-safety: The trace is loaded once while the emulator initializes and is read-only
+ * afterwards. Every emulated probe reads it, possibly from different RTIO threads, so the
+ * cursor and the finished flag are protected by the lock.
+ */
+struct trace_data {
+	struct trace_row *rows;
+	size_t count;
+	struct k_spinlock lock;
+	size_t cursor;
+	bool finished;
+};
+
+static struct trace_data data;
+
+static char *trace_file;
+static uint32_t trace_speed = 1;
+
+static void add_trace_options(void)
+{
+	static struct args_struct_t trace_options[] = {
+		{
+			.option = "sht4x-trace",
+			.name = "file",
+			.type = 's',
+			.dest = (void *)&trace_file,
+			.descript = "Replay this temperature/humidity trace (CSV or binary) on the "
+				    "emulated SHT4x",
+		},
+		{
+			.option = "sht4x-trace-speed",
+			.name = "factor",
+			.type = 'u',
+			.dest = (void *)&trace_speed,
+			.descript = "Trace seconds replayed per second of uptime (default 1)",
+		},
+		ARG_TABLE_ENDMARKER,
+	};
+
+	native_add_command_line_opts(trace_options);
+}
+NATIVE_TASK(add_trace_options, PRE_BOOT_1, 10);
+
+/* Reads the whole file into host memory, NUL terminated */
+static char *read_file(const char *path, size_t *size)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	size_t capacity = 0;
+	long n;
+	int fd;
+
+	fd = nsi_host_open(path, HOST_O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	do {
+		if (capacity - len < READ_CHUNK_SIZE + 1) {
+			char *grown;
+
+			capacity += READ_CHUNK_SIZE * 16;
+			grown = nsi_host_realloc(buf, capacity);
+			if (grown == NULL) {
+				nsi_host_free(buf);
+				nsi_host_close(fd);
+				return NULL;
+			}
+			buf = grown;
+		}
+
+		n = nsi_host_read(fd, &buf[len], READ_CHUNK_SIZE);
+		if (n > 0) {
+			len += n;
+		}
+	} while (n > 0);
+
+	nsi_host_close(fd);
+
+	if (n < 0) {
+		nsi_host_free(buf);
+		return NULL;
+	}
+
+	buf[len] = '\0';
+	*size = len;
+
+	return buf;
+}
+
+/*
+ * Parses a decimal number with up to `decimals` fractional digits into an integer scaled by
+ * 10^decimals. Further digits are truncated, the trace stays free of floating point.
+ */
+static int parse_fixed(const char **p, int decimals, int64_t *value)
+{
+	const char *s = *p;
+	bool negative = false;
+	bool digits = false;
+	int64_t result = 0;
+	int fraction = 0;
+
+	while (*s == ' ' || *s == '\t') {
+		s++;
+	}
+
+	if (*s == '-' || *s == '+') {
+		negative = *s == '-';
+		s++;
+	}
+
+	for (; *s >= '0' && *s <= '9'; s++) {
+		result = result * 10 + (*s - '0');
+		digits = true;
+		if (result > INT32_MAX) {
+			return -ERANGE;
+		}
+	}
+
+	if (*s == '.') {
+		for (s++; *s >= '0' && *s <= '9'; s++) {
+			if (fraction < decimals) {
+				result = result * 10 + (*s - '0');
+				fraction++;
+			}
+			digits = true;
+		}
+	}
+
+	if (!digits) {
+		return -EINVAL;
+	}
+
+	for (; fraction < decimals; fraction++) {
+		result *= 10;
+	}
+
+	*value = negative ? -result : result;
+	*p = s;
+
+	return 0;
+}
+
+static int add_row(struct trace_row *rows, size_t count, int64_t time_ms, int64_t temperature,
+		   int64_t humidity)
+{
+	if (!IN_RANGE(time_ms, 0, UINT32_MAX) ||
+	    (count > 0 && time_ms <= rows[count - 1].time_ms)) {
+		return -EINVAL;
+	}
+
+	if (!IN_RANGE(temperature, TEMPERATURE_CENTI_MIN, TEMPERATURE_CENTI_MAX) ||
+	    !IN_RANGE(humidity, HUMIDITY_CENTI_MIN, HUMIDITY_CENTI_MAX)) {
+		return -ERANGE;
+	}
+
+	rows[count].time_ms = time_ms;
+	rows[count].temperature = temperature;
+	rows[count].humidity = humidity;
+
+	return 0;
+}
+
+static const char *row_error(int ret)
+{
+	return ret == -ERANGE ? "value out of sensor range" : "time not ascending";
+}
+
+/*
+ * CSV: "<seconds>,<temperature in °C>,<humidity in %>" per line, e.g. "600,21.53,48.20".
+ * Commas, semicolons or whitespace separate the fields. Empty lines, lines starting with '#'
+ * and a header line are skipped.
+ */
+static int parse_csv(const char *text, size_t size)
+{
+	const char *line = text;
+	size_t lines = 1;
+	size_t line_nr = 0;
+	int ret;
+
+	for (size_t i = 0; i < size; i++) {
+		lines += text[i] == '\n';
+	}
+
+	data.rows = nsi_host_malloc(lines * sizeof(*data.rows));
+	if (data.rows == NULL) {
+		return -ENOMEM;
+	}
+
+	while (*line != '\0') {
+		const char *p = line;
+		const char *next = strchr(line, '\n');
+		int64_t fields[3];
+
+		next = next != NULL ? next + 1 : line + strlen(line);
+		line_nr++;
+
+		while (*p == ' ' || *p == '\t' || *p == '\r') {
+			p++;
+		}
+
+		if (*p == '\n' || *p == '\0' || *p == '#' ||
+		    (data.count == 0 && !(*p == '-' || *p == '+' || (*p >= '0' && *p <= '9')))) {
+			line = next;
+			continue;
+		}
+
+		for (int f = 0; f < (int)ARRAY_SIZE(fields); f++) {
+			ret = parse_fixed(&p, f == 0 ? 3 : 2, &fields[f]);
+			if (ret != 0) {
+				LOG_ERR("Line %zu: malformed field %d", line_nr, f + 1);
+				return ret;
+			}
+
+			while (*p == ',' || *p == ';' || *p == ' ' || *p == '\t') {
+				p++;
+			}
+		}
+
+		ret = add_row(data.rows, data.count, fields[0], fields[1], fields[2]);
+		if (ret != 0) {
+			LOG_ERR("Line %zu: %s", line_nr, row_error(ret));
+			return ret;
+		}
+
+		data.count++;
+		line = next;
+	}
+
+	return 0;
+}
+
+/*
+ * Binary: the magic "SHT4TRC1", then one little-endian record per sample:
+ * u32 time in ms, s16 temperature in 0.01 °C, s16 humidity in 0.01 %.
+ */
+static int parse_binary(const uint8_t *buf, size_t size)
+{
+	size_t records = (size - BINARY_MAGIC_SIZE) / BINARY_RECORD_SIZE;
+	const uint8_t *record = &buf[BINARY_MAGIC_SIZE];
+	int ret;
+
+	if ((size - BINARY_MAGIC_SIZE) % BINARY_RECORD_SIZE != 0) {
+		LOG_ERR("Truncated binary trace");
+		return -EINVAL;
+	}
+
+	data.rows = nsi_host_malloc(MAX(records, 1) * sizeof(*data.rows));
+	if (data.rows == NULL) {
+		return -ENOMEM;
+	}
+
+	for (size_t i = 0; i < records; i++, record += BINARY_RECORD_SIZE) {
+		ret = add_row(data.rows, data.count, sys_get_le32(&record[0]),
+			      (int16_t)sys_get_le16(&record[4]), (int16_t)sys_get_le16(&record[6]));
+		if (ret != 0) {
+			LOG_ERR("Record %zu: %s", i, row_error(ret));
+			return ret;
+		}
+
+		data.count++;
+	}
+
+	return 0;
+}
+
+int sht4x_emul_trace_load(void)
+{
+	char *buf;
+	size_t size;
+	int ret;
+
+	if (trace_file == NULL) {
+		return 0;
+	}
+
+	if (trace_speed == 0) {
+		LOG_ERR("Trace speed must be at least 1");
+		return -EINVAL;
+	}
+
+	buf = read_file(trace_file, &size);
+	if (buf == NULL) {
+		LOG_ERR("Failed to read trace %s", trace_file);
+		return -EIO;
+	}
+
+	if (size >= BINARY_MAGIC_SIZE && memcmp(buf, BINARY_MAGIC, BINARY_MAGIC_SIZE) == 0) {
+		ret = parse_binary((const uint8_t *)buf, size);
+	} else {
+		ret = parse_csv(buf, size);
+	}
+
+	nsi_host_free(buf);
+
+	if (ret == 0 && data.count == 0) {
+		LOG_ERR("Trace %s holds no samples", trace_file);
+		ret = -ENODATA;
+	}
+
+	if (ret != 0) {
+		nsi_host_free(data.rows);
+		data.rows = NULL;
+		data.count = 0;
+		return ret;
+	}
+
+	LOG_INF("Replaying %zu samples over %u s of trace time at %ux", data.count,
+		(data.rows[data.count - 1].time_ms - data.rows[0].time_ms) / MSEC_PER_SEC,
+		trace_speed);
+
+	return 0;
+}
+
+static int16_t interpolate(int16_t v0, int16_t v1, uint32_t dt, uint32_t span)
+{
+	return v0 + (int16_t)(((int64_t)(v1 - v0) * dt) / span);
+}
+
+int sht4x_emul_trace_get(int64_t uptime_ms, int16_t *temperature, int16_t *humidity)
+{
+	const struct trace_row *a;
+	const struct trace_row *b;
+	k_spinlock_key_t key;
+	uint64_t time_ms;
+	size_t cursor;
+	bool finished;
+
+	if (data.count == 0) {
+		return -ENODATA;
+	}
+
+	/* The trace starts at boot, its first sample is the reading at uptime 0 */
+	time_ms = (uint64_t)data.rows[0].time_ms + (uint64_t)uptime_ms * trace_speed;
+
+	key = k_spin_lock(&data.lock);
+
+	if (data.cursor > 0 && time_ms < data.rows[data.cursor].time_ms) {
+		data.cursor = 0;
+	}
+
+	while (data.cursor + 1 < data.count && time_ms >= data.rows[data.cursor + 1].time_ms) {
+		data.cursor++;
+	}
+
+	cursor = data.cursor;
+	finished = cursor + 1 == data.count && !data.finished;
+	if (finished) {
+		data.finished = true;
+	}
+
+	k_spin_unlock(&data.lock, key);
+
+	a = &data.rows[cursor];
+
+	if (cursor + 1 == data.count) {
+		if (finished) {
+			LOG_INF("Trace replay finished, holding the last sample");
+		}
+
+		*temperature = a->temperature;
+		*humidity = a->humidity;
+		return 0;
+	}
+
+	b = &data.rows[cursor + 1];
+	*temperature = interpolate(a->temperature, b->temperature, time_ms - a->time_ms,
+				   b->time_ms - a->time_ms);
+	*humidity = interpolate(a->humidity, b->humidity, time_ms - a->time_ms,
+				b->time_ms - a->time_ms);
+
+	return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "fixed_point.h"
+#include "window_stats_svc.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(window_stats_svc, LOG_LEVEL_INF);
+
+#define BT_UUID_WINDOW_STATS_SVC_VAL                                                               \
+	BT_UUID_128_ENCODE(0x8b5a0030, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+#define BT_UUID_WINDOW_STATS_DATA_VAL                                                              \
+	BT_UUID_128_ENCODE(0x8b5a0031, 0x6f4e, 0x4c1b, 0x9a3c, 0x2f1e0d5a7b10)
+
+#define BT_UUID_WINDOW_STATS_SVC  BT_UUID_DECLARE_128(BT_UUID_WINDOW_STATS_SVC_VAL)
+#define BT_UUID_WINDOW_STATS_DATA BT_UUID_DECLARE_128(BT_UUID_WINDOW_STATS_DATA_VAL)
+
+#define STATS_VERSION       1
+#define BUCKETS             CONFIG_WINDOW_STATS_BUCKETS
+#define SHORT_WINDOW_MS     (CONFIG_WINDOW_STATS_SHORT_MINUTES * 60 * MSEC_PER_SEC)
+#define LONG_WINDOW_MS      (CONFIG_WINDOW_STATS_LONG_MINUTES * 60 * MSEC_PER_SEC)
+#define WINDOW_HDR_SIZE     8
+#define CHANNEL_RECORD_SIZE 12
+#define WINDOW_RECORD_SIZE  (WINDOW_HDR_SIZE + STATS_CHANNEL_COUNT * CHANNEL_RECORD_SIZE)
+#define STATS_SIZE          (1 + STATS_WINDOW_COUNT * WINDOW_RECORD_SIZE)
+
+/* Fixed point of the accumulators: mean in Q16, sum of squared deviations in Q8 */
+#define MEAN_FRACTION_BITS 16
+#define M2_FRACTION_BITS   8
+
+enum stats_channel {
+	STATS_CHANNEL_TEMPERATURE,
+	STATS_CHANNEL_HUMIDITY,
+	STATS_CHANNEL_COUNT,
+};
+
+enum stats_window {
+	STATS_WINDOW_SHORT,
+	STATS_WINDOW_LONG,
+	STATS_WINDOW_BOOT,
+	STATS_WINDOW_COUNT,
+};
+
+/* Welford accumulator of one channel, in 0.01 units */
+struct welford {
+	uint32_t count;
+	int16_t min;
+	int16_t max;
+	int64_t mean; /* Q16 */
+	uint64_t m2;  /* Sum of squared deviations from the mean, Q8 */
+};
+
+/* Ring of buckets, the bucket at head collects the measurements of the current interval */
+struct bucket_ring {
+	uint32_t bucket_ms;
+	int64_t current; /* Uptime / bucket_ms of the head bucket */
+	uint8_t head;
+	struct welford buckets[BUCKETS][STATS_CHANNEL_COUNT];
+};
+
+/*
+ * Thread-safety: Measurements are appended on the system workqueue, the statistics are read from
+ * the BT RX thread. Merging the buckets takes a few dozen 64-bit divisions, so both hold
+ * stats_lock, a mutex rather than a spinlock.
+ */
+struct window_stats_data {
+	struct bucket_ring rings[STATS_WINDOW_BOOT];
+	struct welford boot[STATS_CHANNEL_COUNT];
+	/* Snapshots served to long reads, one per connection so reads do not tear each other */
+	uint8_t snapshots[CONFIG_BT_MAX_CONN][STATS_SIZE];
+};
+
+static struct window_stats_data data = {
+	.rings = {
+		[STATS_WINDOW_SHORT] = {.bucket_ms = SHORT_WINDOW_MS / BUCKETS},
+		[STATS_WINDOW_LONG] = {.bucket_ms = LONG_WINDOW_MS / BUCKETS},
+	},
+};
+
+static K_MUTEX_DEFINE(stats_lock);
+
+BUILD_ASSERT(SHORT_WINDOW_MS / BUCKETS > 0 && LONG_WINDOW_MS / BUCKETS > 0,
+	     "A bucket must cover at least one millisecond");
+
+static void welford_add(struct welford *w, int16_t value)
+{
+	int64_t x = (int64_t)value << MEAN_FRACTION_BITS;
+	int64_t delta = x - w->mean;
+	int64_t product;
+
+	if (w->count == 0) {
+		w->min = value;
+		w->max = value;
+	} else {
+		w->min = MIN(w->min, value);
+		w->max = MAX(w->max, value);
+	}
+
+	w->count++;
+	w->mean += delta / w->count;
+
+	/* Both factors have the same sign, up to the rounding of the new mean */
+	product = delta * (x - w->mean);
+	if (product > 0) {
+		w->m2 += (uint64_t)product >> (2 * MEAN_FRACTION_BITS - M2_FRACTION_BITS);
+	}
+}
+
+/* Parallel combination (Chan et al.) of two accumulators */
+static void welford_merge(struct welford *acc, const struct welford *w)
+{
+	uint32_t count;
+	int64_t delta;
+	int64_t delta_q8;
+	uint64_t spread;
+
+	if (w->count == 0) {
+		return;
+	}
+
+	if (acc->count == 0) {
+		*acc = *w;
+		return;
+	}
+
+	count = acc->count + w->count;
+	delta = w->mean - acc->mean;
+	delta_q8 = delta / (1LL << (MEAN_FRACTION_BITS - M2_FRACTION_BITS));
+
+	/* delta^2 * n_acc * n_w / n */
+	spread = (uint64_t)(delta_q8 * delta_q8) >> M2_FRACTION_BITS;
+	spread = spread * acc->count / count * w->count;
+
+	acc->mean += delta * w->count / count;
+	acc->m2 += w->m2 + spread;
+	acc->min = MIN(acc->min, w->min);
+	acc->max = MAX(acc->max, w->max);
+	acc->count = count;
+}
+
+/* Clears the buckets whose interval ended, at most the whole ring */
+static void ring_advance(struct bucket_ring *ring, int64_t now)
+{
+	int64_t bucket = now / ring->bucket_ms;
+	int64_t steps = MIN(bucket - ring->current, BUCKETS);
+
+	for (; steps > 0; steps--) {
+		ring->head = (ring->head + 1) % BUCKETS;
+		memset(ring->buckets[ring->head], 0, sizeof(ring->buckets[ring->head]));
+	}
+
+	ring->current = bucket;
+}
+
+void window_stats_svc_append(int16_t temperature, uint16_t humidity)
+{
+	int64_t now = k_uptime_get();
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+
+	for (size_t i = 0; i < ARRAY_SIZE(data.rings); i++) {
+		struct bucket_ring *ring = &data.rings[i];
+
+		ring_advance(ring, now);
+		welford_add(&ring->buckets[ring->head][STATS_CHANNEL_TEMPERATURE], temperature);
+		welford_add(&ring->buckets[ring->head][STATS_CHANNEL_HUMIDITY], humidity);
+	}
+
+	welford_add(&data.boot[STATS_CHANNEL_TEMPERATURE], temperature);
+	welford_add(&data.boot[STATS_CHANNEL_HUMIDITY], humidity);
+
+	k_mutex_unlock(&stats_lock);
+}
+
+static uint8_t *put_channel(uint8_t *buf, const struct welford *w)
+{
+	uint16_t stddev = 0;
+	int64_t mean = 0;
+
+	if (w->count > 1) {
+		/* sqrt of the Q8 variance is Q4 */
+		stddev = MIN((fixed_point_isqrt(w->m2 / (w->count - 1)) + 8) >> 4, UINT16_MAX);
+	}
+
+	if (w->count > 0) {
+		mean = (w->mean + (1LL << (MEAN_FRACTION_BITS - 1))) >> MEAN_FRACTION_BITS;
+	}
+
+	sys_put_le32(w->count, &buf[0]);
+	sys_put_le16(w->count > 0 ? w->min : 0, &buf[4]);
+	sys_put_le16(w->count > 0 ? w->max : 0, &buf[6]);
+	sys_put_le16((int16_t)mean, &buf[8]);
+	sys_put_le16(stddev, &buf[10]);
+
+	return buf + CHANNEL_RECORD_SIZE;
+}
+
+/* Must be called with the lock held */
+static void build_snapshot(uint8_t *buf)
+{
+	int64_t now = k_uptime_get();
+
+	*buf++ = STATS_VERSION;
+
+	for (size_t i = 0; i < ARRAY_SIZE(data.rings); i++) {
+		struct bucket_ring *ring = &data.rings[i];
+		struct welford merged[STATS_CHANNEL_COUNT] = {0};
+		int64_t covered;
+
+		/* Buckets of intervals that ended without a measurement must not count */
+		ring_advance(ring, now);
+
+		for (size_t b = 0; b < BUCKETS; b++) {
+			for (size_t ch = 0; ch < STATS_CHANNEL_COUNT; ch++) {
+				welford_merge(&merged[ch], &ring->buckets[b][ch]);
+			}
+		}
+
+		covered = (int64_t)(BUCKETS - 1) * ring->bucket_ms + now % ring->bucket_ms;
+		covered = MIN(covered, now);
+
+		sys_put_le32((uint32_t)(ring->bucket_ms * BUCKETS / MSEC_PER_SEC), &buf[0]);
+		sys_put_le32((uint32_t)(covered / MSEC_PER_SEC), &buf[4]);
+		buf += WINDOW_HDR_SIZE;
+
+		for (size_t ch = 0; ch < STATS_CHANNEL_COUNT; ch++) {
+			buf = put_channel(buf, &merged[ch]);
+		}
+	}
+
+	sys_put_le32(0, &buf[0]);
+	sys_put_le32((uint32_t)(now / MSEC_PER_SEC), &buf[4]);
+	buf += WINDOW_HDR_SIZE;
+
+	for (size_t ch = 0; ch < STATS_CHANNEL_COUNT; ch++) {
+		buf = put_channel(buf, &data.boot[ch]);
+	}
+}
+
+static ssize_t read_stats(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+			  uint16_t len, uint16_t offset)
+{
+	uint8_t *snapshot = data.snapshots[conn != NULL ? bt_conn_index(conn) : 0];
+	ssize_t ret;
+
+	k_mutex_lock(&stats_lock, K_FOREVER);
+
+	/* Read blob requests continue from the snapshot of the initial read */
+	if (offset == 0) {
+		build_snapshot(snapshot);
+	}
+
+	ret = bt_gatt_attr_read(conn, attr, buf, len, offset, snapshot, STATS_SIZE);
+
+	k_mutex_unlock(&stats_lock);
+
+	return ret;
+}
+
+BT_GATT_SERVICE_DEFINE(window_stats_service, BT_GATT_PRIMARY_SERVICE(BT_UUID_WINDOW_STATS_SVC),
+		       BT_GATT_CHARACTERISTIC(BT_UUID_WINDOW_STATS_DATA, BT_GATT_CHRC_READ,
+					      BT_GATT_PERM_READ, read_stats, NULL, NULL), );
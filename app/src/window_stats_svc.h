@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_WINDOW_STATS_SVC_H_
+#define APP_WINDOW_STATS_SVC_H_
+
+#include <stdint.h>
+
+/*
+ * Windowed statistics GATT service
+ *
+ * Keeps count, minimum, maximum, mean and standard deviation of temperature and humidity over
+ * the last CONFIG_WINDOW_STATS_SHORT_MINUTES, the last CONFIG_WINDOW_STATS_LONG_MINUTES and
+ * since boot. Each window is a ring of CONFIG_WINDOW_STATS_BUCKETS Welford accumulators in fixed
+ * point, a measurement updates the newest bucket in O(1). The buckets are only merged when the
+ * statistics are read, so a window slides in steps of its length / buckets.
+ *
+ * Statistics (read), all values little endian:
+ *   <u8 version = 1>
+ *   3 x window (short, long, since boot):
+ *     <u32 length> <u32 covered>
+ *       Nominal length of the window in seconds (0 since boot) and the time actually covered,
+ *       shorter after boot and up to one bucket shorter than the length while it slides.
+ *     2 x channel (temperature, humidity):
+ *       <u32 count> <s16 min> <s16 max> <s16 mean> <u16 stddev>
+ *         In 0.01 °C / 0.01 %, the sample standard deviation, all 0 if count is 0.
+ *
+ * The 97 bytes exceed the default ATT MTU, a read at offset 0 takes a snapshot per connection
+ * the following read blob requests of that connection continue from.
+ */
+
+/**
+ * @brief Add a measurement to all windows.
+ *
+ * @param temperature Temperature in 0.01 °C.
+ * @param humidity Humidity in 0.01 %.
+ */
+void window_stats_svc_append(int16_t temperature, uint16_t humidity);
+
+#endif /* APP_WINDOW_STATS_SVC_H_ */
@@ -0,0 +1,269 @@
+"""Simulated benchmark of the native_sim build.
+
+Runs zephyr.exe against a Bumble virtual controller, drives it with BleClient
+and writes the results as JSON, keyed by the commit, so they can be tracked
+from commit to commit:
+
+    west build -b native_sim app -- -DEXTRA_CONF_FILE=benchmark.conf
+    python systemtest/benchmark.py --exe build/zephyr/zephyr.exe --output benchmark.json
+
+The history log is filled first by running the firmware with accelerated time
+(--rt-ratio) and without a central, then the firmware is restarted in real time
+for the measurements.
+"""
+
+import argparse
+import asyncio
+import json
+import logging
+import os
+import statistics
+import struct
+import subprocess
+import tempfile
+import time
+from datetime import datetime, timezone
+
+from bumble.core import UUID, AdvertisingData
+
+from ble_client import BleClient
+from native_sim_board import NativeSimBoard, VirtualController
+
+logger = logging.getLogger(__name__)
+
+SCHEMA_VERSION = 1
+DEVICE_NAME = "TBZ_SHAM_SENSOR"
+TEMPERATURE_CHARACTERISTIC = UUID.from_16_bits(0x2A6E)
+HISTORY_CTRL_CHARACTERISTIC = UUID("8b5a0001-6f4e-4c1b-9a3c-2f1e0d5a7b10")
+HISTORY_DATA_CHARACTERISTIC = UUID("8b5a0002-6f4e-4c1b-9a3c-2f1e0d5a7b10")
+HISTORY_OPCODE_START_INDEX = 0x01
+HISTORY_PACKET_COMPLETE = 0x02
+ATT_MTU = 247
+
+
+def git_commit():
+    try:
+        return subprocess.check_output(
+            ["git", "rev-parse", "HEAD"], text=True, stderr=subprocess.DEVNULL
+        ).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def ms(seconds):
+    return round(seconds * 1000, 3)
+
+
+def fill_history(args, controller, flash_file):
+    """Let the firmware log measurements with accelerated time."""
+    controller.start()
+    board = NativeSimBoard(
+        args.exe,
+        controller.firmware_bt_dev,
+        flash_file,
+        extra_args=[
+            f"--rt-ratio={args.fill_rt_ratio}",
+            f"-stop_at={args.history_fill_s}",
+        ],
+    )
+    try:
+        board.wait_for_exit(args.history_fill_s / args.fill_rt_ratio + 60)
+    finally:
+        board.close()
+        controller.stop()
+
+
+async def wait_for(predicate, timeout_s, what):
+    deadline = time.monotonic() + timeout_s
+    while not predicate():
+        if time.monotonic() > deadline:
+            raise RuntimeError(f"Timeout waiting for {what}")
+        await asyncio.sleep(0.01)
+
+
+async def measure(args, controller, flash_file):
+    metrics = {}
+    found = {}
+    notifications = []
+    reconnect_notifications = []
+    history = {"bytes": 0, "packets": 0, "complete": None}
+
+    def on_advertisement(advertisement):
+        if found:
+            return
+        name = advertisement.data.get(AdvertisingData.COMPLETE_LOCAL_NAME)
+        if str(name) == DEVICE_NAME:
+            found["time"] = time.monotonic()
+            found["address"] = advertisement.address
+
+    def on_temperature(value):
+        notifications.append(time.monotonic())
+
+    def on_reconnect_temperature(value):
+        reconnect_notifications.append(time.monotonic())
+
+    def on_history(value):
+        history["bytes"] += len(value)
+        history["packets"] += 1
+        if value[0] == HISTORY_PACKET_COMPLETE:
+            history["complete"] = (time.monotonic(), value)
+
+    controller.start()
+    client = BleClient(controller.client_transport)
+    board = None
+    try:
+        await client.initialize()
+        await client.register_listener_callback("advertisement", on_advertisement)
+        await client.start_scanning()
+
+        # Boot to advertising, seen by the central and in the log
+        board = NativeSimBoard(args.exe, controller.firmware_bt_dev, flash_file)
+        await wait_for(lambda: found, args.timeout_s, "advertising")
+        await client.stop_scanning()
+        metrics["boot_to_adv_ms"] = ms(found["time"] - board.start_time)
+        await asyncio.to_thread(
+            board.wait_for_regex_in_line,
+            r"Advertising successfully started",
+            args.timeout_s,
+            args.verbose,
+        )
+        metrics["boot_to_adv_log_ms"] = ms(board.last_match_time - board.start_time)
+
+        # Connect to the first notification
+        connect_time = time.monotonic()
+        await client.connect(found["address"])
+        await client.discover_services()
+        await client.subscribe_to_characteristics(
+            TEMPERATURE_CHARACTERISTIC, on_temperature
+        )
+        await wait_for(
+            lambda: len(notifications) > args.notifications,
+            args.timeout_s + args.notifications * args.period_s,
+            "notifications",
+        )
+        metrics["connect_to_first_notification_ms"] = ms(
+            notifications[0] - connect_time
+        )
+
+        # Notification jitter against the configured period
+        intervals = [b - a for a, b in zip(notifications, notifications[1:])]
+        deviations = [interval - args.period_s for interval in intervals]
+        metrics["notification_count"] = len(intervals)
+        metrics["notification_interval_mean_ms"] = ms(statistics.mean(intervals))
+        metrics["notification_jitter_stdev_ms"] = ms(statistics.pstdev(intervals))
+        metrics["notification_jitter_max_ms"] = ms(max(abs(d) for d in deviations))
+
+        # History download throughput, from the start request to the completion record
+        metrics["att_mtu"] = await client.request_mtu(ATT_MTU)
+        await client.subscribe_to_characteristics(
+            HISTORY_DATA_CHARACTERISTIC, on_history
+        )
+        start_time = time.monotonic()
+        await client.write_characteristic(
+            HISTORY_CTRL_CHARACTERISTIC,
+            struct.pack("<BI", HISTORY_OPCODE_START_INDEX, 0),
+        )
+        await wait_for(lambda: history["complete"], args.timeout_s, "history download")
+        end_time, complete = history["complete"]
+        count = struct.unpack_from("<I", complete, 5)[0]
+        duration = end_time - start_time
+        metrics["history_samples"] = count
+        metrics["history_bytes"] = history["bytes"]
+        metrics["history_packets"] = history["packets"]
+        metrics["history_download_ms"] = ms(duration)
+        metrics["history_throughput_bytes_per_s"] = round(history["bytes"] / duration)
+        metrics["history_throughput_samples_per_s"] = round(count / duration)
+
+        # Reconnect of the bonded central to its first notification, from the stored CCC
+        temperature_handle = client.characteristic_handle(TEMPERATURE_CHARACTERISTIC)
+        await client.pair()
+        await client.disconnect()
+        await asyncio.to_thread(
+            board.wait_for_regex_in_line,
+            r"EVENT_BLE_NOT_CONNECTED",
+            args.timeout_s,
+            args.verbose,
+        )
+        connect_time = time.monotonic()
+        await client.connect(found["address"])
+        await client.listen_to_handle(temperature_handle, on_reconnect_temperature)
+        await client.encrypt()
+        await wait_for(
+            lambda: reconnect_notifications, args.timeout_s, "notification on reconnect"
+        )
+        metrics["reconnect_to_first_notification_ms"] = ms(
+            reconnect_notifications[0] - connect_time
+        )
+    finally:
+        await client.disconnect()
+        await client.close()
+        if board:
+            board.close()
+        controller.stop()
+
+    return metrics
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--exe", required=True, help="native_sim zephyr.exe")
+    parser.add_argument("--output", help="JSON result file (default: stdout only)")
+    parser.add_argument(
+        "--period-s",
+        type=float,
+        default=2,
+        help="CONFIG_MEASURING_PERIOD_SECONDS of the build (default: 2, benchmark.conf)",
+    )
+    parser.add_argument(
+        "--notifications",
+        type=int,
+        default=20,
+        help="Notification intervals measured for the jitter (default: 20)",
+    )
+    parser.add_argument(
+        "--history-fill-s",
+        type=int,
+        default=3600,
+        help="Simulated seconds of measurements logged before the run (default: 3600)",
+    )
+    parser.add_argument(
+        "--fill-rt-ratio",
+        type=int,
+        default=100,
+        help="Simulated time per real time while filling the log (default: 100)",
+    )
+    parser.add_argument("--timeout-s", type=float, default=30)
+    parser.add_argument("--verbose", action="store_true", help="Print the device log")
+    args = parser.parse_args()
+
+    logging.basicConfig(level=logging.INFO)
+
+    controller = VirtualController()
+    with tempfile.TemporaryDirectory() as tmp:
+        flash_file = os.path.join(tmp, "flash.bin")
+        if args.history_fill_s > 0:
+            fill_history(args, controller, flash_file)
+        metrics = await measure(args, controller, flash_file)
+
+    result = {
+        "schema": SCHEMA_VERSION,
+        "commit": os.environ.get("GITHUB_SHA") or git_commit(),
+        "date": datetime.now(timezone.utc).isoformat(),
+        "board": "native_sim",
+        "config": {
+            "period_s": args.period_s,
+            "notifications": args.notifications,
+            "history_fill_s": args.history_fill_s,
+        },
+        "metrics": metrics,
+    }
+
+    text = json.dumps(result, indent=2)
+    print(text)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
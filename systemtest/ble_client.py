@@ -2,6 +2,8 @@ import logging
 from bumble.device import Device, Peer
 from bumble.hci import Address
 from bumble.gatt import show_services
+from bumble.keys import MemoryKeyStore
+from bumble.pairing import PairingConfig
 from bumble.transport import open_transport_or_link
 
 logging.basicConfig(
@@ -10,12 +12,12 @@ logging.basicConfig(
 logger = logging.getLogger(__name__)
 
 
-async def initialize_bluetooth_device(transport_type):
+async def initialize_bluetooth_device(transport_type, address):
     """Initialize and return a Bluetooth device."""
     hci_transport = await open_transport_or_link(transport_type)
     hci_device = Device.with_hci(
         "Bumble",
-        Address("F0:F1:F2:F3:F4:F5"),
+        Address(address),
         hci_transport.source,
         hci_transport.sink,
     )
@@ -24,9 +26,10 @@ async def initialize_bluetooth_device(transport_type):
 
 
 class BleClient:
-    def __init__(self, transport_type):
+    def __init__(self, transport_type, address="F0:F1:F2:F3:F4:F5"):
         self.device = None
         self.transport_type = transport_type
+        self.address = address
         self.hci_transport = None
         self.connection = None
         self.peer = None
@@ -35,7 +38,7 @@ class BleClient:
     async def initialize(self):
         """Initialize the BLE client with a Bluetooth device."""
         self.device, self.hci_transport = await initialize_bluetooth_device(
-            self.transport_type
+            self.transport_type, self.address
         )
         return self.device
 
@@ -89,6 +92,20 @@ class BleClient:
                     return await characteristic.read_value()
         raise RuntimeError("Characteristic not found")
 
+    async def write_characteristic(self, characteristic_uuid, value):
+        """Write data to a specific characteristic, with response."""
+        for service in self.services:
+            for characteristic in service.characteristics:
+                if characteristic.uuid == characteristic_uuid:
+                    return await characteristic.write_value(value, True)
+        raise RuntimeError("Characteristic not found")
+
+    async def request_mtu(self, mtu):
+        """Exchange the ATT MTU, returns the negotiated value."""
+        if not self.peer:
+            raise RuntimeError("Services not discovered")
+        return await self.peer.request_mtu(mtu)
+
     async def subscribe_to_characteristics(
         self, characteristic_uuid, notification_handler
     ):
@@ -98,6 +115,44 @@ class BleClient:
                 if characteristic.uuid == characteristic_uuid:
                     await characteristic.subscribe(notification_handler, True)
 
+    async def listen_to_characteristic(self, characteristic_uuid, handler):
+        """Receive notifications of a characteristic without enabling them."""
+        handle = self.characteristic_handle(characteristic_uuid)
+        await self.listen_to_handle(handle, handler)
+
+    def characteristic_handle(self, characteristic_uuid):
+        """Value handle of a discovered characteristic."""
+        for service in self.services:
+            for characteristic in service.characteristics:
+                if characteristic.uuid == characteristic_uuid:
+                    return characteristic.handle
+        raise RuntimeError("Characteristic not found")
+
+    async def listen_to_handle(self, handle, handler):
+        """Receive notifications of a handle, also before services are discovered."""
+        subscribers = self.connection.gatt_client.notification_subscribers
+        subscribers.setdefault(handle, set()).add(handler)
+
+    async def pair(self):
+        """Pair and bond without user interaction (Just Works)."""
+        if not self.connection:
+            raise RuntimeError("Device not connected")
+        if self.device.keystore is None:
+            self.device.keystore = MemoryKeyStore()
+        self.device.pairing_config_factory = lambda connection: PairingConfig(
+            sc=True, mitm=False, bonding=True
+        )
+        await self.connection.pair()
+        logger.info("=== Paired")
+
+    async def encrypt(self):
+        """Encrypt the link with the keys of an earlier bond."""
+        if not self.connection:
+            raise RuntimeError("Device not connected")
+        if not self.connection.is_encrypted:
+            await self.connection.encrypt()
+        logger.info("=== Encrypted")
+
     async def disconnect(self):
         if self.connection:
             try:
@@ -1,21 +1,32 @@
 import serial
 import re
 
+from collections import deque
 from time import time
 
 from pynrfjprog import LowLevel
 
+from log_decoder import DictionaryLogDecoder
+
 
 class BOARD:
-    def __init__(self, port, baud, fw_image):
+    def __init__(self, port, baud, fw_image, log_dictionary=None):
         self.port = port
         self.baud = baud
         self.fw_image = fw_image
+        self.decoder = None
+        self.decoded_lines = deque()
 
         self.program(fw_image)
 
         self.serial_device = serial.Serial(port, self.baud, timeout=1, write_timeout=1)
 
+        if log_dictionary:
+            # The stream is only decodable from its separator on, which is sent at boot
+            self.decoder = DictionaryLogDecoder(log_dictionary)
+            self.serial_device.reset_input_buffer()
+            self.hard_reset()
+
     def program(self, fw_image):
         with LowLevel.API() as api:
             api.connect_to_emu_without_snr()
@@ -33,15 +44,25 @@ class BOARD:
             api.go()
             api.close()
 
-    def wait_for_regex_in_line(self, regex, timeout_s=500, log=True):
-        start_time = time()
-        while True:
+    def read_line(self, timeout_s):
+        if self.decoder is None:
             self.serial_device.timeout = timeout_s
-            line = (
+            return (
                 self.serial_device.read_until()
                 .decode("utf-8", errors="replace")
                 .replace("\r\n", "")
             )
+
+        if not self.decoded_lines:
+            self.serial_device.timeout = min(timeout_s, 1)
+            chunk = self.serial_device.read(max(self.serial_device.in_waiting, 1))
+            self.decoded_lines.extend(self.decoder.feed(chunk))
+        return self.decoded_lines.popleft() if self.decoded_lines else ""
+
+    def wait_for_regex_in_line(self, regex, timeout_s=500, log=True):
+        start_time = time()
+        while True:
+            line = self.read_line(timeout_s)
             if line != "" and log:
                 print(line)
             if time() - start_time > timeout_s:
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Gateway of the simulated fleet. It scans for the sensors during a fixed discovery window,
+ * then connects to them one by one, subscribes to their temperature notifications and counts
+ * them during the observation window. Per sensor one "FLEET" line is printed at the end, which
+ * systemtest/bsim/fleet.py turns into the fleet statistics.
+ */
+
+#include <string.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+
+#define SENSOR_NAME          "TBZ_SHAM_SENSOR"
+#define MAX_SENSORS          CONFIG_BT_MAX_CONN
+#define DISCOVERY_WINDOW_MS  (30 * MSEC_PER_SEC)
+#define OBSERVATION_MS       (5 * 60 * MSEC_PER_SEC)
+#define CONNECT_TIMEOUT_MS   (5 * MSEC_PER_SEC)
+#define MAX_CONNECT_ATTEMPTS 3
+
+/* The fixed 1 s connection interval of the sensors, 4 s supervision timeout */
+#define CONN_PARAM BT_LE_CONN_PARAM(800, 800, 0, 400)
+
+struct sensor {
+	bt_addr_le_t addr;
+	struct bt_conn *conn;
+	uint32_t discovered_ms;
+	uint32_t connect_ms; /* Create connection until connected, last attempt */
+	uint32_t connected_ms;
+	uint32_t subscribed_ms;
+	uint32_t notifications;
+	uint32_t disconnects;
+	uint8_t attempts;
+	struct bt_gatt_discover_params discover_params;
+	struct bt_gatt_discover_params ccc_discover_params;
+	struct bt_gatt_subscribe_params subscribe_params;
+};
+
+/* Only modified from the Bluetooth RX thread and the main thread while it waits on connected */
+static struct sensor sensors[MAX_SENSORS];
+static size_t sensor_count;
+static bool discovery_done;
+
+static K_SEM_DEFINE(connected_sem, 0, 1);
+
+static struct sensor *sensor_by_conn(const struct bt_conn *conn)
+{
+	for (size_t i = 0; i < sensor_count; i++) {
+		if (sensors[i].conn == conn) {
+			return &sensors[i];
+		}
+	}
+
+	return NULL;
+}
+
+static bool name_matches(struct bt_data *data, void *user_data)
+{
+	bool *found = user_data;
+
+	if (data->type == BT_DATA_NAME_COMPLETE && data->data_len == strlen(SENSOR_NAME) &&
+	    memcmp(data->data, SENSOR_NAME, data->data_len) == 0) {
+		*found = true;
+		return false;
+	}
+
+	return true;
+}
+
+static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
+			 struct net_buf_simple *ad)
+{
+	bool found = false;
+
+	ARG_UNUSED(rssi);
+
+	if (discovery_done || type != BT_GAP_ADV_TYPE_ADV_IND || sensor_count == MAX_SENSORS) {
+		return;
+	}
+
+	for (size_t i = 0; i < sensor_count; i++) {
+		if (bt_addr_le_eq(&sensors[i].addr, addr)) {
+			return;
+		}
+	}
+
+	bt_data_parse(ad, name_matches, &found);
+	if (!found) {
+		return;
+	}
+
+	bt_addr_le_copy(&sensors[sensor_count].addr, addr);
+	sensors[sensor_count].discovered_ms = k_uptime_get_32();
+	sensor_count++;
+}
+
+static uint8_t notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+			 const void *data, uint16_t length)
+{
+	struct sensor *sensor = CONTAINER_OF(params, struct sensor, subscribe_params);
+
+	ARG_UNUSED(conn);
+	ARG_UNUSED(length);
+
+	if (data == NULL) {
+		/* Unsubscribed, e.g. by a disconnect */
+		params->value_handle = 0;
+		return BT_GATT_ITER_STOP;
+	}
+
+	sensor->notifications++;
+
+	return BT_GATT_ITER_CONTINUE;
+}
+
+static void subscribe_cb(struct bt_conn *conn, uint8_t err, struct bt_gatt_subscribe_params *params)
+{
+	struct sensor *sensor = CONTAINER_OF(params, struct sensor, subscribe_params);
+
+	ARG_UNUSED(conn);
+
+	if (err == 0 && sensor->subscribed_ms == 0) {
+		sensor->subscribed_ms = k_uptime_get_32();
+	}
+}
+
+static uint8_t discover_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+			   struct bt_gatt_discover_params *params)
+{
+	struct sensor *sensor = CONTAINER_OF(params, struct sensor, discover_params);
+	struct bt_gatt_subscribe_params *sub = &sensor->subscribe_params;
+	int ret;
+
+	if (attr == NULL) {
+		printk("Temperature characteristic not found\n");
+		return BT_GATT_ITER_STOP;
+	}
+
+	memset(sub, 0, sizeof(*sub));
+	sub->notify = notify_cb;
+	sub->subscribe = subscribe_cb;
+	sub->value = BT_GATT_CCC_NOTIFY;
+	sub->value_handle = bt_gatt_attr_value_handle(attr);
+	sub->ccc_handle = BT_GATT_AUTO_DISCOVER_CCC_HANDLE;
+	sub->end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	sub->disc_params = &sensor->ccc_discover_params;
+
+	ret = bt_gatt_subscribe(conn, sub);
+	if (ret != 0) {
+		printk("Subscribe failed: %d\n", ret);
+	}
+
+	return BT_GATT_ITER_STOP;
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+	struct sensor *sensor = sensor_by_conn(conn);
+	struct bt_gatt_discover_params *params;
+	int ret;
+
+	if (sensor == NULL) {
+		return;
+	}
+
+	if (err != 0) {
+		bt_conn_unref(sensor->conn);
+		sensor->conn = NULL;
+		k_sem_give(&connected_sem);
+		return;
+	}
+
+	sensor->connected_ms = k_uptime_get_32();
+	k_sem_give(&connected_sem);
+
+	/* Subscribing runs in the background, while the next sensor is connected */
+	params = &sensor->discover_params;
+	memset(params, 0, sizeof(*params));
+	params->uuid = BT_UUID_TEMPERATURE;
+	params->func = discover_cb;
+	params->start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+	params->end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+	params->type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+	ret = bt_gatt_discover(conn, params);
+	if (ret != 0) {
+		printk("Discovery failed: %d\n", ret);
+	}
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	struct sensor *sensor = sensor_by_conn(conn);
+
+	ARG_UNUSED(reason);
+
+	if (sensor == NULL) {
+		return;
+	}
+
+	sensor->disconnects++;
+	bt_conn_unref(sensor->conn);
+	sensor->conn = NULL;
+}
+
+BT_CONN_CB_DEFINE(conn_callbacks) = {
+	.connected = connected,
+	.disconnected = disconnected,
+};
+
+static void connect_sensor(struct sensor *sensor)
+{
+	uint32_t start;
+	int ret;
+
+	while (sensor->connected_ms == 0 && sensor->attempts < MAX_CONNECT_ATTEMPTS) {
+		sensor->attempts++;
+		start = k_uptime_get_32();
+
+		ret = bt_conn_le_create(&sensor->addr, BT_CONN_LE_CREATE_CONN, CONN_PARAM,
+					&sensor->conn);
+		if (ret != 0) {
+			printk("Create connection failed: %d\n", ret);
+			continue;
+		}
+
+		if (k_sem_take(&connected_sem, K_MSEC(CONNECT_TIMEOUT_MS)) != 0) {
+			/* The controller gave up without reporting, cancel the attempt */
+			bt_conn_disconnect(sensor->conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+			k_sem_take(&connected_sem, K_MSEC(CONNECT_TIMEOUT_MS));
+		}
+
+		sensor->connect_ms = k_uptime_get_32() - start;
+	}
+}
+
+int main(void)
+{
+	char addr[BT_ADDR_LE_STR_LEN];
+	int ret;
+
+	ret = bt_enable(NULL);
+	if (ret != 0) {
+		printk("Bluetooth init failed: %d\n", ret);
+		return ret;
+	}
+
+	ret = bt_le_scan_start(BT_LE_SCAN_PASSIVE, device_found);
+	if (ret != 0) {
+		printk("Scanning failed to start: %d\n", ret);
+		return ret;
+	}
+
+	k_sleep(K_MSEC(DISCOVERY_WINDOW_MS));
+	discovery_done = true;
+	bt_le_scan_stop();
+
+	for (size_t i = 0; i < sensor_count; i++) {
+		connect_sensor(&sensors[i]);
+	}
+
+	k_sleep(K_MSEC(OBSERVATION_MS));
+
+	for (size_t i = 0; i < sensor_count; i++) {
+		struct sensor *sensor = &sensors[i];
+
+		bt_addr_le_to_str(&sensor->addr, addr, sizeof(addr));
+		printk("FLEET sensor=%zu addr=%s discovered_ms=%u attempts=%u connected=%u "
+		       "connect_ms=%u connected_ms=%u subscribed_ms=%u notifications=%u "
+		       "disconnects=%u\n",
+		       i, addr, sensor->discovered_ms, sensor->attempts,
+		       sensor->connected_ms != 0, sensor->connect_ms, sensor->connected_ms,
+		       sensor->subscribed_ms, sensor->notifications, sensor->disconnects);
+	}
+
+	printk("FLEET done sensors=%zu end_ms=%u\n", sensor_count, k_uptime_get_32());
+
+	return 0;
+}
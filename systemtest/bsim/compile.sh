@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# Copyright (c) 2025 Tareq Mhisen
+#
+# Builds the sensor firmware and the fleet central for nrf52_bsim, and the
+# sensor with periodic advertising and its observer, and installs them in
+# ${BSIM_OUT_PATH}/bin, where fleet.py and periodic.py expect them.
+
+set -e
+
+: "${BSIM_OUT_PATH:?must point to the BabbleSim installation}"
+: "${BSIM_COMPONENTS_PATH:?must point to the BabbleSim components}"
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+APP_DIR="${SCRIPT_DIR}/../../app"
+BUILD_DIR="${BUILD_DIR:-${SCRIPT_DIR}/build}"
+
+# The sensor images take their identity from the simulated device number
+SENSOR_CONF="${SCRIPT_DIR}/sensor.conf"
+
+west build -p always -b nrf52_bsim -d "${BUILD_DIR}/sensor" "${APP_DIR}" \
+	-- -DEXTRA_CONF_FILE="${SENSOR_CONF}"
+west build -p always -b nrf52_bsim -d "${BUILD_DIR}/central" "${SCRIPT_DIR}/central"
+west build -p always -b nrf52_bsim -d "${BUILD_DIR}/periodic_sensor" "${APP_DIR}" \
+	-- -DEXTRA_CONF_FILE="periodic_adv.conf;${SENSOR_CONF}"
+west build -p always -b nrf52_bsim -d "${BUILD_DIR}/observer" "${SCRIPT_DIR}/observer"
+
+cp "${BUILD_DIR}/sensor/zephyr/zephyr.exe" "${BSIM_OUT_PATH}/bin/bs_nrf52_bsim_fleet_sensor"
+cp "${BUILD_DIR}/central/zephyr/zephyr.exe" "${BSIM_OUT_PATH}/bin/bs_nrf52_bsim_fleet_central"
+cp "${BUILD_DIR}/periodic_sensor/zephyr/zephyr.exe" \
+	"${BSIM_OUT_PATH}/bin/bs_nrf52_bsim_periodic_sensor"
+cp "${BUILD_DIR}/observer/zephyr/zephyr.exe" "${BSIM_OUT_PATH}/bin/bs_nrf52_bsim_periodic_observer"
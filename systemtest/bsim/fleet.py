@@ -0,0 +1,236 @@
+"""BabbleSim fleet scenario: N sensors against one scanning central.
+
+Runs the simulation for every fleet size, parses the per-sensor report of the
+central and writes the fleet statistics as JSON:
+
+    ./compile.sh
+    python fleet.py --sizes 1,2,5,10,20,30,40,50 --output fleet.json
+
+Device 0 is the central, devices 1..N run the sensor firmware. The sensors take
+their static address from the device number, so every node has its own
+identity, and every device gets its own random seed.
+"""
+
+import argparse
+import json
+import os
+import re
+import statistics
+import subprocess
+import sys
+from datetime import datetime, timezone
+
+SCHEMA_VERSION = 1
+SENSOR_EXE = "bs_nrf52_bsim_fleet_sensor"
+CENTRAL_EXE = "bs_nrf52_bsim_fleet_central"
+PHY_EXE = "bs_2G4_phy_v1"
+
+# Schedule of the central, see central/src/main.c
+DISCOVERY_WINDOW_S = 30
+OBSERVATION_S = 5 * 60
+CONNECT_TIMEOUT_S = 5
+MAX_CONNECT_ATTEMPTS = 3
+
+FLEET_LINE = re.compile(r"FLEET (sensor=.*)")
+FIELD = re.compile(r"(\w+)=(\S+)")
+
+
+def percentile(values, fraction):
+    if not values:
+        return None
+    values = sorted(values)
+    return values[min(len(values) - 1, int(fraction * len(values)))]
+
+
+def distribution(values):
+    if not values:
+        return None
+    return {
+        "min": min(values),
+        "p50": percentile(values, 0.5),
+        "p90": percentile(values, 0.9),
+        "max": max(values),
+        "mean": round(statistics.mean(values), 1),
+    }
+
+
+def expected_notifications(sensor, end_ms, period_ms, first_delay_ms):
+    """Notifications due after subscribing, the first one comes first_delay_ms
+    after connecting, then one per period."""
+    if not sensor["subscribed_ms"]:
+        return 0
+    due = sensor["connected_ms"] + first_delay_ms
+    if due < sensor["subscribed_ms"]:
+        skipped = -(-(sensor["subscribed_ms"] - due) // period_ms)
+        due += skipped * period_ms
+    if due >= end_ms:
+        return 0
+    return (end_ms - due - 1) // period_ms + 1
+
+
+def run_fleet(args, size):
+    bin_dir = os.path.join(args.bsim_out_path, "bin")
+    sim_id = f"fleet_{size}"
+    # Central schedule plus every connection attempt timing out, in microseconds
+    sim_length_s = (
+        DISCOVERY_WINDOW_S
+        + size * MAX_CONNECT_ATTEMPTS * CONNECT_TIMEOUT_S
+        + OBSERVATION_S
+        + 10
+    )
+
+    common = [f"-s={sim_id}"]
+    central = subprocess.Popen(
+        [os.path.join(bin_dir, CENTRAL_EXE), *common, "-d=0", f"-rs={args.seed}"],
+        cwd=bin_dir,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        text=True,
+    )
+    others = [
+        subprocess.Popen(
+            [
+                os.path.join(bin_dir, SENSOR_EXE),
+                *common,
+                f"-d={device}",
+                f"-rs={args.seed + device}",
+            ],
+            cwd=bin_dir,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+        for device in range(1, size + 1)
+    ]
+    others.append(
+        subprocess.Popen(
+            [
+                os.path.join(bin_dir, PHY_EXE),
+                *common,
+                f"-D={size + 1}",
+                f"-sim_length={sim_length_s * 1000000}",
+            ],
+            cwd=bin_dir,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+    )
+
+    output, _ = central.communicate()
+    for process in others:
+        process.wait()
+
+    sensors = []
+    end_ms = None
+    for line in output.splitlines():
+        if args.verbose:
+            print(line)
+        match = FLEET_LINE.search(line)
+        if match:
+            fields = dict(FIELD.findall(match.group(1)))
+            sensors.append(
+                {k: v if k == "addr" else int(v) for k, v in fields.items()}
+            )
+        elif "FLEET done" in line:
+            end_ms = int(dict(FIELD.findall(line))["end_ms"])
+
+    if end_ms is None:
+        raise RuntimeError(f"Fleet of {size}: central did not finish")
+
+    return summarize(args, size, sensors, end_ms)
+
+
+def summarize(args, size, sensors, end_ms):
+    connected = [s for s in sensors if s["connected"]]
+    expected = sum(
+        expected_notifications(
+            s, end_ms, args.period_s * 1000, args.first_delay_s * 1000
+        )
+        for s in connected
+    )
+    received = sum(s["notifications"] for s in connected)
+
+    return {
+        "sensors": size,
+        "discovered": len(sensors),
+        "discovery_rate": round(len(sensors) / size, 3),
+        "discovery_ms": distribution([s["discovered_ms"] for s in sensors]),
+        "connection_success_rate": round(len(connected) / size, 3),
+        "connect_attempts_mean": (
+            round(statistics.mean(s["attempts"] for s in sensors), 2)
+            if sensors
+            else None
+        ),
+        "connect_ms": distribution([s["connect_ms"] for s in connected]),
+        "disconnects": sum(s["disconnects"] for s in sensors),
+        "notifications_expected": expected,
+        "notifications_received": received,
+        "notification_delivery_rate": (
+            round(min(received, expected) / expected, 3) if expected else None
+        ),
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument(
+        "--sizes",
+        default="1,2,5,10,20,30,40,50",
+        help="Comma separated fleet sizes (default: 1,2,5,10,20,30,40,50)",
+    )
+    parser.add_argument("--bsim-out-path", default=os.environ.get("BSIM_OUT_PATH"))
+    parser.add_argument("--seed", type=int, default=1000)
+    parser.add_argument(
+        "--period-s",
+        type=int,
+        default=30,
+        help="CONFIG_MEASURING_PERIOD_SECONDS of the sensors (default: 30)",
+    )
+    parser.add_argument(
+        "--first-delay-s",
+        type=int,
+        default=10,
+        help="CONFIG_FIRST_MEASUREMENT_DELAY_SECONDS of the sensors (default: 10)",
+    )
+    parser.add_argument(
+        "--min-discovery-rate",
+        type=float,
+        help="Exit with 1 if a fleet discovers a smaller share of its sensors",
+    )
+    parser.add_argument("--output", help="JSON result file (default: stdout only)")
+    parser.add_argument("--verbose", action="store_true", help="Print the central log")
+    args = parser.parse_args()
+
+    if not args.bsim_out_path:
+        parser.error("--bsim-out-path or BSIM_OUT_PATH is required")
+
+    results = []
+    for size in (int(s) for s in args.sizes.split(",")):
+        result = run_fleet(args, size)
+        print(json.dumps(result))
+        results.append(result)
+
+    text = json.dumps(
+        {
+            "schema": SCHEMA_VERSION,
+            "date": datetime.now(timezone.utc).isoformat(),
+            "board": "nrf52_bsim",
+            "seed": args.seed,
+            "fleets": results,
+        },
+        indent=2,
+    )
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+    # Sensors sharing an identity address are discovered as one
+    if args.min_discovery_rate is not None and any(
+        result["discovery_rate"] < args.min_discovery_rate for result in results
+    ):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
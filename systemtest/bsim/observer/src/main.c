@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Gateway receiving the readings of a sensor without connecting. It scans until it finds the
+ * extended advertisements announcing the periodic train of the sensor, syncs to the train, stops
+ * scanning and counts the periodic reports and the readings they carry during the observation
+ * window. A "PERADV" line is printed per new reading and at the end, which
+ * systemtest/bsim/periodic.py turns into the sync statistics.
+ */
+
+#include <string.h>
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
+
+#define SENSOR_NAME       "TBZ_SHAM_SENSOR"
+#define SYNC_WINDOW_MS    (60 * MSEC_PER_SEC)
+#define OBSERVATION_MS    (5 * 60 * MSEC_PER_SEC)
+/* Sync is lost after missing the train for 10 s, in 10 ms units */
+#define SYNC_TIMEOUT      1000
+/* Manufacturer specific data of the sensor: company, temperature, humidity, seq */
+#define READINGS_DATA_LEN 7
+
+struct observer {
+	struct bt_le_per_adv_sync *sync;
+	bool sync_pending;
+	uint32_t synced_ms;
+	uint32_t interval_ms;
+	uint32_t reports;
+	uint32_t updates;
+	uint32_t lost;
+	uint32_t terminations;
+	bool have_seq;
+	uint8_t seq;
+};
+
+/* Only modified from the Bluetooth RX thread, read by the main thread at the end */
+static struct observer observer;
+
+static K_SEM_DEFINE(synced_sem, 0, 1);
+
+static bool name_matches(struct bt_data *data, void *user_data)
+{
+	bool *found = user_data;
+
+	if (data->type == BT_DATA_NAME_COMPLETE && data->data_len == strlen(SENSOR_NAME) &&
+	    memcmp(data->data, SENSOR_NAME, data->data_len) == 0) {
+		*found = true;
+		return false;
+	}
+
+	return true;
+}
+
+static void scan_recv(const struct bt_le_scan_recv_info *info, struct net_buf_simple *buf)
+{
+	struct bt_le_per_adv_sync_param param = {0};
+	bool found = false;
+	int ret;
+
+	/* Only the extended advertisements of the train carry a periodic interval */
+	if (info->interval == 0 || observer.sync != NULL || observer.sync_pending) {
+		return;
+	}
+
+	bt_data_parse(buf, name_matches, &found);
+	if (!found) {
+		return;
+	}
+
+	bt_addr_le_copy(&param.addr, info->addr);
+	param.sid = info->sid;
+	param.timeout = SYNC_TIMEOUT;
+
+	ret = bt_le_per_adv_sync_create(&param, &observer.sync);
+	if (ret != 0) {
+		printk("Create sync failed: %d\n", ret);
+		return;
+	}
+
+	observer.sync_pending = true;
+}
+
+static struct bt_le_scan_cb scan_callbacks = {
+	.recv = scan_recv,
+};
+
+static void synced(struct bt_le_per_adv_sync *sync, struct bt_le_per_adv_sync_synced_info *info)
+{
+	ARG_UNUSED(sync);
+
+	observer.sync_pending = false;
+	observer.interval_ms = BT_GAP_PER_ADV_INTERVAL_TO_MS(info->interval);
+	if (observer.synced_ms == 0) {
+		observer.synced_ms = k_uptime_get_32();
+	}
+
+	k_sem_give(&synced_sem);
+}
+
+static void term(struct bt_le_per_adv_sync *sync, const struct bt_le_per_adv_sync_term_info *info)
+{
+	ARG_UNUSED(sync);
+
+	printk("Sync terminated: reason %u\n", info->reason);
+
+	/* Scanning is resumed by the main thread to sync again */
+	observer.sync = NULL;
+	observer.sync_pending = false;
+	observer.terminations++;
+}
+
+static bool readings_parse(struct bt_data *data, void *user_data)
+{
+	uint32_t now = k_uptime_get_32();
+	uint8_t seq;
+
+	ARG_UNUSED(user_data);
+
+	if (data->type != BT_DATA_MANUFACTURER_DATA || data->data_len != READINGS_DATA_LEN) {
+		return true;
+	}
+
+	seq = data->data[6];
+
+	if (!observer.have_seq) {
+		observer.have_seq = true;
+	} else if (seq == observer.seq) {
+		/* Repeated until the next measurement */
+		return false;
+	} else {
+		observer.lost += (uint8_t)(seq - observer.seq - 1);
+	}
+
+	observer.seq = seq;
+	observer.updates++;
+
+	printk("PERADV reading ms=%u seq=%u temperature=%d humidity=%u\n", now, seq,
+	       (int16_t)sys_get_le16(&data->data[2]), sys_get_le16(&data->data[4]));
+
+	return false;
+}
+
+static void recv(struct bt_le_per_adv_sync *sync,
+		 const struct bt_le_per_adv_sync_recv_info *info, struct net_buf_simple *buf)
+{
+	ARG_UNUSED(sync);
+	ARG_UNUSED(info);
+
+	observer.reports++;
+	bt_data_parse(buf, readings_parse, NULL);
+}
+
+static struct bt_le_per_adv_sync_cb sync_callbacks = {
+	.synced = synced,
+	.term = term,
+	.recv = recv,
+};
+
+int main(void)
+{
+	uint32_t end_ms;
+	int ret;
+
+	ret = bt_enable(NULL);
+	if (ret != 0) {
+		printk("Bluetooth init failed: %d\n", ret);
+		return ret;
+	}
+
+	bt_le_scan_cb_register(&scan_callbacks);
+	bt_le_per_adv_sync_cb_register(&sync_callbacks);
+
+	end_ms = k_uptime_get_32() + SYNC_WINDOW_MS + OBSERVATION_MS;
+
+	while (k_uptime_get_32() < end_ms) {
+		ret = bt_le_scan_start(BT_LE_SCAN_PASSIVE, NULL);
+		if (ret != 0) {
+			printk("Scanning failed to start: %d\n", ret);
+			return ret;
+		}
+
+		if (k_sem_take(&synced_sem, K_MSEC(end_ms - k_uptime_get_32())) != 0) {
+			bt_le_scan_stop();
+			break;
+		}
+
+		/* Synced, the train is received without scanning */
+		bt_le_scan_stop();
+
+		while (observer.sync != NULL && k_uptime_get_32() < end_ms) {
+			k_sleep(K_MSEC(100));
+		}
+	}
+
+	printk("PERADV done synced=%u synced_ms=%u interval_ms=%u reports=%u updates=%u lost=%u "
+	       "terminations=%u end_ms=%u\n",
+	       observer.synced_ms != 0, observer.synced_ms, observer.interval_ms, observer.reports,
+	       observer.updates, observer.lost, observer.terminations, k_uptime_get_32());
+
+	return 0;
+}
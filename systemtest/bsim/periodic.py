@@ -0,0 +1,156 @@
+"""BabbleSim periodic advertising scenario: one sensor, one syncing observer.
+
+Runs the sensor built with periodic_adv.conf next to an observer that syncs to
+its periodic advertising train instead of connecting, parses the report of the
+observer and writes the sync statistics as JSON:
+
+    ./compile.sh
+    python periodic.py --output periodic.json
+
+Device 0 is the observer, device 1 runs the sensor firmware. Exits non-zero if
+the observer never synced or received no reading.
+"""
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+from datetime import datetime, timezone
+
+SCHEMA_VERSION = 1
+SENSOR_EXE = "bs_nrf52_bsim_periodic_sensor"
+OBSERVER_EXE = "bs_nrf52_bsim_periodic_observer"
+PHY_EXE = "bs_2G4_phy_v1"
+
+# Schedule of the observer, see observer/src/main.c
+SYNC_WINDOW_S = 60
+OBSERVATION_S = 5 * 60
+
+READING_LINE = re.compile(r"PERADV reading (.*)")
+DONE_LINE = re.compile(r"PERADV done (.*)")
+FIELD = re.compile(r"(\w+)=(\S+)")
+
+
+def run(args):
+    bin_dir = os.path.join(args.bsim_out_path, "bin")
+    sim_length_s = SYNC_WINDOW_S + OBSERVATION_S + 10
+
+    common = ["-s=periodic"]
+    observer = subprocess.Popen(
+        [os.path.join(bin_dir, OBSERVER_EXE), *common, "-d=0", f"-rs={args.seed}"],
+        cwd=bin_dir,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT,
+        text=True,
+    )
+    others = [
+        subprocess.Popen(
+            [
+                os.path.join(bin_dir, SENSOR_EXE),
+                *common,
+                "-d=1",
+                f"-rs={args.seed + 1}",
+            ],
+            cwd=bin_dir,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        ),
+        subprocess.Popen(
+            [
+                os.path.join(bin_dir, PHY_EXE),
+                *common,
+                "-D=2",
+                f"-sim_length={sim_length_s * 1000000}",
+            ],
+            cwd=bin_dir,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        ),
+    ]
+
+    output, _ = observer.communicate()
+    for process in others:
+        process.wait()
+
+    readings = []
+    done = None
+    for line in output.splitlines():
+        if args.verbose:
+            print(line)
+        match = READING_LINE.search(line)
+        if match:
+            readings.append({k: int(v) for k, v in FIELD.findall(match.group(1))})
+            continue
+        match = DONE_LINE.search(line)
+        if match:
+            done = {k: int(v) for k, v in FIELD.findall(match.group(1))}
+
+    if done is None:
+        raise RuntimeError("Observer did not finish")
+
+    return summarize(args, done, readings)
+
+
+def summarize(args, done, readings):
+    observed_ms = done["end_ms"] - done["synced_ms"] if done["synced"] else 0
+    expected = observed_ms // (args.period_s * 1000)
+    gaps = [b["ms"] - a["ms"] for a, b in zip(readings, readings[1:])]
+
+    return {
+        "synced": bool(done["synced"]),
+        "sync_ms": done["synced_ms"] if done["synced"] else None,
+        "interval_ms": done["interval_ms"],
+        "reports": done["reports"],
+        "readings_received": done["updates"],
+        "readings_lost": done["lost"],
+        "readings_expected": expected,
+        "reading_delivery_rate": (
+            round(min(done["updates"], expected) / expected, 3) if expected else None
+        ),
+        "reading_gap_ms_max": max(gaps) if gaps else None,
+        "sync_terminations": done["terminations"],
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--bsim-out-path", default=os.environ.get("BSIM_OUT_PATH"))
+    parser.add_argument("--seed", type=int, default=1000)
+    parser.add_argument(
+        "--period-s",
+        type=int,
+        default=30,
+        help="CONFIG_MEASURING_PERIOD_SECONDS of the sensor (default: 30)",
+    )
+    parser.add_argument("--output", help="JSON result file (default: stdout only)")
+    parser.add_argument("--verbose", action="store_true", help="Print the observer log")
+    args = parser.parse_args()
+
+    if not args.bsim_out_path:
+        parser.error("--bsim-out-path or BSIM_OUT_PATH is required")
+
+    result = run(args)
+
+    text = json.dumps(
+        {
+            "schema": SCHEMA_VERSION,
+            "date": datetime.now(timezone.utc).isoformat(),
+            "board": "nrf52_bsim",
+            "seed": args.seed,
+            "periodic": result,
+        },
+        indent=2,
+    )
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    print(text)
+
+    if not result["synced"] or result["readings_received"] == 0:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -20,6 +20,21 @@ def pytest_addoption(parser):
         type=str,
         help="The USB transport interfaces with a local Bluetooth USB dongle",
     )
+    parser.addoption(
+        "--exe",
+        type=str,
+        help="zephyr.exe of a native_sim build, runs the simulated tests",
+    )
+    parser.addoption(
+        "--stack-analysis",
+        action="store_true",
+        help="The image has the thread analyzer (stack_analysis.conf)",
+    )
+    parser.addoption(
+        "--log-dictionary",
+        type=str,
+        help="log_dictionary.json of a dictionary_log.conf build, decodes the log",
+    )
 
 
 @pytest.fixture(scope="session")
@@ -43,6 +58,25 @@ def get_hci_transport_type(request):
 
 
 @pytest.fixture(scope="session")
-def get_board(get_port, get_baud, get_fw_image):
-    board = BOARD(get_port, get_baud, get_fw_image)
+def get_log_dictionary(request):
+    return request.config.getoption("--log-dictionary")
+
+
+@pytest.fixture(scope="session")
+def get_stack_analysis(request):
+    if not request.config.getoption("--stack-analysis"):
+        pytest.skip("Needs an image with stack_analysis.conf (--stack-analysis)")
+
+
+@pytest.fixture(scope="session")
+def get_exe(request):
+    exe = request.config.getoption("--exe")
+    if exe is None:
+        pytest.skip("Simulated test, needs a native_sim build (--exe)")
+    return exe
+
+
+@pytest.fixture(scope="session")
+def get_board(get_port, get_baud, get_fw_image, get_log_dictionary):
+    board = BOARD(get_port, get_baud, get_fw_image, get_log_dictionary)
     yield board
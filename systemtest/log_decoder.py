@@ -0,0 +1,117 @@
+"""Decode the dictionary log stream of the dictionary_log.conf build.
+
+The firmware sends the hex encoded log messages after the separator
+"##ZLOGV1##", the database build/app/zephyr/log_dictionary.json holds their
+format strings. Decoding uses the parser of the Zephyr tree, found through
+ZEPHYR_BASE.
+
+    python log_decoder.py build/app/zephyr/log_dictionary.json --port /dev/ttyUSB0
+    python log_decoder.py build/app/zephyr/log_dictionary.json --file capture.txt
+"""
+
+import argparse
+import contextlib
+import io
+import os
+import re
+import string
+import sys
+
+LOG_HEX_SEP = b"##ZLOGV1##"
+HEX_DIGITS = set(string.hexdigits.encode())
+ANSI_ESCAPE = re.compile(r"\x1b\[[0-9;]*m")
+
+
+def load_parser(database_path, zephyr_base=None):
+    zephyr_base = zephyr_base or os.environ.get("ZEPHYR_BASE")
+    if zephyr_base is None:
+        raise RuntimeError("ZEPHYR_BASE is not set")
+    sys.path.insert(0, os.path.join(zephyr_base, "scripts", "logging", "dictionary"))
+
+    import dictionary_parser
+    from dictionary_parser.log_database import LogDatabase
+
+    database = LogDatabase.read_json_database(database_path)
+    if database is None:
+        raise RuntimeError(f"Cannot read the log database {database_path}")
+    return dictionary_parser.get_parser(database)
+
+
+class DictionaryLogDecoder:
+    def __init__(self, database_path, zephyr_base=None):
+        self.parser = load_parser(database_path, zephyr_base)
+        self.synced = False
+        self.raw_tail = b""
+        self.hex_buffer = b""
+        self.data = b""
+
+    def feed(self, chunk):
+        """Feed raw serial data, return the decoded log lines."""
+        # Search the raw bytes, a separator may be split across reads
+        raw = self.raw_tail + chunk
+        self.raw_tail = raw[-(len(LOG_HEX_SEP) - 1) :]
+
+        # Skip the bootloader output, start over when the device was reset
+        idx = raw.rfind(LOG_HEX_SEP)
+        if idx >= 0:
+            chunk = raw[idx + len(LOG_HEX_SEP) :]
+            self.hex_buffer = b""
+            self.data = b""
+            self.synced = True
+        elif not self.synced:
+            return []
+
+        digits = self.hex_buffer + bytes(c for c in chunk if c in HEX_DIGITS)
+        pairs = len(digits) & ~1
+        self.data += bytes.fromhex(digits[:pairs].decode())
+        self.hex_buffer = digits[pairs:]
+
+        return self._parse()
+
+    def _parse(self):
+        if not self.data:
+            return []
+
+        output = io.StringIO()
+        with contextlib.redirect_stdout(output):
+            consumed = self.parser.parse_log_data(self.data)
+
+        # Newer parsers return the bytes consumed and keep a partial message
+        if isinstance(consumed, bool):
+            self.data = b""
+        else:
+            self.data = self.data[consumed:]
+
+        lines = ANSI_ESCAPE.sub("", output.getvalue()).splitlines()
+        return [line for line in lines if line.strip()]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("database", help="log_dictionary.json of the build")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--port", help="Serial port (eg: /dev/ttyUSB0)")
+    source.add_argument("--file", help="Captured serial output")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--zephyr-base", help="Zephyr tree (default: $ZEPHYR_BASE)")
+    args = parser.parse_args()
+
+    decoder = DictionaryLogDecoder(args.database, args.zephyr_base)
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            for line in decoder.feed(f.read()):
+                print(line)
+        return
+
+    import serial
+
+    with serial.Serial(args.port, args.baud, timeout=1) as serial_device:
+        while True:
+            chunk = serial_device.read(max(serial_device.in_waiting, 1))
+            for line in decoder.feed(chunk):
+                print(line, flush=True)
+
+
+if __name__ == "__main__":
+    main()
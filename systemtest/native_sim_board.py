@@ -0,0 +1,126 @@
+import queue
+import re
+import shutil
+import subprocess
+import threading
+import time
+
+
+class VirtualController:
+    """Bumble virtual controllers on one simulated link.
+
+    The firmware's HCI (Zephyr userchan, --bt-dev=<host>:<port>) connects to the
+    first TCP server, BleClient to the next ones ("tcp-client:<host>:<port>"), one
+    per client.
+    """
+
+    def __init__(self, firmware_port=9000, client_port=9001, client_count=1):
+        self.firmware_port = firmware_port
+        self.client_port = client_port
+        self.client_count = client_count
+        self.process = None
+
+    @property
+    def firmware_bt_dev(self):
+        return f"127.0.0.1:{self.firmware_port}"
+
+    @property
+    def client_transport(self):
+        return self.client_transport_of(0)
+
+    def client_transport_of(self, client):
+        return f"tcp-client:127.0.0.1:{self.client_port + client}"
+
+    def start(self):
+        client_servers = [
+            f"tcp-server:_:{self.client_port + client}"
+            for client in range(self.client_count)
+        ]
+        self.process = subprocess.Popen(
+            ["bumble-controllers", f"tcp-server:_:{self.firmware_port}"]
+            + client_servers,
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL,
+        )
+        # Give the servers time to listen before anything connects
+        time.sleep(1)
+
+    def stop(self):
+        if self.process:
+            self.process.terminate()
+            self.process.wait()
+            self.process = None
+
+
+class NativeSimBoard:
+    """Runs the native_sim build (zephyr.exe) behind the interface of BOARD.
+
+    Log lines are read from stdout and stamped with their arrival time
+    (time.monotonic()), so log events can be related to host-side events.
+    """
+
+    def __init__(self, exe, bt_dev, flash_file, extra_args=None):
+        self.exe = exe
+        self.bt_dev = bt_dev
+        self.flash_file = flash_file
+        self.extra_args = extra_args or []
+        self.process = None
+        self.lines = queue.Queue()
+        self.start_time = None
+        self.last_match_time = None
+
+        self.start()
+
+    def start(self):
+        args = [
+            self.exe,
+            f"--bt-dev={self.bt_dev}",
+            f"--flash={self.flash_file}",
+        ] + self.extra_args
+        # Line-buffer stdout, the log would otherwise arrive in blocks through the pipe
+        if shutil.which("stdbuf"):
+            args = ["stdbuf", "-oL"] + args
+
+        self.lines = queue.Queue()
+        self.start_time = time.monotonic()
+        self.process = subprocess.Popen(
+            args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT
+        )
+        threading.Thread(target=self._read_lines, daemon=True).start()
+
+    def _read_lines(self):
+        for raw in self.process.stdout:
+            line = raw.decode("utf-8", errors="replace").rstrip("\r\n")
+            self.lines.put((time.monotonic(), line))
+
+    def hard_reset(self):
+        self.stop()
+        self.start()
+
+    def wait_for_regex_in_line(self, regex, timeout_s=500, log=True):
+        start_time = time.monotonic()
+        while True:
+            remaining = timeout_s - (time.monotonic() - start_time)
+            if remaining <= 0:
+                raise RuntimeError("Timeout")
+            try:
+                stamp, line = self.lines.get(timeout=remaining)
+            except queue.Empty:
+                raise RuntimeError("Timeout")
+            if line != "" and log:
+                print(line)
+            regex_search = re.search(regex, line)
+            if regex_search:
+                self.last_match_time = stamp
+                return regex_search
+
+    def wait_for_exit(self, timeout_s):
+        return self.process.wait(timeout=timeout_s)
+
+    def stop(self):
+        if self.process and self.process.poll() is None:
+            self.process.terminate()
+            self.process.wait()
+
+    def close(self):
+        self.stop()
@@ -0,0 +1,57 @@
+"""Helpers of the tests against the native_sim build."""
+
+import asyncio
+import time
+
+from bumble.core import AdvertisingData
+
+from ble_client import BleClient
+from native_sim_board import NativeSimBoard, VirtualController
+
+DEVICE_NAME = "TBZ_SHAM_SENSOR"
+CENTRAL_ADDRESSES = ("F0:F1:F2:F3:F4:F5", "F0:F1:F2:F3:F4:F6")
+TIMEOUT_S = 30
+
+
+def start_simulation(exe, flash_file, client_count=1, extra_args=None):
+    """Start the virtual controller and zephyr.exe, returns both."""
+    controller = VirtualController(client_count=client_count)
+    controller.start()
+    board = NativeSimBoard(
+        exe, controller.firmware_bt_dev, flash_file, extra_args=extra_args
+    )
+    return controller, board
+
+
+async def wait_for(predicate, timeout_s, what):
+    deadline = time.monotonic() + timeout_s
+    while not predicate():
+        if time.monotonic() > deadline:
+            raise RuntimeError(f"Timeout waiting for {what}")
+        await asyncio.sleep(0.05)
+
+
+async def connect_central(controller, board, index=0):
+    """Wait for advertising, scan for the sensor with central `index` and
+    connect to it."""
+    found = {}
+
+    def on_advertisement(advertisement):
+        name = advertisement.data.get(AdvertisingData.COMPLETE_LOCAL_NAME)
+        if not found and str(name) == DEVICE_NAME:
+            found["address"] = advertisement.address
+
+    await asyncio.to_thread(
+        board.wait_for_regex_in_line, r"Advertising successfully started", TIMEOUT_S
+    )
+
+    client = BleClient(controller.client_transport_of(index), CENTRAL_ADDRESSES[index])
+    await client.initialize()
+    await client.register_listener_callback("advertisement", on_advertisement)
+    await client.start_scanning()
+    await wait_for(lambda: found, TIMEOUT_S, f"advertising for central {index}")
+    await client.stop_scanning()
+
+    await client.connect(found["address"])
+    await client.discover_services()
+    return client
@@ -14,7 +14,9 @@ logger = logging.getLogger(__name__)
 ENVIRONMENTAL_SENSING_SERVICE = UUID.from_16_bits(0x181A)
 TEMPERATURE_CHARACTERISTIC = UUID.from_16_bits(0x2A6E)
 HUMIDITY_CHARACTERISTIC = UUID.from_16_bits(0x2A6F)
-EXPECTED_MANUFACTURER_DATA = bytes.fromhex("59000000")  # Nordic (0x0059) + data 0000
+DEW_POINT_CHARACTERISTIC = UUID.from_16_bits(0x2A7B)
+# Nordic (0x0059) + temperature (s16) + humidity (u16) + sequence number (u8)
+EXPECTED_MANUFACTURER_DATA_PREFIX = bytes.fromhex("5900")
 EXPECTED_URL = "https://github.com/TAREQ-TBZ"
 
 target_device_address = None
@@ -152,7 +154,15 @@ async def test_ble_device(get_board, get_hci_transport_type):
             ),
             None,
         )
-        assert temp_char and humid_char, "Characteristics missing"
+        dew_point_char = next(
+            (
+                c
+                for c in env_service.characteristics
+                if c.uuid == DEW_POINT_CHARACTERISTIC
+            ),
+            None,
+        )
+        assert temp_char and humid_char and dew_point_char, "Characteristics missing"
 
         # 7. Subscribe to notifications
         await ble_client.subscribe_to_characteristics(
@@ -189,6 +199,12 @@ async def test_ble_device(get_board, get_hci_transport_type):
         assert 18 <= temp <= 25, f"Invalid temperature: {temp}°C"
         assert 45 <= humid <= 65, f"Invalid humidity: {humid}%"
 
+        dew_point = int.from_bytes(
+            await dew_point_char.read_value(), "little", signed=True
+        )
+        logger.info(f"Dew point value (read operation): {dew_point}")
+        assert 0 <= dew_point <= round(temp), f"Invalid dew point: {dew_point}°C"
+
     finally:
         # 9. Cleanup
         await ble_client.disconnect()
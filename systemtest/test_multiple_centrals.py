@@ -0,0 +1,98 @@
+"""Two centrals connected to the native_sim build at the same time.
+
+Each central subscribes to a different ESS characteristic, so the CCC state of
+one connection must not leak into the other. Uses the benchmark profile for its
+short measuring period:
+
+    west build -b native_sim app -- -DEXTRA_CONF_FILE=benchmark.conf
+    pytest test_multiple_centrals.py --exe ../build/zephyr/zephyr.exe
+"""
+
+import logging
+
+import pytest
+from bumble.core import UUID
+
+from simulation import (
+    CENTRAL_ADDRESSES,
+    TIMEOUT_S,
+    connect_central,
+    start_simulation,
+    wait_for,
+)
+
+logger = logging.getLogger(__name__)
+
+TEMPERATURE_CHARACTERISTIC = UUID.from_16_bits(0x2A6E)
+HUMIDITY_CHARACTERISTIC = UUID.from_16_bits(0x2A6F)
+
+
+@pytest.fixture
+def simulation(get_exe, tmp_path):
+    controller, board = start_simulation(
+        get_exe, str(tmp_path / "flash.bin"), client_count=len(CENTRAL_ADDRESSES)
+    )
+    yield controller, board
+    board.close()
+    controller.stop()
+
+
+@pytest.mark.asyncio
+async def test_independent_subscriptions(simulation):
+    controller, board = simulation
+    received = [
+        {TEMPERATURE_CHARACTERISTIC: [], HUMIDITY_CHARACTERISTIC: []}
+        for _ in CENTRAL_ADDRESSES
+    ]
+
+    def handler(central, characteristic):
+        return lambda value: received[central][characteristic].append(value)
+
+    clients = []
+    try:
+        # The sensor keeps advertising while a connection object is left
+        for index in range(len(CENTRAL_ADDRESSES)):
+            clients.append(await connect_central(controller, board, index))
+
+        await clients[0].subscribe_to_characteristics(
+            TEMPERATURE_CHARACTERISTIC, handler(0, TEMPERATURE_CHARACTERISTIC)
+        )
+        await clients[1].subscribe_to_characteristics(
+            HUMIDITY_CHARACTERISTIC, handler(1, HUMIDITY_CHARACTERISTIC)
+        )
+        # Catch notifications that arrive without the CCC enabled
+        await clients[0].listen_to_characteristic(
+            HUMIDITY_CHARACTERISTIC, handler(0, HUMIDITY_CHARACTERISTIC)
+        )
+        await clients[1].listen_to_characteristic(
+            TEMPERATURE_CHARACTERISTIC, handler(1, TEMPERATURE_CHARACTERISTIC)
+        )
+
+        await wait_for(
+            lambda: len(received[0][TEMPERATURE_CHARACTERISTIC]) >= 3
+            and len(received[1][HUMIDITY_CHARACTERISTIC]) >= 3,
+            TIMEOUT_S,
+            "notifications on both centrals",
+        )
+
+        # Only what each central subscribed to, on a shared measurement
+        assert not received[0][HUMIDITY_CHARACTERISTIC]
+        assert not received[1][TEMPERATURE_CHARACTERISTIC]
+
+        # Measuring continues for the central that stays
+        await clients[0].disconnect()
+        count = len(received[1][HUMIDITY_CHARACTERISTIC])
+        await wait_for(
+            lambda: len(received[1][HUMIDITY_CHARACTERISTIC]) >= count + 2,
+            TIMEOUT_S,
+            "notifications after the other central left",
+        )
+        logger.info(
+            "Notifications: central 0 %d, central 1 %d",
+            len(received[0][TEMPERATURE_CHARACTERISTIC]),
+            len(received[1][HUMIDITY_CHARACTERISTIC]),
+        )
+    finally:
+        for client in clients:
+            await client.disconnect()
+            await client.close()
@@ -0,0 +1,65 @@
+"""Peak stack use of every thread, measured on the board.
+
+Needs an image with the thread analyzer, which prints the peak use of every
+thread and of the ISR stack once a minute:
+
+    west build -b sham_nrf52833 app \
+        -DEXTRA_CONF_FILE="lean.conf;debug.conf;stack_analysis.conf"
+    pytest test_stack_usage.py --stack-analysis --fw-image merged.hex ...
+
+The peaks are logged and, in CI, written to the job summary. They are the
+data to size the stacks of lean.conf from. Logging is enabled for the output,
+so they are an upper bound for the profile without it.
+"""
+
+import logging
+import os
+import re
+
+import pytest
+
+logger = logging.getLogger(__name__)
+
+# First report after CONFIG_THREAD_ANALYZER_AUTO_INTERVAL (60 s) of uptime
+REPORT_TIMEOUT_S = 150
+STACK_LINE = re.compile(r"([^:]+?)\s*:\s+STACK: unused (\d+) usage (\d+) / (\d+)")
+
+
+def read_report(board):
+    board.wait_for_regex_in_line(r"Thread analyze", timeout_s=REPORT_TIMEOUT_S)
+
+    threads = {}
+    while True:
+        match = STACK_LINE.search(board.read_line(timeout_s=5))
+        if match is None:
+            break
+        name, unused, usage, size = match.groups()
+        threads[name.strip()] = (int(usage), int(size), int(unused))
+
+    return threads
+
+
+def write_summary(threads):
+    summary = os.environ.get("GITHUB_STEP_SUMMARY")
+    if summary is None:
+        return
+
+    with open(summary, "a", encoding="utf-8") as f:
+        f.write("### Peak stack use of the lean_stack image\n\n")
+        f.write("| Thread | Peak | Size | Unused |\n|---|---:|---:|---:|\n")
+        for name, (usage, size, unused) in threads.items():
+            f.write(f"| {name} | {usage} | {size} | {unused} |\n")
+
+
+def test_stack_usage(get_stack_analysis, get_board):
+    get_board.hard_reset()
+
+    threads = read_report(get_board)
+    assert threads, "No thread analyzer report"
+
+    for name, (usage, size, unused) in threads.items():
+        logger.info(f"{name}: peak {usage} of {size} bytes, {unused} unused")
+    write_summary(threads)
+
+    exhausted = [name for name, (_, _, unused) in threads.items() if unused == 0]
+    assert not exhausted, f"Stacks used up: {', '.join(exhausted)}"
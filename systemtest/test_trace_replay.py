@@ -0,0 +1,92 @@
+"""Trace replay on the native_sim build.
+
+Replays traces/step.csv through the SHT4x emulator and checks that the
+notified readings follow it, from the room before the step to the room after
+it. Uses the benchmark profile for its short measuring period:
+
+    west build -b native_sim app -- -DEXTRA_CONF_FILE=benchmark.conf
+    pytest test_trace_replay.py --exe ../build/zephyr/zephyr.exe
+"""
+
+import asyncio
+import logging
+import os
+
+import pytest
+from bumble.core import UUID
+
+from simulation import TIMEOUT_S, connect_central, start_simulation, wait_for
+
+logger = logging.getLogger(__name__)
+
+TEMPERATURE_CHARACTERISTIC = UUID.from_16_bits(0x2A6E)
+HUMIDITY_CHARACTERISTIC = UUID.from_16_bits(0x2A6F)
+TRACE = os.path.join(os.path.dirname(__file__), "traces", "step.csv")
+TRACE_SPEED = 10
+# Before and after the step of the trace, in 0.01 °C and 0.01 %
+BEFORE = (2000, 4000)
+AFTER = (2500, 6000)
+# Rounding of the SHT4x ticks to the 0.01 units
+TOLERANCE = 1
+
+
+@pytest.fixture
+def simulation(get_exe, tmp_path):
+    controller, board = start_simulation(
+        get_exe,
+        str(tmp_path / "flash.bin"),
+        extra_args=[f"--sht4x-trace={TRACE}", f"--sht4x-trace-speed={TRACE_SPEED}"],
+    )
+    yield controller, board
+    board.close()
+    controller.stop()
+
+
+def close_to(value, expected):
+    return abs(value - expected) <= TOLERANCE
+
+
+@pytest.mark.asyncio
+async def test_step_response(simulation):
+    controller, board = simulation
+    temperatures = []
+    humidities = []
+
+    def on_temperature(value):
+        temperatures.append(int.from_bytes(value, "little", signed=True))
+
+    def on_humidity(value):
+        humidities.append(int.from_bytes(value, "little"))
+
+    client = await connect_central(controller, board)
+    try:
+        await client.subscribe_to_characteristics(
+            TEMPERATURE_CHARACTERISTIC, on_temperature
+        )
+        await client.subscribe_to_characteristics(HUMIDITY_CHARACTERISTIC, on_humidity)
+
+        # The step comes 30 s after boot, the end of the trace 10 s later
+        await wait_for(
+            lambda: temperatures and close_to(temperatures[-1], AFTER[0]),
+            TIMEOUT_S + 300 / TRACE_SPEED,
+            "the step of the trace",
+        )
+        await asyncio.to_thread(
+            board.wait_for_regex_in_line, r"Trace replay finished", TIMEOUT_S
+        )
+        await wait_for(
+            lambda: humidities and close_to(humidities[-1], AFTER[1]),
+            TIMEOUT_S,
+            "the humidity step",
+        )
+        logger.info("Temperatures %s, humidities %s", temperatures, humidities)
+
+        assert close_to(temperatures[0], BEFORE[0])
+        assert close_to(humidities[0], BEFORE[1])
+
+        # Monotonic through the step, a measurement may land inside it
+        assert temperatures == sorted(temperatures)
+        assert humidities == sorted(humidities)
+    finally:
+        await client.disconnect()
+        await client.close()
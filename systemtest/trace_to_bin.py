@@ -0,0 +1,51 @@
+"""Convert a temperature/humidity trace from CSV to the binary replay format.
+
+CSV rows are "<seconds>,<temperature in °C>,<humidity in %>", the binary file
+is the magic "SHT4TRC1" followed by one little-endian record per sample:
+u32 time in ms, s16 temperature in 0.01 °C, s16 humidity in 0.01 %.
+
+    python trace_to_bin.py field.csv field.bin
+"""
+
+import argparse
+import csv
+import struct
+from decimal import Decimal, ROUND_DOWN
+
+MAGIC = b"SHT4TRC1"
+
+
+def fixed(text, decimals):
+    # Truncated like the firmware's CSV parser, so both formats replay the same values
+    scale = Decimal(10) ** decimals
+    return int((Decimal(text.strip()) * scale).to_integral_value(ROUND_DOWN))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("csv_file")
+    parser.add_argument("bin_file")
+    args = parser.parse_args()
+
+    records = []
+    with open(args.csv_file, newline="") as f:
+        for row in csv.reader(f):
+            if not row or row[0].strip().startswith("#"):
+                continue
+            try:
+                time_ms = fixed(row[0], 3)
+            except ArithmeticError:
+                continue  # Header
+            records.append(
+                struct.pack("<Ihh", time_ms, fixed(row[1], 2), fixed(row[2], 2))
+            )
+
+    with open(args.bin_file, "wb") as f:
+        f.write(MAGIC)
+        f.writelines(records)
+
+    print(f"{len(records)} samples written to {args.bin_file}")
+
+
+if __name__ == "__main__":
+    main()
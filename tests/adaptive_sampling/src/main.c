@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "adaptive_sampling.h"
+
+#define HOUR_MS       (3600 * MSEC_PER_SEC)
+#define MAX_PERIOD_MS (CONFIG_ADAPTIVE_SAMPLING_MAX_PERIOD_SECONDS * MSEC_PER_SEC)
+
+#define RAMP_CENTI_PER_HOUR 500
+/* The period in which the ramp moves by one temperature step, plus 10 % for the EMA */
+#define RAMP_PERIOD_MS                                                                             \
+	(CONFIG_ADAPTIVE_SAMPLING_TEMP_STEP_CENTI * HOUR_MS / RAMP_CENTI_PER_HOUR * 11 / 10)
+
+/*
+ * Synthetic day in a stable room: 21 °C and 45 %, the last digit of both dithering like a real
+ * sensor. From 08:00 the room heats up by 5 °C within one hour, from 18:00 it cools down again.
+ */
+static int16_t trace_temperature(int64_t time_ms)
+{
+	int32_t temperature = 2100 + (int32_t)(time_ms / 60000 % 3) - 1;
+
+	if (time_ms >= 8 * HOUR_MS && time_ms < 9 * HOUR_MS) {
+		temperature += (time_ms - 8 * HOUR_MS) * RAMP_CENTI_PER_HOUR / HOUR_MS;
+	} else if (time_ms >= 9 * HOUR_MS && time_ms < 18 * HOUR_MS) {
+		temperature += RAMP_CENTI_PER_HOUR;
+	} else if (time_ms >= 18 * HOUR_MS && time_ms < 19 * HOUR_MS) {
+		temperature += RAMP_CENTI_PER_HOUR -
+			       (time_ms - 18 * HOUR_MS) * RAMP_CENTI_PER_HOUR / HOUR_MS;
+	}
+
+	return temperature;
+}
+
+static uint16_t trace_humidity(int64_t time_ms)
+{
+	return 4500 + time_ms / 60000 % 2;
+}
+
+static bool in_window(int64_t time_ms, int64_t from_ms, int64_t to_ms)
+{
+	return time_ms >= from_ms && time_ms < to_ms;
+}
+
+ZTEST(adaptive_sampling, test_synthetic_day)
+{
+	struct adaptive_sampling_stats stats;
+	int64_t time_ms = 0;
+
+	while (time_ms < 24 * HOUR_MS) {
+		uint32_t period_ms = adaptive_sampling_next_period_ms(
+			trace_temperature(time_ms), trace_humidity(time_ms), time_ms);
+
+		/* Stable room long after the start and after the ramps */
+		if (in_window(time_ms, 2 * HOUR_MS, 8 * HOUR_MS) ||
+		    in_window(time_ms, 10 * HOUR_MS, 18 * HOUR_MS)) {
+			zassert_equal(period_ms, MAX_PERIOD_MS, "period %u ms at %lld ms",
+				      period_ms, time_ms);
+		}
+
+		/* Second half of each ramp, the rate average has settled */
+		if (in_window(time_ms, 8 * HOUR_MS + HOUR_MS / 2, 9 * HOUR_MS) ||
+		    in_window(time_ms, 18 * HOUR_MS + HOUR_MS / 2, 19 * HOUR_MS)) {
+			zassert_true(period_ms <= RAMP_PERIOD_MS, "period %u ms at %lld ms",
+				     period_ms, time_ms);
+		}
+
+		time_ms += period_ms;
+	}
+
+	adaptive_sampling_get_stats(&stats);
+	TC_PRINT("%u measurements, the fixed period would have taken %u\n", stats.samples,
+		 stats.baseline_samples);
+
+	zassert_true(stats.samples < stats.baseline_samples / 4);
+}
+
+ZTEST_SUITE(adaptive_sampling, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/ztest.h>
+
+#include "fixed_point.h"
+
+/* Exponents of the readings, the sensor ranges fit below 256 °C and 128 % */
+#define TEMPERATURE_SHIFT 8
+#define HUMIDITY_SHIFT    7
+
+#define CONVERSIONS 1000
+
+/* Q31 mantissa of a value in 0.01 units */
+static q31_t to_q31(int32_t hundredths, int8_t shift)
+{
+	double value = hundredths / 100.0 * (double)(1LL << (31 - shift));
+
+	return (q31_t)(value < 0.0 ? value - 0.5 : value + 0.5);
+}
+
+ZTEST(fixed_point, test_exact_values)
+{
+	zassert_equal(fixed_point_q31_to_scaled(to_q31(2150, TEMPERATURE_SHIFT),
+						TEMPERATURE_SHIFT, 100),
+		      2150);
+	zassert_equal(fixed_point_q31_to_scaled(to_q31(-4000, TEMPERATURE_SHIFT),
+						TEMPERATURE_SHIFT, 100),
+		      -4000);
+	zassert_equal(fixed_point_q31_to_scaled(to_q31(10000, HUMIDITY_SHIFT), HUMIDITY_SHIFT, 100),
+		      10000);
+	zassert_equal(fixed_point_q31_to_scaled(0, TEMPERATURE_SHIFT, 100), 0);
+}
+
+ZTEST(fixed_point, test_round_half_away_from_zero)
+{
+	/* 2.5 and -2.5 with a shift of 2 */
+	zassert_equal(fixed_point_q31_to_scaled(1342177280, 2, 1), 3);
+	zassert_equal(fixed_point_q31_to_scaled(-1342177280, 2, 1), -3);
+
+	/* Just below the half */
+	zassert_equal(fixed_point_q31_to_scaled(1342177279, 2, 1), 2);
+	zassert_equal(fixed_point_q31_to_scaled(-1342177279, 2, 1), -2);
+}
+
+ZTEST(fixed_point, test_large_shift)
+{
+	/* The mantissa is an integer from a shift of 31 on */
+	zassert_equal(fixed_point_q31_to_scaled(5, 31, 100), 500);
+	zassert_equal(fixed_point_q31_to_scaled(-5, 31, 100), -500);
+	zassert_equal(fixed_point_q31_to_scaled(-5, 33, 100), -2000);
+}
+
+ZTEST(fixed_point, test_sensor_range)
+{
+	for (int32_t t = -4000; t <= 12500; t++) {
+		zassert_equal(fixed_point_q31_to_scaled(to_q31(t, TEMPERATURE_SHIFT),
+							TEMPERATURE_SHIFT, 100),
+			      t, "temperature %d", t);
+	}
+
+	for (int32_t rh = 0; rh <= 10000; rh++) {
+		zassert_equal(fixed_point_q31_to_scaled(to_q31(rh, HUMIDITY_SHIFT), HUMIDITY_SHIFT,
+							100),
+			      rh, "humidity %d", rh);
+	}
+}
+
+ZTEST(fixed_point, test_isqrt)
+{
+	zassert_equal(fixed_point_isqrt(0), 0);
+	zassert_equal(fixed_point_isqrt(1), 1);
+	zassert_equal(fixed_point_isqrt(15), 3);
+	zassert_equal(fixed_point_isqrt(16), 4);
+	zassert_equal(fixed_point_isqrt(UINT64_MAX), UINT32_MAX);
+
+	for (uint32_t root = 1; root < UINT32_MAX / 3; root = root * 3 + 1) {
+		uint64_t square = (uint64_t)root * root;
+
+		zassert_equal(fixed_point_isqrt(square), root, "root %u", root);
+		zassert_equal(fixed_point_isqrt(square - 1), root - 1, "root %u", root);
+	}
+}
+
+#if defined(CONFIG_TIMING_FUNCTIONS)
+/* The float conversion of the measurement path before it was fixed point */
+static int32_t float_to_scaled(q31_t value, int8_t shift, int32_t scale)
+{
+	float scaled = (float)value * (float)scale / (float)(1LL << (31 - shift));
+
+	return (int32_t)(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+}
+
+/* Run on the target, native_sim has no cycle counter that follows the host CPU */
+ZTEST(fixed_point, test_conversion_cycles)
+{
+	static volatile q31_t readings[] = {180355072, 181194342, 3825205, -335544320};
+	volatile int32_t sink;
+	timing_t start;
+	timing_t end;
+	uint64_t fixed_cycles;
+	uint64_t float_cycles;
+
+	timing_init();
+	timing_start();
+
+	start = timing_counter_get();
+	for (int i = 0; i < CONVERSIONS; i++) {
+		sink = fixed_point_q31_to_scaled(readings[i % ARRAY_SIZE(readings)],
+						 TEMPERATURE_SHIFT, 100);
+	}
+	end = timing_counter_get();
+	fixed_cycles = timing_cycles_get(&start, &end);
+
+	start = timing_counter_get();
+	for (int i = 0; i < CONVERSIONS; i++) {
+		sink = float_to_scaled(readings[i % ARRAY_SIZE(readings)], TEMPERATURE_SHIFT, 100);
+	}
+	end = timing_counter_get();
+	float_cycles = timing_cycles_get(&start, &end);
+
+	timing_stop();
+	ARG_UNUSED(sink);
+
+	TC_PRINT("Cycles per conversion (FPU %s): fixed point %llu, float %llu\n",
+		 IS_ENABLED(CONFIG_FPU) ? "on" : "off", fixed_cycles / CONVERSIONS,
+		 float_cycles / CONVERSIONS);
+}
+#endif
+
+ZTEST_SUITE(fixed_point, NULL, NULL, NULL, NULL, NULL);
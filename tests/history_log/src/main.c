@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/ztest.h>
+
+#include "history_svc.h"
+
+#define PERIOD_SECONDS CONFIG_MEASURING_PERIOD_SECONDS
+
+/* Bound for the wrap-around, a log of 16 sectors wraps long before */
+#define MAX_SAMPLES 100000
+
+/* Mix of small and large deltas, exercises the short and the long records */
+static int16_t sample_temperature(uint32_t index)
+{
+	return 2000 + (int16_t)((index * 37) % 200) - 100;
+}
+
+static uint16_t sample_humidity(uint32_t index)
+{
+	return 5000 + (index % 8);
+}
+
+static void append_samples(uint32_t count)
+{
+	struct history_info info;
+
+	history_svc_get_info(&info);
+
+	for (uint32_t i = info.next_index; i < info.next_index + count; i++) {
+		zassert_ok(history_svc_append(sample_temperature(i), sample_humidity(i)));
+	}
+}
+
+/* Reads from @p index to the end, checks indexes and values against the pattern */
+static uint32_t check_samples(uint32_t index)
+{
+	struct history_cursor cursor;
+	struct history_sample sample;
+	struct history_info info;
+	uint32_t timestamp = 0;
+	uint32_t count = 0;
+	int ret;
+
+	history_svc_get_info(&info);
+	zassert_ok(history_svc_seek_index(&cursor, index));
+
+	index = MAX(index, info.first_index);
+	while ((ret = history_svc_read_next(&cursor, &sample)) == 0) {
+		zassert_equal(sample.index, index + count);
+		zassert_equal(sample.temperature, sample_temperature(sample.index));
+		zassert_equal(sample.humidity, sample_humidity(sample.index));
+		zassert_true(sample.timestamp >= timestamp);
+		timestamp = sample.timestamp;
+		count++;
+	}
+
+	zassert_equal(ret, -ENODATA);
+	zassert_equal(index + count, info.next_index);
+
+	return count;
+}
+
+static void history_log_before(void *fixture)
+{
+	const struct flash_area *fa;
+
+	ARG_UNUSED(fixture);
+
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(storage_partition), &fa));
+	zassert_ok(flash_area_erase(fa, 0, fa->fa_size));
+	flash_area_close(fa);
+
+	zassert_ok(history_svc_init());
+}
+
+ZTEST(history_log, test_empty)
+{
+	struct history_cursor cursor;
+	struct history_info info;
+
+	history_svc_get_info(&info);
+	zassert_equal(info.first_index, 0);
+	zassert_equal(info.next_index, 0);
+	zassert_true(info.sector_cnt >= 2);
+
+	zassert_equal(history_svc_seek_index(&cursor, 0), -ENODATA);
+}
+
+ZTEST(history_log, test_record_encodings)
+{
+	struct {
+		int16_t temperature;
+		uint16_t humidity;
+		uint32_t sleep;
+	} const samples[] = {
+		{2150, 4500, 0},                    /* Sector header */
+		{2151, 4499, PERIOD_SECONDS},       /* Short record */
+		{2143, 4502, PERIOD_SECONDS},       /* Short record, limits of the deltas */
+		{2500, 3000, PERIOD_SECONDS},       /* Long record */
+		{-4000, 10000, PERIOD_SECONDS},     /* Long record, large deltas */
+		{-4001, 10000, 3 * PERIOD_SECONDS}, /* Timed record */
+		{-4001, 10000, 0},                  /* Timed record, no time passed */
+		{-4000, 10001, PERIOD_SECONDS},
+	};
+	uint32_t timestamps[ARRAY_SIZE(samples)];
+	struct history_cursor cursor;
+	struct history_sample sample;
+
+	for (size_t i = 0; i < ARRAY_SIZE(samples); i++) {
+		k_sleep(K_SECONDS(samples[i].sleep));
+		timestamps[i] = history_svc_get_time();
+		zassert_ok(history_svc_append(samples[i].temperature, samples[i].humidity));
+	}
+
+	zassert_ok(history_svc_seek_index(&cursor, 0));
+	for (size_t i = 0; i < ARRAY_SIZE(samples); i++) {
+		zassert_ok(history_svc_read_next(&cursor, &sample));
+		zassert_equal(sample.index, i);
+		zassert_equal(sample.timestamp, timestamps[i], "sample %zu", i);
+		zassert_equal(sample.temperature, samples[i].temperature, "sample %zu", i);
+		zassert_equal(sample.humidity, samples[i].humidity, "sample %zu", i);
+	}
+	zassert_equal(history_svc_read_next(&cursor, &sample), -ENODATA);
+}
+
+ZTEST(history_log, test_seek)
+{
+	uint32_t timestamps[40];
+	struct history_cursor cursor;
+	struct history_sample sample;
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(timestamps); i++) {
+		k_sleep(K_SECONDS(PERIOD_SECONDS));
+		timestamps[i] = history_svc_get_time();
+		zassert_ok(history_svc_append(sample_temperature(i), sample_humidity(i)));
+	}
+
+	zassert_ok(history_svc_seek_index(&cursor, 17));
+	zassert_ok(history_svc_read_next(&cursor, &sample));
+	zassert_equal(sample.index, 17);
+
+	zassert_ok(history_svc_seek_time(&cursor, timestamps[25]));
+	zassert_ok(history_svc_read_next(&cursor, &sample));
+	zassert_equal(sample.index, 25);
+
+	/* Between two samples, the next newer one */
+	zassert_ok(history_svc_seek_time(&cursor, timestamps[25] + 1));
+	zassert_ok(history_svc_read_next(&cursor, &sample));
+	zassert_equal(sample.index, 26);
+
+	zassert_ok(history_svc_seek_time(&cursor, timestamps[39] + 1));
+	zassert_equal(history_svc_read_next(&cursor, &sample), -ENODATA);
+
+	zassert_equal(check_samples(0), ARRAY_SIZE(timestamps));
+}
+
+ZTEST(history_log, test_wrap_around)
+{
+	struct history_info info;
+	uint32_t count = 0;
+
+	/* Until the oldest sector was recycled and reused */
+	do {
+		zassert_true(count < MAX_SAMPLES, "log did not wrap");
+		append_samples(100);
+		count += 100;
+		history_svc_get_info(&info);
+	} while (info.max_erase_cnt < 2);
+
+	zassert_true(info.first_index > 0);
+	zassert_equal(info.next_index, count);
+
+	/* Older indexes are clamped to the oldest stored sample */
+	zassert_equal(check_samples(0), count - info.first_index);
+	check_samples(info.first_index + 1);
+}
+
+ZTEST(history_log, test_stale_cursor)
+{
+	struct history_cursor cursor;
+	struct history_sample sample;
+	struct history_info info;
+
+	append_samples(10);
+	zassert_ok(history_svc_seek_index(&cursor, 0));
+	zassert_ok(history_svc_read_next(&cursor, &sample));
+
+	do {
+		append_samples(100);
+		history_svc_get_info(&info);
+	} while (info.first_index == 0);
+
+	zassert_equal(history_svc_read_next(&cursor, &sample), -ESTALE);
+}
+
+ZTEST(history_log, test_reboot_recovery)
+{
+	struct history_sample sample;
+	struct history_cursor cursor;
+	struct history_info info;
+	uint32_t next_index;
+	uint32_t timestamp;
+
+	/* Spans several sectors, only the newest one is scanned on mount */
+	append_samples(1500);
+	zassert_ok(history_svc_flush());
+	history_svc_get_info(&info);
+	next_index = info.next_index;
+	timestamp = history_svc_get_time();
+
+	/* Not flushed, lost with the reboot */
+	zassert_ok(history_svc_append(sample_temperature(next_index),
+				      sample_humidity(next_index)));
+
+	zassert_ok(history_svc_init());
+
+	history_svc_get_info(&info);
+	zassert_equal(info.next_index, next_index);
+	zassert_equal(check_samples(0), next_index - info.first_index);
+	zassert_true(history_svc_get_time() >= timestamp);
+
+	/* The indexes and the log time continue */
+	append_samples(50);
+	check_samples(0);
+
+	zassert_ok(history_svc_seek_index(&cursor, info.next_index));
+	zassert_ok(history_svc_read_next(&cursor, &sample));
+	zassert_equal(sample.index, info.next_index);
+	zassert_true(sample.timestamp >= timestamp);
+}
+
+ZTEST_SUITE(history_log, NULL, NULL, history_log_before, NULL, NULL);
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "measurement_filter.h"
+
+#define EMA_TIME_CONSTANT (1 << CONFIG_MEASUREMENT_EMA_SHIFT)
+
+/* Bound for the IIR to settle on a step, about 7 time constants */
+#define SETTLE_MAX (8 * EMA_TIME_CONSTANT)
+
+#define OUTLIER_LIMIT 50
+
+static int32_t step_up[SETTLE_MAX];
+static int32_t step_down[SETTLE_MAX];
+
+/* Burst with a spike in each direction, the reads are shuffled */
+static void spiky_burst(int32_t *samples)
+{
+	const int32_t burst[] = {2000, 2010, 2500, 2030, 1400};
+
+	memcpy(samples, burst, sizeof(burst));
+}
+
+/* Feeds @p to after the filter settled on @p from, returns the measurements to settle on @p to */
+static size_t step_response(int32_t from, int32_t to, int32_t *outputs)
+{
+	struct measurement_filter_channel channel = {0};
+	size_t settled = 0;
+
+	zassert_equal(measurement_filter_ema(&channel, from), from);
+
+	for (size_t i = 0; i < SETTLE_MAX; i++) {
+		outputs[i] = measurement_filter_ema(&channel, to);
+
+		/* Monotonic, without overshoot */
+		zassert_true(outputs[i] >= MIN(from, to) && outputs[i] <= MAX(from, to),
+			     "output %d at %zu", outputs[i], i);
+		if (i > 0) {
+			zassert_true(from < to ? outputs[i] >= outputs[i - 1]
+					       : outputs[i] <= outputs[i - 1]);
+		}
+
+		if (outputs[i] != to) {
+			settled = i + 1;
+		}
+	}
+
+	zassert_equal(outputs[SETTLE_MAX - 1], to, "settled on %d instead of %d",
+		      outputs[SETTLE_MAX - 1], to);
+
+	return settled;
+}
+
+ZTEST(measurement_filter, test_single_read)
+{
+	int32_t samples[] = {2137};
+
+	zassert_equal(measurement_filter_reduce(samples, 1, OUTLIER_LIMIT), 2137);
+}
+
+ZTEST(measurement_filter, test_median)
+{
+	int32_t samples[5];
+	int32_t even[] = {2001, 2000, 3000, 2004};
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_MEASUREMENT_BURST_MEDIAN);
+
+	spiky_burst(samples);
+	zassert_equal(measurement_filter_reduce(samples, ARRAY_SIZE(samples), OUTLIER_LIMIT),
+		      2010);
+
+	/* Mean of the two middle reads, 2002.5 rounded to nearest */
+	zassert_equal(measurement_filter_reduce(even, ARRAY_SIZE(even), OUTLIER_LIMIT), 2003);
+}
+
+ZTEST(measurement_filter, test_outlier_mean)
+{
+	int32_t samples[5];
+	int32_t clean[] = {1990, 2010, 2000};
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_MEASUREMENT_BURST_OUTLIER_MEAN);
+
+	/* Median 2010, the mean of 2000, 2010 and 2030 */
+	spiky_burst(samples);
+	zassert_equal(measurement_filter_reduce(samples, ARRAY_SIZE(samples), OUTLIER_LIMIT),
+		      2013);
+
+	zassert_equal(measurement_filter_reduce(clean, ARRAY_SIZE(clean), OUTLIER_LIMIT), 2000);
+
+	/* Nothing but the median is within a limit of 1 */
+	spiky_burst(samples);
+	zassert_equal(measurement_filter_reduce(samples, ARRAY_SIZE(samples), 1), 2010);
+}
+
+ZTEST(measurement_filter, test_mean)
+{
+	int32_t samples[5];
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_MEASUREMENT_BURST_MEAN);
+
+	/* 9940 / 5, the spikes are kept */
+	spiky_burst(samples);
+	zassert_equal(measurement_filter_reduce(samples, ARRAY_SIZE(samples), OUTLIER_LIMIT),
+		      1988);
+}
+
+ZTEST(measurement_filter, test_ema_step)
+{
+	size_t settled_up = step_response(2000, 2500, step_up);
+	size_t settled_down = step_response(2500, 2000, step_down);
+
+	TC_PRINT("Settled after %zu measurements up, %zu down\n", settled_up, settled_down);
+
+	/* 1 - 1/e of the step after one time constant */
+	zassert_within(step_up[EMA_TIME_CONSTANT - 1], 2000 + 500 * 63 / 100, 2);
+	zassert_within(step_down[EMA_TIME_CONSTANT - 1], 2500 - 500 * 63 / 100, 2);
+
+	/* Both directions alike, up to the rounding of the output */
+	for (size_t i = 0; i < SETTLE_MAX; i++) {
+		zassert_within(step_up[i] - 2000, 2500 - step_down[i], 1, "measurement %zu", i);
+	}
+	zassert_within(settled_up, settled_down, 1);
+}
+
+ZTEST(measurement_filter, test_ema_below_zero)
+{
+	size_t settled = step_response(-1000, -500, step_up);
+
+	zassert_within(settled, step_response(-500, -1000, step_down), 1);
+}
+
+ZTEST_SUITE(measurement_filter, NULL, NULL, NULL, NULL, NULL);
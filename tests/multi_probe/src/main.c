@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/drivers/emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "humidity_temperature_svc.h"
+#include "sht4x_emul.h"
+
+#define ROOM_PROBE DT_NODELABEL(sht4x)
+#define DUCT_PROBE DT_NODELABEL(sht4x_duct)
+
+/* Rounding of the SHT4x ticks to the 0.01 units */
+#define TOLERANCE 1
+
+static const struct emul *room = EMUL_DT_GET(ROOM_PROBE);
+static const struct emul *duct = EMUL_DT_GET(DUCT_PROBE);
+
+static K_SEM_DEFINE(measurement_done, 0, 1);
+static int measurement_result;
+
+static void on_measurement(int result)
+{
+	measurement_result = result;
+	k_sem_give(&measurement_done);
+}
+
+static void measure(void)
+{
+	zassert_ok(humidity_temperature_svc_trigger_measurement(on_measurement));
+	zassert_ok(k_sem_take(&measurement_done, K_SECONDS(1)));
+	zassert_ok(measurement_result);
+}
+
+static void check_sample(size_t sensor, enum measurement_channel channel, int32_t expected)
+{
+	int32_t value;
+
+	zassert_ok(humidity_temperature_svc_get_sample(sensor, channel, &value));
+	zassert_within(value, expected, TOLERANCE, "sensor %zu channel %d: %d", sensor, channel,
+		       value);
+}
+
+static void *multi_probe_setup(void)
+{
+	zassert_ok(humidity_temperature_svc_init());
+
+	return NULL;
+}
+
+ZTEST(multi_probe, test_registry)
+{
+	int32_t value;
+
+	zassert_equal(humidity_temperature_svc_sensor_count(), 2);
+
+	/* SHT4x have no pressure channel */
+	zassert_equal(humidity_temperature_svc_get_sample(1, MEASUREMENT_CHANNEL_PRESSURE, &value),
+		      -EINVAL);
+}
+
+ZTEST(multi_probe, test_both_probes)
+{
+	uint32_t room_count = sht4x_emul_get_measurement_count(room);
+	uint32_t duct_count = sht4x_emul_get_measurement_count(duct);
+	int16_t temperature;
+	uint16_t humidity;
+
+	zassert_ok(sht4x_emul_set_measurement(room, 2150, 4500));
+	zassert_ok(sht4x_emul_set_measurement(duct, 1420, 7250));
+
+	measure();
+
+	/* One read per probe and oversampling round, chained on the shared bus */
+	zassert_equal(sht4x_emul_get_measurement_count(room) - room_count,
+		      CONFIG_MEASUREMENT_OVERSAMPLING);
+	zassert_equal(sht4x_emul_get_measurement_count(duct) - duct_count,
+		      CONFIG_MEASUREMENT_OVERSAMPLING);
+
+	check_sample(0, MEASUREMENT_CHANNEL_TEMPERATURE, 2150);
+	check_sample(0, MEASUREMENT_CHANNEL_HUMIDITY, 4500);
+	check_sample(1, MEASUREMENT_CHANNEL_TEMPERATURE, 1420);
+	check_sample(1, MEASUREMENT_CHANNEL_HUMIDITY, 7250);
+
+	/* The first probe in the list is the primary one */
+	zassert_ok(humidity_temperature_svc_get_temperature(&temperature));
+	zassert_within(temperature, 2150, TOLERANCE);
+	zassert_ok(humidity_temperature_svc_get_humidity(&humidity));
+	zassert_within(humidity, 4500, TOLERANCE);
+}
+
+ZTEST(multi_probe, test_probes_follow_independently)
+{
+	zassert_ok(sht4x_emul_set_measurement(room, 2150, 4500));
+	zassert_ok(sht4x_emul_set_measurement(duct, 1420, 7250));
+	measure();
+
+	/* Only the duct changes */
+	zassert_ok(sht4x_emul_set_measurement(duct, -520, 9100));
+	measure();
+
+	check_sample(0, MEASUREMENT_CHANNEL_TEMPERATURE, 2150);
+	check_sample(0, MEASUREMENT_CHANNEL_HUMIDITY, 4500);
+	check_sample(1, MEASUREMENT_CHANNEL_TEMPERATURE, -520);
+	check_sample(1, MEASUREMENT_CHANNEL_HUMIDITY, 9100);
+}
+
+ZTEST_SUITE(multi_probe, NULL, multi_probe_setup, NULL, NULL, NULL);
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "psychrometrics.h"
+
+/*
+ * Reference values: the formulas of psychrometrics.h evaluated in double precision and rounded
+ * to 0.01, the tolerances are the error bounds stated there.
+ */
+struct reference {
+	int16_t temperature;
+	uint16_t humidity;
+	int32_t expected;
+};
+
+ZTEST(psychrometrics, test_dew_point)
+{
+	static const struct reference references[] = {
+		{2500, 5000, 1385},  {2000, 10000, 2000}, {-1000, 8000, -1280},
+		{3500, 3000, 1484},  {0, 100, -5038},     {6000, 9000, 5776},
+		{-4000, 5000, -4646}, {12500, 1000, 6419},
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(references); i++) {
+		const struct reference *ref = &references[i];
+		int16_t dew_point = psychrometrics_dew_point(ref->temperature, ref->humidity);
+
+		zassert_within(dew_point, ref->expected, 1, "%d at %d, %u", dew_point,
+			       ref->temperature, ref->humidity);
+	}
+
+	/* Saturated air is at its dew point, 0 % is evaluated as 0.01 % */
+	zassert_equal(psychrometrics_dew_point(-1234, 10000), -1234);
+	zassert_equal(psychrometrics_dew_point(2000, 0), psychrometrics_dew_point(2000, 1));
+}
+
+ZTEST(psychrometrics, test_absolute_humidity)
+{
+	static const struct reference references[] = {
+		{2500, 5000, 1148}, {2000, 10000, 1724}, {-1000, 8000, 189}, {3500, 3000, 1184},
+		{0, 100, 5},        {6000, 9000, 11704}, {-4000, 5000, 9},   {12500, 1000, 13195},
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(references); i++) {
+		const struct reference *ref = &references[i];
+		uint16_t absolute_humidity =
+			psychrometrics_absolute_humidity(ref->temperature, ref->humidity);
+
+		zassert_within(absolute_humidity, ref->expected, 1 + ref->expected / 5000,
+			       "%u at %d, %u", absolute_humidity, ref->temperature, ref->humidity);
+	}
+
+	zassert_equal(psychrometrics_absolute_humidity(2500, 0), 0);
+}
+
+ZTEST(psychrometrics, test_heat_index)
+{
+	static const struct reference references[] = {
+		{2100, 4500, 2033},   /* Steadman */
+		{-4000, 0, -4794},    /* Steadman */
+		{3000, 6000, 3283},   /* Rothfusz */
+		{3500, 8000, 5655},   /* Rothfusz */
+		{5000, 6000, 11395},  /* Rothfusz */
+		{4000, 1000, 3671},   /* Low humidity adjustment */
+		{2800, 9000, 3400},   /* High humidity adjustment */
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(references); i++) {
+		const struct reference *ref = &references[i];
+		int16_t heat_index = psychrometrics_heat_index(ref->temperature, ref->humidity);
+
+		zassert_within(heat_index, ref->expected, 1, "%d at %d, %u", heat_index,
+			       ref->temperature, ref->humidity);
+	}
+}
+
+ZTEST(psychrometrics, test_heat_index_clamp)
+{
+	/* 328.20 °C and 2046.45 °C by the regression */
+	zassert_equal(psychrometrics_heat_index(6000, 9750), PSYCHROMETRICS_HEAT_INDEX_MAX);
+	zassert_equal(psychrometrics_heat_index(12500, 10000), PSYCHROMETRICS_HEAT_INDEX_MAX);
+
+	/* Humidity above 100 % is evaluated as 100 % */
+	zassert_equal(psychrometrics_heat_index(3000, 12000),
+		      psychrometrics_heat_index(3000, 10000));
+
+	/* Steadman below the sensor range */
+	zassert_equal(psychrometrics_heat_index(INT16_MIN, 0), PSYCHROMETRICS_HEAT_INDEX_MIN);
+}
+
+ZTEST_SUITE(psychrometrics, NULL, NULL, NULL, NULL, NULL);
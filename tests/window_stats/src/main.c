@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024 Tareq Mhisen
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+
+#include "window_stats_svc.h"
+
+#define STATS_SIZE 97
+
+#define SHORT_SECONDS (CONFIG_WINDOW_STATS_SHORT_MINUTES * 60)
+#define LONG_SECONDS  (CONFIG_WINDOW_STATS_LONG_MINUTES * 60)
+
+enum {
+	SHORT,
+	LONG,
+	BOOT,
+	WINDOW_COUNT,
+};
+
+enum {
+	TEMPERATURE,
+	HUMIDITY,
+	CHANNEL_COUNT,
+};
+
+struct channel_stats {
+	uint32_t count;
+	int16_t min;
+	int16_t max;
+	int16_t mean;
+	uint16_t stddev;
+};
+
+struct window {
+	uint32_t length;
+	uint32_t covered;
+	struct channel_stats channels[CHANNEL_COUNT];
+};
+
+extern const struct bt_gatt_service_static window_stats_service;
+
+/* Reads the characteristic like a central, parses the value */
+static void read_stats(struct window *windows)
+{
+	const struct bt_gatt_attr *attr = &window_stats_service.attrs[2];
+	uint8_t value[STATS_SIZE];
+	const uint8_t *p = &value[1];
+
+	zassert_equal(attr->read(NULL, attr, value, sizeof(value), 0), STATS_SIZE);
+	zassert_equal(value[0], 1, "version %u", value[0]);
+
+	for (size_t w = 0; w < WINDOW_COUNT; w++) {
+		windows[w].length = sys_get_le32(&p[0]);
+		windows[w].covered = sys_get_le32(&p[4]);
+		p += 8;
+
+		for (size_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+			struct channel_stats *stats = &windows[w].channels[ch];
+
+			stats->count = sys_get_le32(&p[0]);
+			stats->min = (int16_t)sys_get_le16(&p[4]);
+			stats->max = (int16_t)sys_get_le16(&p[6]);
+			stats->mean = (int16_t)sys_get_le16(&p[8]);
+			stats->stddev = sys_get_le16(&p[10]);
+			p += 12;
+		}
+	}
+}
+
+static void check_stats(const struct channel_stats *stats, uint32_t count, int16_t min,
+			int16_t max, int16_t mean, uint16_t stddev)
+{
+	zassert_equal(stats->count, count);
+	zassert_equal(stats->min, min);
+	zassert_equal(stats->max, max);
+	zassert_equal(stats->mean, mean);
+	zassert_within(stats->stddev, stddev, 1, "stddev %u", stats->stddev);
+}
+
+static void window_stats_before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	/* Past both sliding windows, only the one since boot keeps its measurements */
+	k_sleep(K_SECONDS(2 * LONG_SECONDS));
+}
+
+ZTEST(window_stats, test_empty_windows)
+{
+	struct window windows[WINDOW_COUNT];
+
+	read_stats(windows);
+
+	zassert_equal(windows[SHORT].length, SHORT_SECONDS);
+	zassert_equal(windows[LONG].length, LONG_SECONDS);
+	zassert_equal(windows[BOOT].length, 0);
+
+	for (size_t w = SHORT; w <= LONG; w++) {
+		/* Up to one bucket shorter while the window slides */
+		zassert_true(windows[w].covered <= windows[w].length);
+		zassert_true(windows[w].covered >= windows[w].length * 3 / 4);
+
+		for (size_t ch = 0; ch < CHANNEL_COUNT; ch++) {
+			check_stats(&windows[w].channels[ch], 0, 0, 0, 0, 0);
+		}
+	}
+}
+
+ZTEST(window_stats, test_min_max_mean)
+{
+	static const int16_t temperatures[] = {2000, 2300, 2100, 2200};
+	static const uint16_t humidities[] = {4010, 4000, 4030, 4020};
+	struct window windows[WINDOW_COUNT];
+
+	for (size_t i = 0; i < ARRAY_SIZE(temperatures); i++) {
+		window_stats_svc_append(temperatures[i], humidities[i]);
+		k_sleep(K_SECONDS(30));
+	}
+
+	read_stats(windows);
+
+	/* Sample standard deviations 129.10 and 12.91 */
+	for (size_t w = SHORT; w <= LONG; w++) {
+		check_stats(&windows[w].channels[TEMPERATURE], 4, 2000, 2300, 2150, 129);
+		check_stats(&windows[w].channels[HUMIDITY], 4, 4000, 4030, 4015, 13);
+	}
+
+	/* A single value has no spread */
+	k_sleep(K_SECONDS(2 * LONG_SECONDS));
+	window_stats_svc_append(-1234, 5555);
+	read_stats(windows);
+
+	check_stats(&windows[SHORT].channels[TEMPERATURE], 1, -1234, -1234, -1234, 0);
+	check_stats(&windows[SHORT].channels[HUMIDITY], 1, 5555, 5555, 5555, 0);
+}
+
+ZTEST(window_stats, test_windows_slide)
+{
+	struct window windows[WINDOW_COUNT];
+
+	window_stats_svc_append(1000, 3000);
+
+	/* Out of the short window, still in the long one */
+	k_sleep(K_SECONDS(SHORT_SECONDS + SHORT_SECONDS / 4));
+	window_stats_svc_append(3000, 5000);
+	read_stats(windows);
+
+	check_stats(&windows[SHORT].channels[TEMPERATURE], 1, 3000, 3000, 3000, 0);
+	check_stats(&windows[LONG].channels[TEMPERATURE], 2, 1000, 3000, 2000, 1414);
+	check_stats(&windows[LONG].channels[HUMIDITY], 2, 3000, 5000, 4000, 1414);
+
+	/* Both out of the long window, the read alone lets the windows slide */
+	k_sleep(K_SECONDS(LONG_SECONDS + LONG_SECONDS / 4));
+	read_stats(windows);
+
+	check_stats(&windows[SHORT].channels[TEMPERATURE], 0, 0, 0, 0, 0);
+	check_stats(&windows[LONG].channels[TEMPERATURE], 0, 0, 0, 0, 0);
+}
+
+ZTEST(window_stats, test_since_boot)
+{
+	struct window before[WINDOW_COUNT];
+	struct window after[WINDOW_COUNT];
+
+	read_stats(before);
+	window_stats_svc_append(-4000, 0);
+	window_stats_svc_append(12500, 10000);
+	read_stats(after);
+
+	/* Never slides, holds the measurements of all tests */
+	zassert_equal(after[BOOT].channels[TEMPERATURE].count,
+		      before[BOOT].channels[TEMPERATURE].count + 2);
+	zassert_equal(after[BOOT].channels[TEMPERATURE].min, -4000);
+	zassert_equal(after[BOOT].channels[TEMPERATURE].max, 12500);
+	zassert_equal(after[BOOT].channels[HUMIDITY].min, 0);
+	zassert_equal(after[BOOT].channels[HUMIDITY].max, 10000);
+	zassert_equal(after[BOOT].covered, k_uptime_get() / MSEC_PER_SEC);
+}
+
+ZTEST_SUITE(window_stats, NULL, NULL, window_stats_before, NULL, NULL);